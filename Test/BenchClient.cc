@@ -59,14 +59,14 @@ void BenchClient::OnConnected(Net::Connection * connection) {
 void BenchClient::OnConnectFailed(Net::Connection * connection, i32 reason) {
 	++connect_failed_counter_;
 	if (disconnected_counter_ + connect_failed_counter_ >= client_count_) {
-		quit_ = true;
+		Quit();
 	}
 }
 
 void BenchClient::OnDisconnected(Net::Connection * connection, bool is_remote) {
 	++disconnected_counter_;
 	if (disconnected_counter_ + connect_failed_counter_ >= client_count_) {
-		quit_ = true;
+		Quit();
 	}
 }
 
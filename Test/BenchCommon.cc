@@ -23,14 +23,19 @@ void BenchCommon::Poll() {
 	sig_int_ = CreateSignal(SIGINT);
 	sig_term_ = CreateSignal(SIGTERM);
 	auto start = std::chrono::system_clock::now();
-	while (!quit_) {
-		reactor_->Poll();
+	if (!quit_) {
+		reactor_->Run();
 	}
 	auto end = std::chrono::system_clock::now();
 	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 	use_time_ = duration.count();
 }
 
+void BenchCommon::Quit() {
+	quit_ = true;
+	reactor_->Stop();
+}
+
 void BenchCommon::ShowStatus() {
 	std::printf("成功连接数/失败连接数/关闭连接数 %d/%d/%d\n", connected_counter_, connect_failed_counter_, disconnected_counter_);
 	std::printf("成功收包大小 %lld\n", recv_packet_size_);
@@ -126,7 +131,7 @@ void BenchCommon::DeleteSignal(uv_signal_t * handle) {
 void BenchCommon::SignalCb(uv_signal_t * handle, int signum) {
 	BenchCommon * data = static_cast<BenchCommon *>(handle->data);
 	if (data) {
-		data->quit_ = true;
+		data->Quit();
 	}
 }
 
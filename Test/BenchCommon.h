@@ -23,6 +23,7 @@ protected:
 	virtual void OnSomeDataSent(Net::Connection * connection) override;
 
 	void Poll();
+	void Quit();
 	i32 GetMinimumMessageSize() const;
 	i32 GetMessageSize(Net::Connection * connection) const;
 	virtual void ProcessCommand(Net::Connection * connection, const i32 message_size);
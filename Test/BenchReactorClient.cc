@@ -1,7 +1,7 @@
 #ifdef USE_VLD
 #include "vld.h"
 #endif
-#include <thread>
+#include <chrono>
 #include "Common/Allocator.h"
 #include "Reactor/EventReactor.h"
 #include "Reactor/SocketConnector.h"
@@ -35,10 +35,8 @@ static i32 kClientCount = 0;					// 计划连接数
 static i32 kPacketSize = 0;						// 计划数据包大小
 static i32 kBufferSize = 65536;					// 缓冲区大小
 static bool kLogDetail = false;					// 是否打印日志
-static bool kQuit = false;						// 事件循环退出
 static std::set<ClientUvData *> kClients;		// 所有套接字
 static i32 kIndex = 1;							// 套接字索引
-static std::set<ClientUvData *> kDeleteClients;	// 删除的套按字
 
 enum ConnectState { kConnecting, kConnected, kDisconnecting, kDisconnected };
 
@@ -50,7 +48,7 @@ public:
 	}
 	void CheckQuit() {
 		if (kDisconnectedCount + kConnectFailedCount >= kClientCount) {
-			kQuit = true;
+			GetReactor()->Stop();
 		}
 	}
 	i32 GetMinimumMessageSize() const {
@@ -93,13 +91,13 @@ public:
 		++kConnectFailedCount;
 		CheckQuit();
 		kClients.erase(this);
-		kDeleteClients.insert(this);
+		GetReactor()->DeferRelease(this);
 	}
 	virtual void OnDisconnected(bool is_remote) override {
 		++kDisconnectedCount;
 		CheckQuit();
 		kClients.erase(this);
-		kDeleteClients.insert(this);
+		GetReactor()->DeferRelease(this);
 	}
 	virtual void OnNewDataReceived() override {
 		bool done;
@@ -139,7 +137,7 @@ public:
 	i32 index_;
 };
 
-bool get_parameters(int argc, const char * * argv, std::string & host, i32 & port, i32 & client_count, i32 & packet_count, i32 & packet_size, bool & log_detail) {
+bool get_parameters(int argc, const char * * argv, std::string & host, i32 & port, i32 & client_count, i32 & packet_count, i32 & packet_size, bool & log_detail, Net::SocketOptions & options) {
 	client_count = 1;
 	packet_count = 1;
 	packet_size = 64;
@@ -148,11 +146,17 @@ bool get_parameters(int argc, const char * * argv, std::string & host, i32 & por
 		bool remove_flag = false;
 		const std::string arg_string = argv[i];
 		if (argc < 3 || arg_string == "-h" || arg_string == "--help" || arg_string == "/?") {
-			std::printf("Usage: BenchSocketClient host port [-c client_count] [-p packet_count] [-s packet_size] [--log]\n");
+			std::printf("Usage: BenchSocketClient host port [-c client_count] [-p packet_count] [-s packet_size] [--log] [socket options]\n");
 			std::printf("-c client_count: 客户端并发数量，默认 1\n");
 			std::printf("-p packet_count: 每个客户端发送数据包数量，默认 1\n");
 			std::printf("-s packet_size : 每个数据包大小，默认 64字节\n");
 			std::printf("--log          : 是否输出更多日志，默认 否\n");
+			std::printf("--lowat bytes  : TCP_NOTSENT_LOWAT，默认 不设置\n");
+			std::printf("--quickack     : 每次读后开启TCP_QUICKACK，默认 否\n");
+			std::printf("--cork         : 同一轮事件循环的写入用TCP_CORK合并，默认 否\n");
+			std::printf("--fastopen n   : TCP_FASTOPEN，默认 不设置\n");
+			std::printf("--pacing bytes : SO_MAX_PACING_RATE(字节/秒)，默认 不设置\n");
+			std::printf("--timeout msec : TCP_USER_TIMEOUT，默认 不设置\n");
 			return false;
 		} else if (arg_string == "-c") {
 			client_count = std::atoi(argv[i + 1]);
@@ -166,6 +170,24 @@ bool get_parameters(int argc, const char * * argv, std::string & host, i32 & por
 		} else if (arg_string == "--log") {
 			log_detail = true;
 			remove_flag = true;
+		} else if (arg_string == "--lowat") {
+			options.not_sent_lowat = std::atoi(argv[i + 1]);
+			remove_flag = true;
+		} else if (arg_string == "--quickack") {
+			options.quick_ack = true;
+			remove_flag = true;
+		} else if (arg_string == "--cork") {
+			options.cork = true;
+			remove_flag = true;
+		} else if (arg_string == "--fastopen") {
+			options.fast_open = std::atoi(argv[i + 1]);
+			remove_flag = true;
+		} else if (arg_string == "--pacing") {
+			options.max_pacing_rate = static_cast<u32>(std::strtoul(argv[i + 1], nullptr, 10));
+			remove_flag = true;
+		} else if (arg_string == "--timeout") {
+			options.user_timeout = std::atoi(argv[i + 1]);
+			remove_flag = true;
 		} else if (i == 1) {
 			host = arg_string;
 		} else if (i == 2) {
@@ -183,14 +205,15 @@ bool get_parameters(int argc, const char * * argv, std::string & host, i32 & por
 }
 
 void signal_cb(uv_signal_t * handle, int signum) {
-	kQuit = true;
+	static_cast<Net::EventReactor *>(handle->loop->data)->Stop();
 }
 
 int main(int argc, const char * * argv) {
 	std::string host;
 	i32 port;
 	i32 packet_count;
-	if (!get_parameters(argc, argv, host, port, kClientCount, packet_count, kPacketSize, kLogDetail)) {
+	Net::SocketOptions options;
+	if (!get_parameters(argc, argv, host, port, kClientCount, packet_count, kPacketSize, kLogDetail, options)) {
 		return 1;
 	}
 #ifndef _WIN32
@@ -210,6 +233,7 @@ int main(int argc, const char * * argv) {
 	std::memcpy(kMsgBuffer + kPacketSize - strlen("END"), "END", strlen("END"));
 	Net::EventReactor * reactor = new Net::EventReactor();
 	Net::SocketConnector * connector = new Net::SocketConnector(reactor);
+	connector->SetSocketOptions(options);
 	for (i32 i = 0; i < kClientCount; ++i) {
 		ClientUvData * client = new ClientUvData(packet_count);
 		kClients.insert(client);
@@ -221,18 +245,12 @@ int main(int argc, const char * * argv) {
 	uv_signal_init(reactor->GetUvLoop(), &handle2);
 	uv_signal_start_oneshot(&handle2, signal_cb, SIGTERM);
 	// 事件循环
-	while (!kQuit) {
-		reactor->Poll();
-		for (auto & it : kDeleteClients) {
-			delete it;
-		}
-		kDeleteClients.clear();
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-	}
+	reactor->Run();
 	// 结束
 	uv_close(reinterpret_cast<uv_handle_t *>(&handle1), nullptr);
 	uv_close(reinterpret_cast<uv_handle_t *>(&handle2), nullptr);
-	for (auto & it : kClients) {
+	std::set<ClientUvData *> clients(kClients);
+	for (auto & it : clients) {
 		it->Shutdown(true);
 	}
 	delete connector;
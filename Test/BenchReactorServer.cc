@@ -1,7 +1,7 @@
 #ifdef USE_VLD
 #include "vld.h"
 #endif
-#include <thread>
+#include <chrono>
 #include "Common/Allocator.h"
 #include "Reactor/EventReactor.h"
 #include "Reactor/SocketAcceptor.h"
@@ -34,10 +34,8 @@ static i32 kBufferSize = 65536;					// 缓冲区大小
 static bool kLogDetail = false;					// 是否打印日志
 static bool kAutoClose = false;					// 是否自动退出
 static bool kEcho = false;						// 是否回包
-static bool kQuit = false;						// 事件循环退出
 static std::set<ClientUvData *> kClients;		// 所有套接字
 static i32 kIndex = 1;							// 套接字索引
-static std::set<ClientUvData *> kDeleteClients;	// 删除的套按字
 
 enum ConnectState { kConnecting, kConnected, kDisconnecting, kDisconnected };
 
@@ -49,7 +47,7 @@ public:
 	}
 	void CheckQuit() {
 		if (kDisconnectedCount == kConnectedCount && kAutoClose) {
-			kQuit = true;
+			GetReactor()->Stop();
 		}
 	}
 	i32 GetMinimumMessageSize() const {
@@ -100,7 +98,7 @@ public:
 		++kDisconnectedCount;
 		CheckQuit();
 		kClients.erase(this);
-		kDeleteClients.insert(this);
+		GetReactor()->DeferRelease(this);
 	}
 	virtual void OnNewDataReceived() override {
 		bool done;
@@ -142,7 +140,7 @@ public:
 	}
 };
 
-bool get_parameters(int argc, const char * * argv, std::string & host, i32 & port, bool & log_detail, bool & auto_close, bool & echo) {
+bool get_parameters(int argc, const char * * argv, std::string & host, i32 & port, bool & log_detail, bool & auto_close, bool & echo, Net::SocketOptions & options) {
 	log_detail = false;
 	auto_close = false;
 	echo = false;
@@ -150,10 +148,16 @@ bool get_parameters(int argc, const char * * argv, std::string & host, i32 & por
 		bool remove_flag = false;
 		const std::string arg_string = argv[i];
 		if (argc < 3 || arg_string == "-h" || arg_string == "--help" || arg_string == "/?") {
-			std::printf("Usage: BenchServer host port [--log]\n");
+			std::printf("Usage: BenchServer host port [--log] [--auto] [--echo] [socket options]\n");
 			std::printf("--log          : 是否输出更多日志，默认 否\n");
 			std::printf("--auto         : 是否自动退出，默认 否\n");
 			std::printf("--echo         : 是否回包，默认 否\n");
+			std::printf("--lowat bytes  : TCP_NOTSENT_LOWAT，默认 不设置\n");
+			std::printf("--quickack     : 每次读后开启TCP_QUICKACK，默认 否\n");
+			std::printf("--cork         : 同一轮事件循环的写入用TCP_CORK合并，默认 否\n");
+			std::printf("--fastopen n   : TCP_FASTOPEN，默认 不设置\n");
+			std::printf("--pacing bytes : SO_MAX_PACING_RATE(字节/秒)，默认 不设置\n");
+			std::printf("--timeout msec : TCP_USER_TIMEOUT，默认 不设置\n");
 			return false;
 		} else if (arg_string == "--log") {
 			log_detail = true;
@@ -164,6 +168,24 @@ bool get_parameters(int argc, const char * * argv, std::string & host, i32 & por
 		} else if (arg_string == "--echo") {
 			echo = true;
 			remove_flag = true;
+		} else if (arg_string == "--lowat") {
+			options.not_sent_lowat = std::atoi(argv[i + 1]);
+			remove_flag = true;
+		} else if (arg_string == "--quickack") {
+			options.quick_ack = true;
+			remove_flag = true;
+		} else if (arg_string == "--cork") {
+			options.cork = true;
+			remove_flag = true;
+		} else if (arg_string == "--fastopen") {
+			options.fast_open = std::atoi(argv[i + 1]);
+			remove_flag = true;
+		} else if (arg_string == "--pacing") {
+			options.max_pacing_rate = static_cast<u32>(std::strtoul(argv[i + 1], nullptr, 10));
+			remove_flag = true;
+		} else if (arg_string == "--timeout") {
+			options.user_timeout = std::atoi(argv[i + 1]);
+			remove_flag = true;
 		} else if (i == 1) {
 			host = arg_string;
 		} else if (i == 2) {
@@ -181,13 +203,14 @@ bool get_parameters(int argc, const char * * argv, std::string & host, i32 & por
 }
 
 void signal_cb(uv_signal_t * handle, int signum) {
-	kQuit = true;
+	static_cast<Net::EventReactor *>(handle->loop->data)->Stop();
 }
 
 int main(int argc, const char * * argv) {
 	std::string host;
 	i32 port;
-	if (!get_parameters(argc, argv, host, port, kLogDetail, kAutoClose, kEcho)) {
+	Net::SocketOptions options;
+	if (!get_parameters(argc, argv, host, port, kLogDetail, kAutoClose, kEcho, options)) {
 		return 1;
 	}
 #ifndef _WIN32
@@ -197,6 +220,7 @@ int main(int argc, const char * * argv) {
 	// 初始化
 	Net::EventReactor * reactor = new Net::EventReactor();
 	ServerUvData * server = new ServerUvData(reactor);
+	server->SetSocketOptions(options);
 	if (!server->Open(Net::SocketAddress(host, port), 512)) {
 		delete server;
 		delete reactor;
@@ -208,18 +232,12 @@ int main(int argc, const char * * argv) {
 	uv_signal_init(reactor->GetUvLoop(), &handle2);
 	uv_signal_start_oneshot(&handle2, signal_cb, SIGTERM);
 	// 事件循环
-	while (!kQuit) {
-		reactor->Poll();
-		for (auto & it : kDeleteClients) {
-			delete it;
-		}
-		kDeleteClients.clear();
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-	}
+	reactor->Run();
 	// 结束
 	uv_close(reinterpret_cast<uv_handle_t *>(&handle1), nullptr);
 	uv_close(reinterpret_cast<uv_handle_t *>(&handle2), nullptr);
-	for (auto & it : kClients) {
+	std::set<ClientUvData *> clients(kClients);
+	for (auto & it : clients) {
 		it->Shutdown(true);
 	}
 	delete server;
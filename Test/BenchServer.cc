@@ -19,14 +19,14 @@ void BenchServer::Run(const std::string & address, i32 port) {
 void BenchServer::OnConnected(Net::Connection * connection) {
 	++connected_counter_;
 	if (disconnected_counter_ == connected_counter_ && auto_close_) {
-		quit_ = true;
+		Quit();
 	}
 }
 
 void BenchServer::OnDisconnected(Net::Connection * connection, bool is_remote) {
 	++disconnected_counter_;
 	if (disconnected_counter_ == connected_counter_ && auto_close_) {
-		quit_ = true;
+		Quit();
 	}
 }
 
@@ -0,0 +1,103 @@
+#include "Reactor/StatsSegment.h"
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// 只读查看StatsSegment共享内存, 用法: netstat <name> [interval_ms] [count] [top]
+// count为0时一直刷新
+
+static double Rate(i64 delta, u64 elapsed) {
+	return elapsed > 0 ? static_cast<double>(delta) * 1e9 / static_cast<double>(elapsed) : 0;
+}
+
+static const i8 * Bytes(double bytes, i8 * buffer, size_t size) {
+	const i8 * units[] = { "B", "KB", "MB", "GB", "TB" };
+	i32 unit = 0;
+	while (bytes >= 1024 && unit < 4) {
+		bytes /= 1024;
+		++unit;
+	}
+	std::snprintf(buffer, size, "%.1f%s", bytes, units[unit]);
+	return buffer;
+}
+
+static void Print(const Net::StatsSegment::Data & data, const Net::StatsSegment::Data & last, i32 top) {
+	const Net::StatsSegment::ReactorRecord & reactor = data.reactor;
+	u64 elapsed = last.time > 0 && data.time > last.time ? data.time - last.time : 0;
+	i8 in[32], out[32], buffered[32], pool[32];
+	std::printf("pid %d  publish #%lld  interval %dms\n", data.pid, static_cast<long long>(data.publishes), data.interval);
+	std::printf("loop   %.0f iter/s  p50 %lluus  p99 %lluus  max %lluus  blocked p50 %lluus  busy p99 %lluus  write p99 %lluus\n",
+		Rate(reactor.iterations - last.reactor.iterations, elapsed),
+		static_cast<unsigned long long>(reactor.iteration_p50 / 1000), static_cast<unsigned long long>(reactor.iteration_p99 / 1000),
+		static_cast<unsigned long long>(reactor.iteration_max / 1000), static_cast<unsigned long long>(reactor.blocked_p50 / 1000),
+		static_cast<unsigned long long>(reactor.busy_p99 / 1000), static_cast<unsigned long long>(reactor.write_latency_p99 / 1000));
+	std::printf("conns  %lld  in %s/s  out %s/s  out buffered %s  write queue %lld  saturated %lld  pool %s\n",
+		static_cast<long long>(reactor.connections),
+		Bytes(Rate(reactor.bytes_in - last.reactor.bytes_in, elapsed), in, sizeof(in)),
+		Bytes(Rate(reactor.bytes_out - last.reactor.bytes_out, elapsed), out, sizeof(out)),
+		Bytes(static_cast<double>(reactor.out_buffered), buffered, sizeof(buffered)),
+		static_cast<long long>(reactor.write_queue), static_cast<long long>(reactor.saturated),
+		Bytes(static_cast<double>(reactor.pool_bytes), pool, sizeof(pool)));
+
+	for (i32 i = 0; i < data.acceptor_count; ++i) {
+		const Net::StatsSegment::AcceptorRecord & record = data.acceptors[i];
+		i64 previous = i < last.acceptor_count ? last.acceptors[i].accepted : record.accepted;
+		std::printf("accept %-16s %-24s %.0f/s  total %lld  rejected %lld  limited %lld/%lld  errors %lld  exhausted %lld  shed %lld%s\n",
+			record.label, record.address, Rate(record.accepted - previous, elapsed), static_cast<long long>(record.accepted),
+			static_cast<long long>(record.rejected), static_cast<long long>(record.rate_limited), static_cast<long long>(record.over_limit),
+			static_cast<long long>(record.errors), static_cast<long long>(record.exhausted), static_cast<long long>(record.shed),
+			record.paused ? "  PAUSED" : "");
+	}
+	for (i32 i = 0; i < data.pool_count; ++i) {
+		const Net::StatsSegment::PoolRecord & record = data.pools[i];
+		std::printf("pool   %-16s %-24s idle %d  leased %d  connecting %d  failures %d\n",
+			record.label, record.address, record.idle, record.leased, record.connecting, record.failures);
+	}
+
+	std::printf("%-40s %12s %12s %10s %8s %8s %10s %10s\n", "peer", "rate", "total", "out buf", "out %", "queue", "rtt(us)", "idle(ms)");
+	for (i32 i = 0; i < data.connection_count && i < top; ++i) {
+		const Net::StatsSegment::ConnectionRecord & record = data.connections[i];
+		i8 rate[32], total[32], out_buffered[32];
+		u64 idle = record.read_idle < record.write_idle ? record.read_idle : record.write_idle;
+		std::printf("%-40s %10s/s %12s %10s %7.1f%% %8d %10u %10llu\n",
+			record.peer, Bytes(data.interval > 0 ? record.bytes_delta * 1000.0 / data.interval : 0, rate, sizeof(rate)),
+			Bytes(static_cast<double>(record.bytes_in + record.bytes_out), total, sizeof(total)),
+			Bytes(record.out_buffered, out_buffered, sizeof(out_buffered)),
+			record.out_capacity > 0 ? record.out_buffered * 100.0 / record.out_capacity : 0, record.write_queue, record.rtt,
+			static_cast<unsigned long long>(idle));
+	}
+	std::printf("\n");
+}
+
+int main(int argc, const char * * argv) {
+	if (argc < 2) {
+		std::printf("usage: %s <name> [interval_ms] [count] [top]\n", argv[0]);
+		return 1;
+	}
+	i32 interval = argc > 2 ? std::atoi(argv[2]) : 1000;
+	i32 count = argc > 3 ? std::atoi(argv[3]) : 0;
+	i32 top = argc > 4 ? std::atoi(argv[4]) : 10;
+	if (interval <= 0) {
+		interval = 1000;
+	}
+
+	const Net::StatsSegment::Layout * layout = Net::StatsSegment::Attach(argv[1]);
+	if (!layout) {
+		std::printf("attach %s failed\n", argv[1]);
+		return 1;
+	}
+	Net::StatsSegment::Data last, data;
+	std::memset(&last, 0, sizeof(last));
+	for (i32 i = 0; 0 == count || i < count; ++i) {
+		if (Net::StatsSegment::Read(layout, data)) {
+			Print(data, last, top);
+			last = data;
+		} else {
+			std::printf("read %s failed\n", argv[1]);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+	}
+	Net::StatsSegment::Detach(layout);
+	return 0;
+}
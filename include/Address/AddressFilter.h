@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Address_AddressFilter_INCLUDED
+#define Net_Address_AddressFilter_INCLUDED
+
+#include "Common.h"
+#include "CObject.h"
+#include "Address/IPAddress.h"
+#include <string>
+#include <vector>
+
+namespace Net {
+
+// IPv4/IPv6 CIDR允许/拒绝列表, 按最长前缀匹配
+// 规则保存在路径压缩的前缀树(Patricia)中, 节点连续存放在数组里, 查找只需一次自顶向下遍历
+// 构建完成后只读, 可在多个线程同时查找, 热更新时构建新的过滤器整体替换
+class COMMON_EXTERN AddressFilter : public Common::CObject {
+public:
+	// 默认允许没有匹配规则的地址
+	explicit AddressFilter(bool allow_default = true);
+	virtual ~AddressFilter();
+
+	// "10.0.0.0/8", "2001:db8::/32", 没有前缀长度时按单个地址
+	bool Allow(const i8 * cidr);
+	bool Deny(const i8 * cidr);
+	bool Add(const IPAddress & address, i32 prefix, bool allow);
+	// 每行"allow|deny CIDR", #开始注释, 返回规则数, 打开失败或有非法行时返回负数错误码
+	i32 Load(const std::string & path);
+	void Clear();
+
+	// IPv4映射的IPv6地址(::ffff:a.b.c.d)按IPv4规则匹配
+	bool IsAllowed(const IPAddress & address) const;
+	void SetDefault(bool allow);
+	bool GetDefault() const;
+	i32 GetRuleCount() const;
+
+private:
+	struct Node {
+		u32 key[4];
+		i32 length;
+		i32 child[2];
+		i32 action;		// 1允许, 0拒绝, -1表示中间节点没有规则
+	};
+
+	bool Add(const i8 * cidr, bool allow);
+	void Insert(i32 & root, const u32 * key, i32 length, bool allow);
+	i32 Lookup(i32 root, const u32 * key, i32 length) const;
+
+private:
+	std::vector<Node> nodes_;
+	i32 root4_;
+	i32 root6_;
+	i32 rules_;
+	bool allow_default_;
+};
+
+inline void AddressFilter::SetDefault(bool allow) {
+	allow_default_ = allow;
+}
+
+inline bool AddressFilter::GetDefault() const {
+	return allow_default_;
+}
+
+inline i32 AddressFilter::GetRuleCount() const {
+	return rules_;
+}
+
+}
+
+#endif
\ No newline at end of file
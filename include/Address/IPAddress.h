@@ -22,27 +22,29 @@
  * SOFTWARE.
  */
 
+
 #ifndef Net_Address_IPAddress_INCLUDED
 #define Net_Address_IPAddress_INCLUDED
 
 #include "Common.h"
-#include "CObject.h"
 #include "SDString.h"
 #include "Address/IPAddressImpl.h"
 #include "uv.h"
+#include <functional>
 
 namespace Net {
 
-class COMMON_EXTERN IPAddress : public Common::CObject {
+// 值类型, 可按字节拷贝, 访问函数均为内联
+// 未使用的地址字节保持为0, 相等比较和哈希不受之前内容影响
+class COMMON_EXTERN IPAddress {
 public:
 	IPAddress();
 	explicit IPAddress(const i8 * ip);
 	IPAddress(const void * addr, socklen_t length, u32 scope = 0);
-	IPAddress(const IPAddress & other);
-	IPAddress & operator=(const IPAddress & other);
-	virtual ~IPAddress();
 
 	Common::SDString ToString() const;
+	// 写入调用方提供的缓冲区(含结尾0), 返回字符数, 缓冲区不足返回UV_ENOSPC
+	i32 Format(i8 * buf, i32 size) const;
 	socklen_t Length() const;
 	const void * Addr() const;
 	AddressFamily::eFamily Family() const;
@@ -50,58 +52,90 @@ public:
 	u32 Scope() const;
 	bool operator==(const IPAddress & other) const;
 	bool operator!=(const IPAddress & other) const;
+	u64 Hash() const;
 
 	static IPAddress Parse(const i8 * ip);
 	static bool TryParse(const i8 * ip, IPAddress & result);
+	// 解析不以0结尾的文本, 不申请内存
+	static bool TryParse(const i8 * ip, i32 length, IPAddress & result);
+	// 64位混合, 供地址类哈希使用
+	static u64 HashMix(u64 hash, u64 value);
 
 	static const AddressFamily::eFamily IPv4 = AddressFamily::IPv4;
 	static const AddressFamily::eFamily IPv6 = AddressFamily::IPv6;
+	// Format()需要的最大缓冲区, 同INET6_ADDRSTRLEN
+	static const i32 kMaxStringLength = 46;
 
 private:
-	IPAddressImpl * Impl() const;
-	void NewIPv4();
-	void NewIPv4(const void * addr);
-	void NewIPv6();
-	void NewIPv6(const void * addr, u32 scope);
-	void Destroy();
-	i8 * Storage();
+	void SetIPv4(const void * addr);
+	void SetIPv6(const void * addr, u32 scope);
 
 private:
-	i8 memory_[sizeof(IPv6AddressImpl)];
+	union {
+		struct in_addr v4;
+		struct in6_addr v6;
+		u32 words[4];
+	} addr_;
+	u32 scope_;
+	AddressFamily::eFamily family_;
 };
 
-inline Common::SDString IPAddress::ToString() const {
-	return Impl()->ToString();
-}
-
 inline socklen_t IPAddress::Length() const {
-	return Impl()->Length();
+	return IPv4 == family_ ? sizeof(addr_.v4) : sizeof(addr_.v6);
 }
 
 inline const void * IPAddress::Addr() const {
-	return Impl()->Addr();
+	return &addr_;
 }
 
 inline AddressFamily::eFamily IPAddress::Family() const {
-	return Impl()->Family();
+	return family_;
 }
 
 inline i32 IPAddress::AF() const {
-	return Impl()->AF();
+	return IPv4 == family_ ? AF_INET : AF_INET6;
 }
 
 inline u32 IPAddress::Scope() const {
-	return Impl()->Scope();
+	return scope_;
+}
+
+inline bool IPAddress::operator==(const IPAddress & other) const {
+	return family_ == other.family_ && scope_ == other.scope_ && 0 == std::memcmp(&addr_, &other.addr_, sizeof(addr_));
+}
+
+inline bool IPAddress::operator!=(const IPAddress & other) const {
+	return !(*this == other);
+}
+
+inline u64 IPAddress::HashMix(u64 hash, u64 value) {
+	hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	return hash;
 }
 
-inline IPAddressImpl * IPAddress::Impl() const {
-	return reinterpret_cast<IPAddressImpl *>(const_cast<i8 *>(memory_));
+inline u64 IPAddress::Hash() const {
+	u64 hash = HashMix(family_, addr_.words[0]);
+	if (IPv6 == family_) {
+		hash = HashMix(hash, (static_cast<u64>(addr_.words[1]) << 32) | addr_.words[2]);
+		hash = HashMix(hash, (static_cast<u64>(addr_.words[3]) << 32) | scope_);
+	}
+	return hash;
 }
 
-inline i8 * IPAddress::Storage() {
-	return memory_;
 }
 
+namespace std {
+
+template <>
+struct hash<Net::IPAddress> {
+	size_t operator()(const Net::IPAddress & address) const {
+		return static_cast<size_t>(address.Hash());
+	}
+};
+
 }
 
 #endif
\ No newline at end of file
@@ -22,27 +22,27 @@
  * SOFTWARE.
  */
 
+
 #ifndef Net_Address_SocketAddress_INCLUDED
 #define Net_Address_SocketAddress_INCLUDED
 
 #include "Common.h"
-#include "CObject.h"
 #include "SDString.h"
 #include "Address/SocketAddressImpl.h"
 #include "uv.h"
+#include <functional>
 
 namespace Net {
 
-class COMMON_EXTERN SocketAddress : public Common::CObject {
+// 值类型, 内联保存sockaddr_in/sockaddr_in6, 可按字节拷贝, 访问函数均为内联
+// 可直接作为连接表(对端地址, 四元组)的键
+class COMMON_EXTERN SocketAddress {
 public:
 	SocketAddress();
 	explicit SocketAddress(u16 port);
 	SocketAddress(const i8 * ip, u16 port);
 	SocketAddress(const IPAddress & host, u16 port);
 	SocketAddress(const struct sockaddr * addr, socklen_t length);
-	SocketAddress(const SocketAddress & other);
-	SocketAddress & operator=(const SocketAddress & other);
-	virtual ~SocketAddress();
 
 	IPAddress Host() const;
 	u16 Port() const;
@@ -51,61 +51,90 @@ public:
 	i32 AF() const;
 	AddressFamily::eFamily Family() const;
 	Common::SDString ToString() const;
+	// 写入调用方提供的缓冲区(含结尾0), 返回字符数, 缓冲区不足返回UV_ENOSPC
+	i32 Format(i8 * buf, i32 size) const;
 	bool operator==(const SocketAddress & other) const;
 	bool operator!=(const SocketAddress & other) const;
+	u64 Hash() const;
+
+	// "[IPv6]:65535"
+	static const i32 kMaxStringLength = IPAddress::kMaxStringLength + 8;
 
 protected:
 	void Init(const IPAddress & host, u16 port);
 
 private:
-	SocketAddressImpl * Impl() const;
-
-	void NewIPv4();
-	void NewIPv4(const struct sockaddr_in * addr);
-	void NewIPv6(const struct sockaddr_in6 * addr);
-	void Destroy();
-	i8 * Storage();
-
-private:
-	i8 memory_[sizeof(IPv6SocketAddressImpl)];
+	union {
+		struct sockaddr sa;
+		struct sockaddr_in v4;
+		struct sockaddr_in6 v6;
+	} addr_;
 };
 
 inline IPAddress SocketAddress::Host() const {
-	return Impl()->Host();
+	if (AF_INET == addr_.sa.sa_family) {
+		return IPAddress(&addr_.v4.sin_addr, sizeof(addr_.v4.sin_addr));
+	}
+	return IPAddress(&addr_.v6.sin6_addr, sizeof(addr_.v6.sin6_addr), addr_.v6.sin6_scope_id);
 }
 
 inline u16 SocketAddress::Port() const {
-	return Impl()->Port();
+	return ntohs(AF_INET == addr_.sa.sa_family ? addr_.v4.sin_port : addr_.v6.sin6_port);
 }
 
 inline socklen_t SocketAddress::Length() const {
-	return Impl()->Length();
+	return AF_INET == addr_.sa.sa_family ? sizeof(addr_.v4) : sizeof(addr_.v6);
 }
 
 inline const sockaddr * SocketAddress::Addr() const {
-	return Impl()->Addr();
+	return &addr_.sa;
 }
 
 inline i32 SocketAddress::AF() const {
-	return Impl()->AF();
+	return addr_.sa.sa_family;
 }
 
 inline AddressFamily::eFamily SocketAddress::Family() const {
-	return Impl()->Family();
+	return AF_INET == addr_.sa.sa_family ? AddressFamily::IPv4 : AddressFamily::IPv6;
 }
 
-inline Common::SDString SocketAddress::ToString() const {
-	return Impl()->ToString();
+inline bool SocketAddress::operator==(const SocketAddress & other) const {
+	if (addr_.sa.sa_family != other.addr_.sa.sa_family) {
+		return false;
+	}
+	if (AF_INET == addr_.sa.sa_family) {
+		return addr_.v4.sin_port == other.addr_.v4.sin_port && addr_.v4.sin_addr.s_addr == other.addr_.v4.sin_addr.s_addr;
+	}
+	return addr_.v6.sin6_port == other.addr_.v6.sin6_port && addr_.v6.sin6_scope_id == other.addr_.v6.sin6_scope_id
+		&& 0 == std::memcmp(&addr_.v6.sin6_addr, &other.addr_.v6.sin6_addr, sizeof(addr_.v6.sin6_addr));
 }
 
-inline SocketAddressImpl * SocketAddress::Impl() const {
-	return reinterpret_cast<SocketAddressImpl *>(const_cast<i8 *>(memory_));
+inline bool SocketAddress::operator!=(const SocketAddress & other) const {
+	return !(*this == other);
 }
 
-inline i8 * SocketAddress::Storage() {
-	return memory_;
+inline u64 SocketAddress::Hash() const {
+	if (AF_INET == addr_.sa.sa_family) {
+		return IPAddress::HashMix(addr_.v4.sin_port, addr_.v4.sin_addr.s_addr);
+	}
+	u64 words[2];
+	std::memcpy(words, &addr_.v6.sin6_addr, sizeof(words));
+	u64 hash = IPAddress::HashMix(addr_.v6.sin6_port, words[0]);
+	hash = IPAddress::HashMix(hash, words[1]);
+	return IPAddress::HashMix(hash, addr_.v6.sin6_scope_id);
 }
 
 }
 
+namespace std {
+
+template <>
+struct hash<Net::SocketAddress> {
+	size_t operator()(const Net::SocketAddress & address) const {
+		return static_cast<size_t>(address.Hash());
+	}
+};
+
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef Net_Common_BufferPool_INCLUDED
+#define Net_Common_BufferPool_INCLUDED
+
+#include "Common.h"
+
+namespace Net {
+
+// 按大小分级的内存池
+// 每个线程缓存少量空闲块, 超出后批量归还到全局链表, 全局链表为空时才向堆申请
+// 超过最大分级的申请直接走jc_malloc
+class COMMON_EXTERN BufferPool {
+public:
+	struct ClassStats {
+		i32 block_size;		// 块大小
+		i64 allocs;			// 申请次数
+		i64 frees;			// 释放次数
+		i64 local_hits;		// 线程缓存命中次数
+		i64 central_hits;	// 全局链表命中次数
+		i64 heap_allocs;	// 向堆(或大页)申请次数
+		i64 in_use;			// 使用中的块数
+		i64 central_cached;	// 全局链表中的空闲块数
+	};
+
+	static void * Allocate(i32 size);
+	static void DeAllocate(void * ptr);
+
+	// 开启后新申请的块从2MB大页中切分, 已切分的块不再归还系统
+	static void SetHugePages(bool enable);
+	static bool IsHugePages();
+
+	static i32 GetClassCount();
+	static bool GetClassStats(i32 index, ClassStats & stats);
+
+	// 归还当前线程缓存, 并释放全局链表中来自堆的空闲块
+	static void Trim();
+
+	static const i32 kMinBlockShift = 6;
+	static const i32 kClassCount = 11;
+	static const i32 kMaxBlockSize = 1 << (kMinBlockShift + kClassCount - 1);
+	static const i32 kLocalCacheMax = 64;
+	static const i32 kTransferBatch = 32;
+
+private:
+	BufferPool() = delete;
+};
+
+}
+
+#endif
\ No newline at end of file
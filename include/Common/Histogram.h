@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Common_Histogram_INCLUDED
+#define Net_Common_Histogram_INCLUDED
+
+#include "Common.h"
+#include <atomic>
+
+namespace Net {
+
+// 对数分桶的直方图(HDR风格), 每个2的幂区间再等分16份, 相对误差不超过1/16
+// 只允许一个线程写入, 写入不加锁也不用原子加法, 其他线程可随时复制出快照读取
+class COMMON_EXTERN Histogram {
+public:
+	Histogram();
+	Histogram(const Histogram & other);
+	Histogram & operator=(const Histogram & other);
+
+	void Record(u64 value);
+	// 只能在写入线程调用
+	void Reset();
+	// 合并快照, 不能与Record()并发
+	void Merge(const Histogram & other);
+
+	i64 Count() const;
+	u64 Min() const;
+	u64 Max() const;
+	u64 Sum() const;
+	double Mean() const;
+	// 不小于percentile%样本的最小桶上界, 没有样本时返回0
+	u64 Percentile(double percentile) const;
+
+	static i32 BucketOf(u64 value);
+	static u64 LowerBoundOf(i32 index);
+	static u64 UpperBoundOf(i32 index);
+
+	static const i32 kSubBucketBits = 4;
+	static const i32 kSubBucketCount = 1 << kSubBucketBits;
+	// 2^48纳秒约3天, 更大的值计入最后一个桶
+	static const i32 kMaxExponent = 47;
+	static const i32 kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+
+private:
+	void CopyFrom(const Histogram & other);
+
+private:
+	std::atomic<u64> counts_[kBucketCount];
+	std::atomic<i64> count_;
+	std::atomic<u64> min_;
+	std::atomic<u64> max_;
+	std::atomic<u64> sum_;
+};
+
+inline i32 Histogram::BucketOf(u64 value) {
+	if (value < static_cast<u64>(kSubBucketCount)) {
+		return static_cast<i32>(value);
+	}
+#if defined(__GNUC__) || defined(__clang__)
+	i32 exponent = 63 - __builtin_clzll(value);
+#else
+	i32 exponent = 0;
+	for (u64 v = value; v > 1; v >>= 1) {
+		++exponent;
+	}
+#endif
+	if (exponent > kMaxExponent) {
+		return kBucketCount - 1;
+	}
+	i32 sub = static_cast<i32>(value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+	return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub;
+}
+
+inline void Histogram::Record(u64 value) {
+	std::atomic<u64> & bucket = counts_[BucketOf(value)];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if (value < min_.load(std::memory_order_relaxed)) {
+		min_.store(value, std::memory_order_relaxed);
+	}
+	if (value > max_.load(std::memory_order_relaxed)) {
+		max_.store(value, std::memory_order_relaxed);
+	}
+	sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+inline i64 Histogram::Count() const {
+	return count_.load(std::memory_order_acquire);
+}
+
+inline u64 Histogram::Min() const {
+	return Count() > 0 ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+inline u64 Histogram::Max() const {
+	return max_.load(std::memory_order_relaxed);
+}
+
+inline u64 Histogram::Sum() const {
+	return sum_.load(std::memory_order_relaxed);
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,176 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Common_LoopStats_INCLUDED
+#define Net_Common_LoopStats_INCLUDED
+
+#include "Common.h"
+#include "Common/Histogram.h"
+#include "Common/TraceRecorder.h"
+#include "uv.h"
+
+namespace Net {
+
+// 事件循环耗时统计, 时间单位纳秒
+// 由所属事件循环线程写入, 通过线程局部的当前实例让套接字回调计时, 不需要加锁
+class COMMON_EXTERN LoopStats {
+public:
+	enum eCallback {
+		kRead,
+		kWrite,
+		kAccept,
+		kConnect,
+		kClose,
+		kCallbackCount,
+	};
+
+	struct Snapshot {
+		i64 iterations;						// 循环次数
+		Histogram iteration;				// 每轮耗时
+		Histogram blocked;					// 每轮阻塞在epoll等待上的耗时
+		Histogram busy;						// 每轮执行回调的耗时
+		Histogram events;					// 每轮处理的套接字回调数
+		Histogram callbacks[kCallbackCount];	// 各类回调耗时
+		Histogram write_latency;			// 抽样的写入延迟, 从Write()到写请求完成
+	};
+
+	// 在作用域内设为当前线程的统计实例, 可嵌套
+	class COMMON_EXTERN Scope {
+	public:
+		explicit Scope(LoopStats * stats);
+		~Scope();
+
+	private:
+		LoopStats * stats_;
+		LoopStats * previous_;
+	};
+
+	// 统计一次回调耗时, 当前线程没有统计实例时不计时, 设置了TraceRecorder时同时记录开始和结束事件
+	class CallbackTimer {
+	public:
+		explicit CallbackTimer(eCallback type);
+		~CallbackTimer();
+
+	private:
+		LoopStats * stats_;
+		eCallback type_;
+		u64 start_;
+	};
+
+	LoopStats();
+
+	// 进入事件循环时调用, 开始新一轮计时
+	void Enter(u64 now);
+	// 退出事件循环时调用
+	void Leave(u64 now);
+	// prepare阶段(即将进入epoll等待)和check阶段(epoll返回并处理完I/O回调)调用
+	void BeginPoll(u64 now);
+	void EndPoll(u64 now);
+	// 本轮结束, 在check阶段的工作完成后调用
+	void EndIteration(u64 now);
+	void RecordCallback(eCallback type, u64 elapsed);
+	void RecordWriteLatency(u64 elapsed);
+	// 本轮epoll返回的时间, 取等待期间第一个I/O回调开始的时间, 还没有回调时为0
+	u64 GetPollReady() const;
+	// 循环和回调的时间线, nullptr关闭, 只能在事件循环线程调用
+	void SetTrace(TraceRecorder * trace);
+	TraceRecorder * GetTrace() const;
+	// 可在任意线程调用
+	void GetSnapshot(Snapshot & snapshot) const;
+
+	static LoopStats * Current();
+	static const i8 * CallbackName(eCallback type);
+
+private:
+	LoopStats(LoopStats &&) = delete;
+	LoopStats(const LoopStats &) = delete;
+	LoopStats & operator=(LoopStats &&) = delete;
+	LoopStats & operator=(const LoopStats &) = delete;
+
+private:
+	Histogram iteration_;
+	Histogram blocked_;
+	Histogram busy_;
+	Histogram events_;
+	Histogram callbacks_[kCallbackCount];
+	Histogram write_latency_;
+	u64 iteration_start_;
+	u64 poll_start_;
+	u64 poll_ready_;
+	u64 poll_blocked_;
+	u64 callback_time_;
+	u64 poll_callback_time_;
+	i64 events_pending_;
+	bool polling_;
+	TraceRecorder * trace_;
+};
+
+inline void LoopStats::RecordCallback(eCallback type, u64 elapsed) {
+	callbacks_[type].Record(elapsed);
+	callback_time_ += elapsed;
+	++events_pending_;
+}
+
+inline void LoopStats::RecordWriteLatency(u64 elapsed) {
+	write_latency_.Record(elapsed);
+}
+
+inline u64 LoopStats::GetPollReady() const {
+	return poll_ready_;
+}
+
+inline void LoopStats::SetTrace(TraceRecorder * trace) {
+	trace_ = trace;
+}
+
+inline TraceRecorder * LoopStats::GetTrace() const {
+	return trace_;
+}
+
+inline LoopStats::CallbackTimer::CallbackTimer(eCallback type) : stats_(LoopStats::Current()), type_(type), start_(0) {
+	if (stats_) {
+		start_ = uv_hrtime();
+		if (stats_->polling_ && 0 == stats_->poll_ready_) {
+			stats_->poll_ready_ = start_;
+		}
+		if (stats_->trace_) {
+			stats_->trace_->Record(TraceRecorder::kBegin, CallbackName(type_), 0, start_);
+		}
+	}
+}
+
+inline LoopStats::CallbackTimer::~CallbackTimer() {
+	if (stats_) {
+		u64 now = uv_hrtime();
+		stats_->RecordCallback(type_, now - start_);
+		if (stats_->trace_) {
+			stats_->trace_->Record(TraceRecorder::kEnd, CallbackName(type_), 0, now);
+		}
+	}
+}
+
+}
+
+#endif
\ No newline at end of file
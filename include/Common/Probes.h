@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef Net_Common_Probes_INCLUDED
+#define Net_Common_Probes_INCLUDED
+
+// USDT静态探针, provider为libnet, 未挂载时只是一条nop指令
+// 编译选项PROBES打开且找到sys/sdt.h时定义NET_PROBES, 否则探针展开为空, 参数不求值
+// 例: bpftrace -e 'usdt:./libnet.so:libnet:read { @[arg0] = sum(arg1); }'
+#if defined(NET_PROBES) && defined(__linux__)
+#include <sys/sdt.h>
+#define NET_PROBE(name) DTRACE_PROBE(libnet, name)
+#define NET_PROBE1(name, a1) DTRACE_PROBE1(libnet, name, a1)
+#define NET_PROBE2(name, a1, a2) DTRACE_PROBE2(libnet, name, a1, a2)
+#define NET_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(libnet, name, a1, a2, a3)
+#define NET_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(libnet, name, a1, a2, a3, a4)
+#else
+#define NET_PROBE(name) do {} while (0)
+#define NET_PROBE1(name, a1) do {} while (0)
+#define NET_PROBE2(name, a1, a2) do {} while (0)
+#define NET_PROBE3(name, a1, a2, a3) do {} while (0)
+#define NET_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+#endif
+
+// 探针及参数:
+// read(UvData *, nread): SocketImpl::read_cb
+// write__done(UvData *, status, arg): SocketImpl::write_cb, SocketConnection的arg为字节数
+// connect(UvData *, status): SocketImpl::connect_cb
+// close(UvData *): SocketImpl::close_cb
+// accept(SocketAcceptor *, status): SocketAcceptor::AcceptCallback
+// accept__established(SocketAcceptor *, SocketConnection *): 连接接入成功
+// write(SocketConnection *, len, result): SocketConnection::Write, result为写入字节数或错误码
+// write__nobufs(SocketConnection *, len, writable, buffered): 发送缓冲区不足, 写入被拒绝
+// poll__begin(EventReactor *): 进入IO轮询前
+// poll__end(EventReactor *): IO轮询返回后
+// iteration__end(EventReactor *): 本轮事件循环结束
+
+#endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef Net_Common_TraceRecorder_INCLUDED
+#define Net_Common_TraceRecorder_INCLUDED
+
+#include "Common.h"
+#include "uv.h"
+#include <atomic>
+
+namespace Net {
+
+// 事件循环的时间线记录, 固定容量的环形缓冲区, 写满后覆盖最旧的事件
+// 只允许一个线程写入, 写入不加锁, 其他线程可随时复制出事件, 正在被覆盖的事件会被跳过
+// 可导出为Chrome trace JSON, 用chrome://tracing或Perfetto UI打开
+class COMMON_EXTERN TraceRecorder {
+public:
+	enum ePhase {
+		kBegin = 'B',
+		kEnd = 'E',
+		kInstant = 'i',
+	};
+
+	struct Event {
+		u64 time;			// uv_hrtime(), 纳秒
+		const i8 * name;	// 必须是静态字符串
+		i64 arg;
+		i8 phase;
+	};
+
+	// 容量向上取整为2的幂
+	explicit TraceRecorder(i32 capacity = kDefaultCapacity);
+	~TraceRecorder();
+
+	void Record(ePhase phase, const i8 * name, i64 arg, u64 time);
+	void Begin(const i8 * name, i64 arg = 0);
+	void End(const i8 * name, i64 arg = 0);
+	void Instant(const i8 * name, i64 arg = 0);
+
+	// 按时间顺序复制出仍在缓冲区中的事件, 可在任意线程调用
+	i32 GetEvents(std::vector<Event> & events) const;
+	// 写出Chrome trace JSON, 返回事件数或错误码
+	i32 WriteChromeTrace(const std::string & path, i32 pid, i32 tid) const;
+	i32 GetCapacity() const;
+	// 累计写入的事件数, 超过容量的部分已被覆盖
+	u64 GetRecorded() const;
+
+	static const i32 kDefaultCapacity = 1 << 16;
+
+private:
+	TraceRecorder(TraceRecorder &&) = delete;
+	TraceRecorder(const TraceRecorder &) = delete;
+	TraceRecorder & operator=(TraceRecorder &&) = delete;
+	TraceRecorder & operator=(const TraceRecorder &) = delete;
+
+private:
+	// seq为写入序号+1, 读取前后不变才说明事件完整
+	struct Slot {
+		std::atomic<u64> seq;
+		std::atomic<u64> time;
+		std::atomic<const i8 *> name;
+		std::atomic<i64> arg;
+		std::atomic<i8> phase;
+	};
+
+	Slot * slots_;
+	u64 mask_;
+	std::atomic<u64> head_;
+};
+
+inline void TraceRecorder::Record(ePhase phase, const i8 * name, i64 arg, u64 time) {
+	u64 index = head_.load(std::memory_order_relaxed);
+	Slot & slot = slots_[index & mask_];
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.time.store(time, std::memory_order_relaxed);
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.arg.store(arg, std::memory_order_relaxed);
+	slot.phase.store(static_cast<i8>(phase), std::memory_order_relaxed);
+	slot.seq.store(index + 1, std::memory_order_release);
+	head_.store(index + 1, std::memory_order_release);
+}
+
+inline void TraceRecorder::Begin(const i8 * name, i64 arg) {
+	Record(kBegin, name, arg, uv_hrtime());
+}
+
+inline void TraceRecorder::End(const i8 * name, i64 arg) {
+	Record(kEnd, name, arg, uv_hrtime());
+}
+
+inline void TraceRecorder::Instant(const i8 * name, i64 arg) {
+	Record(kInstant, name, arg, uv_hrtime());
+}
+
+inline i32 TraceRecorder::GetCapacity() const {
+	return static_cast<i32>(mask_ + 1);
+}
+
+inline u64 TraceRecorder::GetRecorded() const {
+	return head_.load(std::memory_order_acquire);
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -69,6 +69,8 @@ public:
 	void ShutdownConnection(i64 mgr_id, i64 connection_id);
 	void ShutdownConnectionNow(i64 mgr_id, i64 connection_id);
 	SocketAddress GetConnectionRemoteAddress(i64 mgr_id, i64 connection_id);
+	bool GetConnectionTrafficStats(i64 mgr_id, i64 connection_id, SocketConnection::TrafficStats & stats);
+	bool GetMgrTrafficStats(i64 mgr_id, SocketConnection::TrafficStats & stats);
 
 	void SetSignal(on_signal_func signal_func);
 	void SetCallback(on_connected_func on_connected, on_connect_failed_func on_connect_failed, on_disconnected_func on_disconnected, on_received_func on_received, on_sent_func on_sent);
@@ -46,6 +46,8 @@ public:
 	u32 GetConnectionCount() const;
 	Connection * GetConnection(i64 id);
 	void SetNotification(INotification * notification);
+	// 所有连接的流量统计之和, 包含已断开的连接
+	SocketConnection::TrafficStats GetTrafficStats() const;
 
 protected:
 	ConnectionMgr(const std::string & name);
@@ -57,6 +59,7 @@ protected:
 private:
 	static void DestroyConnection(Connection * connection, void * ud);
 	static void ShutdownConnection(Connection * connection, void * ud);
+	static void AddTrafficStats(Connection * connection, void * ud);
 
 private:
 	ConnectionMgr(ConnectionMgr &&) = delete;
@@ -70,6 +73,7 @@ private:
 	INotification * notification_;
 	ObjectMgr<Connection> * object_mgr_;
 	std::list<i64> * need_delete_list_;
+	SocketConnection::TrafficStats closed_traffic_;
 };
 
 inline i64 ConnectionMgr::GetMgrId() const {
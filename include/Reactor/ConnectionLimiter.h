@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Reactor_ConnectionLimiter_INCLUDED
+#define Net_Reactor_ConnectionLimiter_INCLUDED
+
+#include "Common.h"
+#include "CObject.h"
+#include "Address/IPAddress.h"
+#include <vector>
+
+namespace Net {
+
+// 按来源IP限制新建连接速率(令牌桶)和同时在线连接数
+// 状态保存在容量固定的哈希表中, 满了以后淘汰最久未使用的IP, 伪造源地址的洪水也不会使内存增长
+// 被淘汰的IP计数清零; 淘汰时优先跳过仍有在线连接的IP
+// 只能在事件循环线程使用
+class COMMON_EXTERN ConnectionLimiter : public Common::CObject {
+public:
+	enum eResult {
+		kAccepted,
+		kRateLimited,
+		kTooManyConnections,
+	};
+
+	explicit ConnectionLimiter(i32 capacity = 65536);
+	virtual ~ConnectionLimiter();
+
+	// 每个IP每秒rate个新连接, 最多积攒burst个, rate <= 0不限速
+	void SetRate(double rate, double burst);
+	// 每个IP同时最多max个连接, 0不限
+	void SetMaxPerAddress(i32 max);
+
+	// 检查并占用一个连接名额, now为毫秒时间戳, 成功后须对应调用一次Release()
+	eResult Acquire(const IPAddress & address, u64 now);
+	void Release(const IPAddress & address);
+
+	i32 GetActive(const IPAddress & address) const;
+	i32 GetSize() const;
+	i32 GetCapacity() const;
+	i64 GetEvictions() const;
+
+	// 淘汰时从最久未使用端最多检查的条目数
+	static const i32 kEvictScan = 8;
+
+private:
+	struct Entry {
+		IPAddress address;
+		double tokens;
+		u64 updated;
+		i32 active;
+		i32 next;
+		i32 lru_prev;
+		i32 lru_next;
+	};
+
+	i32 Find(const IPAddress & address, u64 hash) const;
+	i32 Insert(const IPAddress & address, u64 hash, u64 now);
+	void Evict(i32 index);
+	void Unlink(i32 index);
+	void PushFront(i32 index);
+
+private:
+	ConnectionLimiter(ConnectionLimiter &&) = delete;
+	ConnectionLimiter(const ConnectionLimiter &) = delete;
+	ConnectionLimiter & operator=(ConnectionLimiter &&) = delete;
+	ConnectionLimiter & operator=(const ConnectionLimiter &) = delete;
+
+private:
+	i32 capacity_;
+	double rate_;
+	double burst_;
+	i32 max_per_address_;
+	i64 evictions_;
+	std::vector<Entry> entries_;
+	std::vector<i32> buckets_;
+	u64 mask_;
+	i32 lru_head_;
+	i32 lru_tail_;
+};
+
+inline i32 ConnectionLimiter::GetSize() const {
+	return static_cast<i32>(entries_.size());
+}
+
+inline i32 ConnectionLimiter::GetCapacity() const {
+	return capacity_;
+}
+
+inline i64 ConnectionLimiter::GetEvictions() const {
+	return evictions_;
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Reactor_ConnectionPool_INCLUDED
+#define Net_Reactor_ConnectionPool_INCLUDED
+
+#include "Reactor/SocketConnector.h"
+#include <list>
+#include <random>
+
+namespace Net {
+
+// 单个上游地址的连接池
+// 后台保持min_idle个已建立的空闲连接, 取用时不需要等待连接建立
+// 定时检查空闲连接, 断开的连接被丢弃并在后台重连, 连接失败时按指数退避加随机抖动重试
+class COMMON_EXTERN ConnectionPool : public SocketConnector {
+public:
+	ConnectionPool(EventReactor * reactor, const SocketAddress & address);
+	virtual ~ConnectionPool();
+
+	// 在Start()前设置
+	void SetLimits(i32 min_idle, i32 max_total);
+	void SetHealthInterval(i32 msec);
+	void SetBackoff(i32 min_msec, i32 max_msec);
+
+	bool Start();
+	// 关闭空闲连接并停止重连, 已借出的连接归还时关闭
+	void Stop();
+
+	// 取一个空闲连接, 没有时返回nullptr并在后台补充
+	SocketConnection * Lease();
+	// 归还Lease()取得的连接, 已断开的连接直接释放
+	void Return(SocketConnection * connection);
+
+	const SocketAddress & GetAddress() const;
+	i32 GetIdleCount() const;
+	i32 GetLeasedCount() const;
+	i32 GetFailures() const;
+
+protected:
+	// 创建连接对象, 引用计数由连接池持有
+	virtual SocketConnection * NewConnection() = 0;
+	// 定时检查时对每个空闲连接调用, 返回false时关闭该连接
+	virtual bool CheckHealth(SocketConnection * connection);
+
+	virtual SocketConnection * CreateConnection() override;
+	virtual void DestroyConnection(SocketConnection * connection) override;
+	virtual void OnConnectFailed() override;
+
+private:
+	void Refill();
+	void Discard(SocketConnection * connection);
+	// 丢弃已断开或CheckHealth()不通过的空闲连接
+	void EvictIdle();
+
+	static void health_cb(uv_timer_t * handle);
+	static void retry_cb(uv_timer_t * handle);
+	static void timer_close_cb(uv_handle_t * handle);
+
+private:
+	SocketAddress address_;
+	i32 min_idle_;
+	i32 max_total_;
+	i32 health_interval_;
+	i32 backoff_min_;
+	i32 backoff_max_;
+	i32 failures_;
+	u64 next_connect_;
+	i32 leased_;
+	bool started_;
+	std::list<SocketConnection *> idle_;
+	uv_timer_t * timer_;
+	// 退避结束时补充连接, 不必等下一次健康检查
+	uv_timer_t * retry_timer_;
+	std::minstd_rand random_;
+};
+
+inline const SocketAddress & ConnectionPool::GetAddress() const {
+	return address_;
+}
+
+inline i32 ConnectionPool::GetIdleCount() const {
+	return static_cast<i32>(idle_.size());
+}
+
+inline i32 ConnectionPool::GetLeasedCount() const {
+	return leased_;
+}
+
+inline i32 ConnectionPool::GetFailures() const {
+	return failures_;
+}
+
+}
+
+#endif
\ No newline at end of file
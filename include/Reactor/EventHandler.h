@@ -27,12 +27,16 @@
 
 #include "CList.h"
 #include "Sockets/UvData.h"
+#include <vector>
 
 namespace Net {
 
 class EventReactor;
+class Resolver;
+class SocketAddress;
 class COMMON_EXTERN EventHandler : public Common::CList<EventHandler>::BaseNode, public UvData {
 	friend class EventReactor;
+	friend class Resolver;
 
 public:
 	virtual ~EventHandler();
@@ -44,6 +48,10 @@ protected:
 	explicit EventHandler(EventReactor * reactor, Logger::Category * logger = Logger::Category::GetCategory("EventHandler"));
 	virtual bool RegisterToReactor() = 0;
 	virtual bool UnRegisterFromReactor() = 0;
+	// 由EventReactor::ScheduleFlush()登记, 在check阶段回调
+	virtual void Flush();
+	// Resolver::Resolve()的结果, status < 0时addresses为空
+	virtual void ResolveCallback(i32 status, const std::vector<SocketAddress> & addresses, void * arg) {}
 
 private:
 	EventHandler(EventHandler &&) = delete;
@@ -28,12 +28,40 @@
 #include "CObject.h"
 #include "CList.h"
 #include "Reactor/EventHandler.h"
+#include "Common/LoopStats.h"
+#include "Common/Histogram.h"
+#include "Common/TraceRecorder.h"
+#include "Sockets/TcpInfo.h"
+#include "Sockets/StreamSocket.h"
+#include "Buffer/BipBuffer.h"
 #include "uv.h"
 
 namespace Net {
 
+class Resolver;
+class SocketConnection;
 class COMMON_EXTERN EventReactor : public Common::CObject {
+	friend class SocketConnection;
+
 public:
+	// 忙轮询统计, 时间单位纳秒
+	struct BusyPollStats {
+		i64 spin_time;			// 自旋(含pause/yield)耗时
+		i64 blocked_time;		// 阻塞等待耗时
+		i64 spin_wakeups;		// 自旋阶段捕获的事件次数
+		i64 blocked_wakeups;	// 阻塞后被唤醒次数
+	};
+
+	// 所有连接TCP_INFO抽样值的分布
+	struct TcpInfoStats {
+		Histogram rtt;			// 微秒
+		Histogram rttvar;		// 微秒
+		Histogram retransmits;	// 两次抽样之间的重传段数
+		Histogram snd_cwnd;		// 段
+		Histogram unacked;		// 字节
+		Histogram notsent;		// 字节
+	};
+
 	EventReactor();
 	virtual ~EventReactor();
 
@@ -43,6 +71,93 @@ public:
 	bool Poll(uv_run_mode mode = UV_RUN_NOWAIT);
 	uv_loop_t * GetUvLoop() const;
 
+	// 阻塞运行事件循环, 直到Stop()被调用, Stop()可在任意线程调用
+	void Run();
+	void Stop();
+	// 延迟到本轮事件循环的check阶段再Release, 只能在事件循环线程调用
+	void DeferRelease(EventHandler * handler);
+
+	// 忙轮询模式, Run()中以UV_RUN_NOWAIT自旋, 空闲超过spin_budget微秒后才阻塞
+	// 之后建立的连接会设置SO_BUSY_POLL
+	void SetBusyPoll(bool enable, i32 spin_budget = 50);
+	bool IsBusyPoll() const;
+	i32 GetSpinBudget() const;
+	const BusyPollStats & GetBusyPollStats() const;
+	// 把调用线程绑定到指定cpu, 在事件循环线程调用
+	bool SetCpuAffinity(i32 cpu);
+
+	// 写合并, 同一轮事件循环内的多次写在check阶段合并为一次uv_write提交
+	// 默认值由编译选项NET_WRITE_BATCHING决定
+	void SetWriteBatching(bool enable);
+	bool IsWriteBatching() const;
+	// 登记到本轮check阶段调用handler->Flush(), 只能在事件循环线程调用
+	void ScheduleFlush(EventHandler * handler);
+
+	// 本事件循环的域名解析器, 首次调用时创建
+	Resolver * GetResolver();
+
+	// 事件循环耗时统计, 默认开启, 关闭后套接字回调不再计时
+	void SetLoopStats(bool enable);
+	bool IsLoopStats() const;
+	// 可在任意线程调用
+	LoopStats::Snapshot GetStats() const;
+	// 每one_in次Write()抽样一次写入延迟, 0关闭
+	void SetWriteSampling(i32 one_in);
+	i32 GetWriteSampling() const;
+	// 本次写入是否抽样, 只能在事件循环线程调用
+	bool SampleWrite();
+	void RecordWriteLatency(u64 elapsed);
+	// 每interval毫秒抽样slice个连接的TCP_INFO, 轮流覆盖所有连接, 0关闭, 只能在事件循环线程调用
+	void SetTcpInfoSampling(i32 interval, i32 slice = 64);
+	// 本事件循环上已建立的连接, 只能在事件循环线程使用
+	const std::vector<SocketConnection *> & GetConnections() const;
+	// 所有连接(含已断开)的累计收发字节数, 在收发时累加, 不随连接断开变化
+	i64 GetBytesIn() const;
+	i64 GetBytesOut() const;
+	// 已断开的连接数
+	i64 GetClosedConnections() const;
+	i32 GetTcpInfoInterval() const;
+	// 可在任意线程调用
+	TcpInfoStats GetTcpInfoStats() const;
+	void RecordTcpInfo(const TcpInfo & info, u32 retransmits);
+	// 记录循环, 轮询和套接字回调的时间线, 最多保留capacity个事件, 0关闭, 需要开启事件循环耗时统计
+	// 只能在事件循环线程调用
+	void SetTrace(i32 capacity = TraceRecorder::kDefaultCapacity);
+	TraceRecorder * GetTrace() const;
+	// 写出Chrome trace JSON, 返回事件数或错误码
+	i32 DumpTrace(const std::string & path) const;
+	// 收到signum时把时间线写到directory/trace-<pid>-<id>-<n>.json, signum为0关闭
+	void SetTraceSignal(i32 signum, const std::string & directory);
+	// 已关闭但仍在等待零拷贝完成通知的连接数
+	i32 GetParkedZeroCopy() const;
+
+private:
+	void ReleaseDeferred();
+	void FlushScheduled();
+	void RunBusyPoll();
+	bool HasPendingEvents() const;
+	// 连接建立和断开时登记到连接表, 连接表供GetConnections()和TCP_INFO抽样遍历
+	void AddConnection(SocketConnection * connection);
+	void RemoveConnection(SocketConnection * connection);
+	void AddBytesIn(i64 bytes);
+	void AddBytesOut(i64 bytes);
+	void SampleTcpInfo();
+	// 停止读取后仍有零拷贝发送未完成的连接, 由定时器回收完成通知
+	void WatchZeroCopy(SocketConnection * connection);
+	void UnwatchZeroCopy(SocketConnection * connection);
+	// 接管已关闭连接的套接字和发送缓冲区, 收齐outstanding个完成通知后再关闭套接字并释放缓冲区
+	void ParkZeroCopy(const StreamSocket & socket, Common::BipBuffer * buffer, i32 outstanding);
+	void StartReapTimer();
+	void ReapZeroCopy();
+
+	static void async_cb(uv_async_t * handle);
+	static void prepare_cb(uv_prepare_t * handle);
+	static void check_cb(uv_check_t * handle);
+	static void sample_cb(uv_timer_t * handle);
+	static void reap_cb(uv_timer_t * handle);
+	static void signal_cb(uv_signal_t * handle, int signum);
+	static void close_cb(uv_handle_t * handle);
+
 private:
 	EventReactor(EventReactor &&) = delete;
 	EventReactor(const EventReactor &) = delete;
@@ -50,18 +165,171 @@ private:
 	EventReactor & operator=(const EventReactor &) = delete;
 
 private:
+	struct ParkedZeroCopy {
+		StreamSocket socket;
+		Common::BipBuffer * buffer;
+		i32 outstanding;
+	};
+
 	uv_loop_t * loop_;
+	uv_async_t * async_;
+	uv_check_t * check_;
+	uv_prepare_t * prepare_;
+	std::atomic<bool> stop_;
+	bool busy_poll_;
+	i32 spin_budget_;
+	BusyPollStats busy_poll_stats_;
+	bool write_batching_;
+	Resolver * resolver_;
+	bool loop_stats_;
+	LoopStats stats_;
+	i32 write_sampling_;
+	i32 write_sample_count_;
+	uv_timer_t * sample_timer_;
+	i32 sample_interval_;
+	i32 sample_slice_;
+	size_t sample_cursor_;
+	std::vector<SocketConnection *> connections_;
+	i64 bytes_in_;
+	i64 bytes_out_;
+	i64 closed_connections_;
+	TcpInfoStats tcp_info_stats_;
+	uv_timer_t * reap_timer_;
+	std::vector<SocketConnection *> zerocopy_waiting_;
+	std::vector<ParkedZeroCopy> parked_;
+	TraceRecorder * trace_;
+	i32 trace_id_;
+	i32 trace_dumps_;
+	uv_signal_t * trace_signal_;
+	std::string trace_directory_;
 	Common::CList<EventHandler> handlers_;
+	std::vector<EventHandler *> deferred_;
+	std::vector<EventHandler *> flushes_;
+
+	static const u64 kReapInterval = 10;
 };
 
 inline bool EventReactor::Poll(uv_run_mode mode) {
-	return uv_run(loop_, mode) > 0;
+	LoopStats::Scope scope(loop_stats_ ? &stats_ : nullptr);
+	bool alive = uv_run(loop_, mode) > 0;
+	// 没有活跃句柄时uv_run不会进入check阶段
+	if (!flushes_.empty()) {
+		FlushScheduled();
+	}
+	if (!deferred_.empty()) {
+		ReleaseDeferred();
+	}
+	return alive;
 }
 
 inline uv_loop_t * EventReactor::GetUvLoop() const {
 	return loop_;
 }
 
+inline bool EventReactor::IsBusyPoll() const {
+	return busy_poll_;
+}
+
+inline i32 EventReactor::GetSpinBudget() const {
+	return spin_budget_;
+}
+
+inline const EventReactor::BusyPollStats & EventReactor::GetBusyPollStats() const {
+	return busy_poll_stats_;
+}
+
+inline void EventReactor::SetWriteBatching(bool enable) {
+	write_batching_ = enable;
+}
+
+inline bool EventReactor::IsWriteBatching() const {
+	return write_batching_;
+}
+
+inline void EventReactor::SetLoopStats(bool enable) {
+	loop_stats_ = enable;
+}
+
+inline bool EventReactor::IsLoopStats() const {
+	return loop_stats_;
+}
+
+inline void EventReactor::SetWriteSampling(i32 one_in) {
+	write_sampling_ = one_in > 0 ? one_in : 0;
+	write_sample_count_ = 0;
+}
+
+inline i32 EventReactor::GetWriteSampling() const {
+	return write_sampling_;
+}
+
+inline bool EventReactor::SampleWrite() {
+	if (write_sampling_ > 0 && ++write_sample_count_ >= write_sampling_) {
+		write_sample_count_ = 0;
+		return true;
+	}
+	return false;
+}
+
+inline void EventReactor::RecordWriteLatency(u64 elapsed) {
+	stats_.RecordWriteLatency(elapsed);
+}
+
+inline const std::vector<SocketConnection *> & EventReactor::GetConnections() const {
+	return connections_;
+}
+
+inline i64 EventReactor::GetBytesIn() const {
+	return bytes_in_;
+}
+
+inline i64 EventReactor::GetBytesOut() const {
+	return bytes_out_;
+}
+
+inline i64 EventReactor::GetClosedConnections() const {
+	return closed_connections_;
+}
+
+inline void EventReactor::AddBytesIn(i64 bytes) {
+	bytes_in_ += bytes;
+}
+
+inline void EventReactor::AddBytesOut(i64 bytes) {
+	bytes_out_ += bytes;
+}
+
+inline i32 EventReactor::GetTcpInfoInterval() const {
+	return sample_interval_;
+}
+
+inline EventReactor::TcpInfoStats EventReactor::GetTcpInfoStats() const {
+	return tcp_info_stats_;
+}
+
+inline void EventReactor::RecordTcpInfo(const TcpInfo & info, u32 retransmits) {
+	tcp_info_stats_.rtt.Record(info.rtt);
+	tcp_info_stats_.rttvar.Record(info.rttvar);
+	tcp_info_stats_.retransmits.Record(retransmits);
+	tcp_info_stats_.snd_cwnd.Record(info.snd_cwnd);
+	tcp_info_stats_.unacked.Record(info.unacked);
+	tcp_info_stats_.notsent.Record(info.notsent);
+}
+
+inline i32 EventReactor::GetParkedZeroCopy() const {
+	return static_cast<i32>(parked_.size());
+}
+
+inline TraceRecorder * EventReactor::GetTrace() const {
+	return trace_;
+}
+
+inline LoopStats::Snapshot EventReactor::GetStats() const {
+	LoopStats::Snapshot snapshot;
+	stats_.GetSnapshot(snapshot);
+	return snapshot;
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Reactor_LifecycleStats_INCLUDED
+#define Net_Reactor_LifecycleStats_INCLUDED
+
+#include "Common/Histogram.h"
+
+namespace Net {
+
+// 连接建立各阶段耗时, 单位纳秒, 由SocketAcceptor/SocketConnector所在的事件循环线程写入
+struct LifecycleStats {
+	Histogram setup;		// 接入: 本轮epoll返回到uv_accept完成(未开启LoopStats时从接入回调开始); 连接: Connect()到连接回调
+	Histogram handshake;	// 接入: 本轮epoll返回到OnConnected(同上); 连接: Connect()到OnConnected
+	Histogram first_read;	// OnConnected到收到第一个字节
+	Histogram first_write;	// OnConnected到第一次写请求完成
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef Net_Reactor_MetricsServer_INCLUDED
+#define Net_Reactor_MetricsServer_INCLUDED
+
+#include "Reactor/SocketAcceptor.h"
+#include <list>
+
+namespace Net {
+
+class ConnectionPool;
+class MetricsConnection;
+// 内置的指标端口, 用Open()在单独的端口监听, 对GET /metrics返回Prometheus文本格式
+// 包括事件循环耗时, 连接数和收发字节数, 写队列, 登记的接入器和连接池, 以及BufferPool分配计数
+// 按阶段分步生成, 每轮事件循环只生成一步, 汇总连接时每步最多slice个, 一次抓取不会长时间占用事件循环
+// 发送缓冲区满时等写请求完成再继续, 超过请求超时仍未收到完整请求的连接直接关闭
+// 只能在事件循环线程使用
+class COMMON_EXTERN MetricsServer : public SocketAcceptor {
+	friend class MetricsConnection;
+
+public:
+	explicit MetricsServer(EventReactor * reactor);
+	virtual ~MetricsServer();
+
+	// 持有引用直到移除或析构, label作为指标的标签
+	bool AddAcceptor(SocketAcceptor * acceptor, const std::string & label);
+	void RemoveAcceptor(SocketAcceptor * acceptor);
+	bool AddPool(ConnectionPool * pool, const std::string & label);
+	void RemovePool(ConnectionPool * pool);
+	void SetSlice(i32 slice);
+	i32 GetSlice() const;
+	// 连接建立后msec毫秒内没有收到完整请求就关闭, 避免慢速发送的客户端一直占用连接
+	void SetRequestTimeout(i32 msec);
+	i32 GetRequestTimeout() const;
+	i64 GetScrapeCount() const;
+	i64 GetTimeoutCount() const;
+
+	static const i32 kDefaultSlice = 256;
+	static const i32 kDefaultRequestTimeout = 5000;
+
+protected:
+	virtual SocketConnection * CreateConnection() override;
+	virtual void DestroyConnection(SocketConnection * connection) override;
+
+private:
+	enum eStage {
+		kLoop,
+		kConnections,
+		kAcceptors,
+		kPools,
+		kBuffers,
+		kDone,
+	};
+
+	// 一次抓取的进度和连接汇总, 分段累加的只有瞬时值, 累计字节数直接取EventReactor的计数
+	struct RenderState {
+		eStage stage;
+		size_t index;
+		i64 connections;
+		i64 out_buffered;
+		i64 write_queue;
+		i64 write_queue_max;
+		i64 saturated;
+	};
+
+	// 追加一步的输出
+	void Render(RenderState & state, std::string & out);
+	void RenderConnections(RenderState & state, std::string & out);
+	// 登记到下一轮事件循环生成下一步
+	void Schedule(MetricsConnection * connection);
+	void Closed(MetricsConnection * connection);
+	void StartTimeout();
+	void CheckTimeout();
+
+	static void idle_cb(uv_idle_t * handle);
+	static void idle_close_cb(uv_handle_t * handle);
+	static void timeout_cb(uv_timer_t * handle);
+	static void timeout_close_cb(uv_handle_t * handle);
+
+private:
+	i32 slice_;
+	i32 request_timeout_;
+	i64 scrapes_;
+	i64 timeouts_;
+	std::list<MetricsConnection *> connections_;
+	std::vector<MetricsConnection *> rendering_;
+	uv_idle_t * idle_;
+	uv_timer_t * timeout_timer_;
+	std::vector<std::pair<SocketAcceptor *, std::string>> acceptors_;
+	std::vector<std::pair<ConnectionPool *, std::string>> pools_;
+};
+
+inline void MetricsServer::SetSlice(i32 slice) {
+	slice_ = slice > 0 ? slice : kDefaultSlice;
+}
+
+inline i32 MetricsServer::GetSlice() const {
+	return slice_;
+}
+
+inline i32 MetricsServer::GetRequestTimeout() const {
+	return request_timeout_;
+}
+
+inline i64 MetricsServer::GetScrapeCount() const {
+	return scrapes_;
+}
+
+inline i64 MetricsServer::GetTimeoutCount() const {
+	return timeouts_;
+}
+
+}
+
+#endif
\ No newline at end of file
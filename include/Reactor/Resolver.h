@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Reactor_Resolver_INCLUDED
+#define Net_Reactor_Resolver_INCLUDED
+
+#include "CObject.h"
+#include "Category.h"
+#include "Address/IPAddress.h"
+#include "Address/SocketAddress.h"
+#include "uv.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Net {
+
+class EventReactor;
+class EventHandler;
+// 每个EventReactor一个, 由EventReactor::GetResolver()取得, 只能在事件循环线程使用
+// 在libuv线程池上执行uv_getaddrinfo, 结果按主机名缓存, 失败结果也缓存一段时间
+// 同一主机名同时只有一个解析请求, 后来者挂在等待队列上共享结果
+class COMMON_EXTERN Resolver : public Common::CObject {
+public:
+	explicit Resolver(EventReactor * reactor);
+	virtual ~Resolver();
+
+	// 结果通过handler->ResolveCallback(status, addresses, arg)返回, 地址的端口为port
+	// 数字地址, 静态条目及缓存命中时在本次调用内同步回调
+	void Resolve(const std::string & host, u16 port, EventHandler * handler, void * arg);
+	// 成功结果缓存ttl毫秒, 失败结果缓存negative_ttl毫秒, 0不缓存
+	void SetTTL(i32 ttl, i32 negative_ttl);
+	i32 GetTTL() const;
+	i32 GetNegativeTTL() const;
+
+	// 静态条目, 优先于缓存和系统解析
+	bool AddHost(const std::string & host, const i8 * ip);
+	void RemoveHost(const std::string & host);
+	// 按hosts文件格式("ip 主机名 [别名...]", #开始注释)加载静态条目, 返回条目数, 打开失败返回负数错误码
+	i32 LoadHosts(const std::string & path);
+	void ClearCache();
+
+	i32 GetCacheSize() const;
+	// 已发起的系统解析次数
+	i64 GetLookupCount() const;
+	// 进行中的系统解析数
+	i32 GetPendingCount() const;
+
+	static const i32 kMaxCacheSize = 4096;
+
+private:
+	struct Entry {
+		i32 status;
+		u64 expire;
+		std::vector<IPAddress> hosts;
+	};
+	struct Lookup;
+
+	void Complete(Lookup * lookup, i32 status, const std::vector<IPAddress> & hosts);
+	void Store(const std::string & host, i32 status, const std::vector<IPAddress> & hosts);
+	static void Deliver(EventHandler * handler, i32 status, const std::vector<IPAddress> & hosts, u16 port, void * arg);
+	static std::string Normalize(const std::string & host);
+
+	static void getaddrinfo_cb(uv_getaddrinfo_t * req, int status, struct addrinfo * res);
+
+private:
+	Resolver(Resolver &&) = delete;
+	Resolver(const Resolver &) = delete;
+	Resolver & operator=(Resolver &&) = delete;
+	Resolver & operator=(const Resolver &) = delete;
+
+private:
+	EventReactor * reactor_;
+	Logger::Category * logger_;
+	i32 ttl_;
+	i32 negative_ttl_;
+	i64 lookups_;
+	std::unordered_map<std::string, std::vector<IPAddress>> hosts_;
+	std::unordered_map<std::string, Entry> cache_;
+	std::unordered_map<std::string, Lookup *> pending_;
+};
+
+inline i32 Resolver::GetTTL() const {
+	return ttl_;
+}
+
+inline i32 Resolver::GetNegativeTTL() const {
+	return negative_ttl_;
+}
+
+inline i32 Resolver::GetCacheSize() const {
+	return static_cast<i32>(cache_.size());
+}
+
+inline i64 Resolver::GetLookupCount() const {
+	return lookups_;
+}
+
+inline i32 Resolver::GetPendingCount() const {
+	return static_cast<i32>(pending_.size());
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -27,18 +27,56 @@
 
 #include "Reactor/EventHandler.h"
 #include "Address/SocketAddress.h"
+#include "Address/AddressFilter.h"
+#include "Reactor/ConnectionLimiter.h"
+#include "Reactor/LifecycleStats.h"
 #include "Sockets/ServerSocket.h"
+#include "Sockets/SocketOptions.h"
+#include <memory>
 
 namespace Net {
 
 class SocketConnection;
 class COMMON_EXTERN SocketAcceptor : public EventHandler {
 public:
+	struct AcceptStats {
+		i64 accepted;		// 成功接入数
+		i64 rejected;		// 被地址过滤拒绝数
+		i64 rate_limited;	// 超过速率限制数
+		i64 over_limit;		// 超过单IP连接数限制数
+		i64 errors;			// 接入失败数
+		i64 exhausted;		// libuv未能自行处理的描述符或内存耗尽次数
+		i64 shed;			// 耗尽时直接关闭的等待连接数
+		i64 pauses;			// 暂停接入次数
+		bool paused;		// 当前是否暂停
+	};
+
 	virtual ~SocketAcceptor();
 
 	bool Open(const SocketAddress & address, i32 backlog = 128, bool ipv6_only = false);
 	void Close();
 	SocketAddress GetListenAddress() const;
+	// 在Open()前设置, fast_open作用于监听套接字, 其余应用到每个接入的连接
+	void SetSocketOptions(const SocketOptions & options);
+	const SocketOptions & GetSocketOptions() const;
+	// 接入后立即按对端地址过滤, 被拒绝的连接直接关闭, 不创建连接对象
+	// 可在任意线程调用, 原子替换后新接入的连接使用新规则, nullptr取消过滤
+	void SetAddressFilter(const std::shared_ptr<const AddressFilter> & filter);
+	std::shared_ptr<const AddressFilter> GetAddressFilter() const;
+	i64 GetRejectedCount() const;
+	// 按来源IP限制新建连接速率和同时在线连接数, 超限的连接直接关闭, nullptr取消限制
+	// 只能在事件循环线程调用
+	void SetConnectionLimiter(const std::shared_ptr<ConnectionLimiter> & limiter);
+	const std::shared_ptr<ConnectionLimiter> & GetConnectionLimiter() const;
+	i64 GetRateLimitedCount() const;
+	i64 GetOverLimitCount() const;
+	// 描述符耗尽时关闭等待中的连接并暂停接入msec毫秒, 期间新连接留在内核队列中
+	void SetExhaustedPause(i32 msec);
+	i32 GetExhaustedPause() const;
+	bool IsPaused() const;
+	AcceptStats GetAcceptStats() const;
+	// 可在任意线程调用
+	LifecycleStats GetLifecycleStats() const;
 
 protected:
 	explicit SocketAcceptor(EventReactor * reactor);
@@ -50,17 +88,93 @@ protected:
 
 private:
 	bool ActivateConnection(SocketConnection * connection);
+	void Accept(u64 ready);
+	void HandleExhausted(i32 status);
+	void Pause();
+	void Resume();
+
+	static void resume_cb(uv_timer_t * handle);
+	static void timer_close_cb(uv_handle_t * handle);
 
 private:
 	bool opened_;
 	ServerSocket socket_;
 	SocketAddress address_;
+	SocketOptions options_;
+	std::shared_ptr<const AddressFilter> filter_;
+	i64 rejected_;
+	std::shared_ptr<ConnectionLimiter> limiter_;
+	i64 rate_limited_;
+	i64 over_limit_;
+	i64 accepted_;
+	i64 errors_;
+	i64 exhausted_;
+	i64 shed_;
+	i64 pauses_;
+	i32 pause_time_;
+	bool paused_;
+	bool held_;
+	u64 held_time_;
+	uv_timer_t * timer_;
+	std::shared_ptr<LifecycleStats> lifecycle_;
 };
 
 inline SocketAddress SocketAcceptor::GetListenAddress() const {
 	return address_;
 }
 
+inline void SocketAcceptor::SetSocketOptions(const SocketOptions & options) {
+	options_ = options;
+}
+
+inline const SocketOptions & SocketAcceptor::GetSocketOptions() const {
+	return options_;
+}
+
+inline void SocketAcceptor::SetAddressFilter(const std::shared_ptr<const AddressFilter> & filter) {
+	std::atomic_store(&filter_, filter);
+}
+
+inline std::shared_ptr<const AddressFilter> SocketAcceptor::GetAddressFilter() const {
+	return std::atomic_load(&filter_);
+}
+
+inline i64 SocketAcceptor::GetRejectedCount() const {
+	return rejected_;
+}
+
+inline void SocketAcceptor::SetConnectionLimiter(const std::shared_ptr<ConnectionLimiter> & limiter) {
+	limiter_ = limiter;
+}
+
+inline const std::shared_ptr<ConnectionLimiter> & SocketAcceptor::GetConnectionLimiter() const {
+	return limiter_;
+}
+
+inline i64 SocketAcceptor::GetRateLimitedCount() const {
+	return rate_limited_;
+}
+
+inline i64 SocketAcceptor::GetOverLimitCount() const {
+	return over_limit_;
+}
+
+inline void SocketAcceptor::SetExhaustedPause(i32 msec) {
+	pause_time_ = msec > 0 ? msec : 1;
+}
+
+inline i32 SocketAcceptor::GetExhaustedPause() const {
+	return pause_time_;
+}
+
+inline bool SocketAcceptor::IsPaused() const {
+	return paused_;
+}
+
+inline LifecycleStats SocketAcceptor::GetLifecycleStats() const {
+	return *lifecycle_;
+}
+
 }
 
 #endif
\ No newline at end of file
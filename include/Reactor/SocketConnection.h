@@ -35,37 +35,93 @@
 #include "Buffer/BipBuffer.h"
 #include "CObject.h"
 #include "Address/SocketAddress.h"
+#include <deque>
 
 namespace Net {
 
 class COMMON_EXTERN SocketConnection : public EventHandler {
 	friend class SocketAcceptor;
 	friend class SocketConnector;
+	friend class EventReactor;
 
 public:
+	// 连接流量统计, 每次建立连接时清零, 时间为事件循环时间(毫秒)
+	struct TrafficStats {
+		i64 bytes_in;			// 接收字节数(含ReceiveToFile)
+		i64 bytes_out;			// 写入字节数(含SendFile)
+		i64 messages_in;		// OnNewDataReceived通知次数
+		i64 messages_out;		// 成功的Write()/SendFile()次数
+		i64 reads;				// 读到数据的读回调次数, 不含错误, EOF和零拷贝完成通知
+		i64 writes;				// 提交到内核的写请求次数, 写合并后少于messages_out
+		i32 peak_out_buffer;	// 发送缓冲区最大占用
+		i32 peak_in_buffer;		// 接收缓冲区最大占用
+		i32 peak_write_queue;	// libuv写队列最大字节数
+		u64 last_read;			// 最后一次收到数据的时间
+		u64 last_write;			// 最后一次写请求完成的时间
+
+		// 累加, 峰值和时间取最大
+		void Add(const TrafficStats & other);
+	};
+
 	SocketConnection(i32 max_out_buffer_size, i32 max_in_buffer_size);
 	virtual ~SocketConnection();
 
 	void Shutdown(bool now);
 	i32 Write(const i8 * data, i32 len);
 	i32 Read(i8 * data, i32 len);
+	// 用sendfile发送文件[offset, offset + length), 不经过用户态缓冲区
+	// 之前写入的数据先发出, 发送期间的写入排在文件之后, 完成后回调OnFileSent
+	i32 SendFile(uv_file file, i64 offset, i64 length);
+	// 把接下来的length字节直接写入文件(offset < 0时从文件当前位置写)或内存, 不经过接收缓冲区
+	// 接收缓冲区中已有的数据先写入, 其余随可读事件用splice接收, 完成后回调OnFileReceived并恢复正常读取
+	i32 ReceiveToFile(uv_file file, i64 offset, i64 length);
+	i32 ReceiveToMemory(i8 * data, i64 length);
 	i8 * GetRecvData();
 	i32 GetRecvDataSize();
 	void PopRecvData(i32 size);
 
+	// 单次写入不小于threshold字节时使用MSG_ZEROCOPY发送, 0关闭
+	// 数据仍拷贝进发送缓冲区, 省去内核的拷贝, 内核释放页面后才回收缓冲区并通知OnSomeDataSent
+	void SetZeroCopyThreshold(i32 threshold);
+	i32 GetZeroCopyThreshold() const;
+	i64 GetZeroCopySends() const;
+	i64 GetZeroCopyCopied() const;
+
+	const TrafficStats & GetTrafficStats() const;
+	// 距最后一次收到数据/完成写请求的毫秒数, 之前没有时从建立连接算起
+	u64 GetReadIdleTime() const;
+	u64 GetWriteIdleTime() const;
+	// 发送/接收缓冲区占用和上限
+	i32 GetOutBufferSize() const;
+	i32 GetMaxOutBufferSize() const;
+	i32 GetInBufferSize() const;
+	i32 GetMaxInBufferSize() const;
+	const SocketAddress & GetRemoteAddress() const;
+	// 最近一次TCP_INFO抽样, 由EventReactor::SetTcpInfoSampling()定期刷新, 也可主动调用SampleTcpInfo()
+	i32 SampleTcpInfo();
+	const TcpInfo & GetTcpInfo() const;
+	// 最近一次抽样成功的事件循环时间, 0表示还没有抽样
+	u64 GetTcpInfoTime() const;
+
 	ConnectState::eState GetConnectState() const;
 	StreamSocket * GetSocket();
 	void SetSocket(const StreamSocket & socket);
+	// 在RegisterToReactor()时应用
+	void SetSocketOptions(const SocketOptions & options);
+	const SocketOptions & GetSocketOptions() const;
 
 protected:
 	virtual bool RegisterToReactor() override;
 	virtual bool UnRegisterFromReactor() override;
+	virtual void Flush() override;
 
 	// 通知应用层
 	virtual void OnConnected();
 	virtual void OnDisconnected(bool is_remote);
 	virtual void OnNewDataReceived();
 	virtual void OnSomeDataSent();
+	virtual void OnFileSent(i32 status, i64 sent);
+	virtual void OnFileReceived(i32 status, i64 received);
 	virtual void OnError(i32 reason);
 
 private:
@@ -74,8 +130,20 @@ private:
 	virtual void AllocCallback(uv_buf_t * buf) override;
 	virtual void ReadCallback(i32 status) override;
 	virtual void WrittenCallback(i32 status, void * arg) override;
+	virtual void SendFileCallback(i32 status, i64 sent, void * arg) override;
+	virtual void ReceiveFileCallback(i32 status, i64 received, void * arg) override;
 
 	bool Establish();
+	i32 WriteData(const i8 * data, i32 len);
+	i32 FlushPending();
+	i32 SubmitWrite(i8 * block, i32 len);
+	void StartSendFile();
+	void FinishSendFile(i32 status, i64 sent);
+	i32 StartReceive(uv_file file, i8 * memory, i64 offset, i64 length);
+	i32 WriteZeroCopy(i8 * block, i32 len);
+	void ReapZeroCopy();
+	void ReleaseOutBuffer(i32 len);
+	void TraceLifecycle(const std::shared_ptr<LifecycleStats> & lifecycle, u64 now);
 	void ShutdownImmediately();
 	void CallOnConnected();
 	void CallOnDisconnected(bool is_remote);
@@ -84,20 +152,104 @@ private:
 	void HandleClose4Error(i32 reason);
 
 private:
-	Common::BipBuffer out_buffer_;
+	// 零拷贝发送未完成时连接关闭, 缓冲区交给EventReactor, 之后换用新的缓冲区
+	Common::BipBuffer * out_buffer_;
 	Common::StraightBuffer in_buffer_;
 	StreamSocket socket_;
 	SocketAddress address_;
 	ConnectState::eState connect_state_;
 	i32 max_out_buffer_size_;
 	i32 max_in_buffer_size_;
+	i8 * pending_block_;
+	i32 pending_size_;
+	bool flush_scheduled_;
+	i32 uv_outstanding_;
+	i32 zerocopy_threshold_;
+	i32 zerocopy_outstanding_;
+	i64 zerocopy_sends_;
+	i64 zerocopy_copied_;
+	std::vector<i32> zerocopy_held_;
+	bool zerocopy_;
+	uv_file file_;
+	i64 file_offset_;
+	i64 file_length_;
+	std::vector<std::pair<i8 *, i32>> file_held_;
+	bool file_queued_;
+	bool file_sending_;
+	i64 file_received_;
+	bool file_receiving_;
+	SocketOptions options_;
+	bool corked_;
+	bool shutdown_write_pending_;
 	bool shutdown_;
 	bool called_on_connected_;
 	bool called_on_disconnected_;
+	TrafficStats traffic_;
+	// 抽样写入的结束位置(按发送缓冲区累计字节)和时间, 该位置之前的数据被确认后计入延迟
+	std::deque<std::pair<u64, u64>> write_samples_;
+	u64 buffered_bytes_;
+	u64 released_bytes_;
+	// 建立连接的SocketAcceptor/SocketConnector的阶段统计, 记录首字节耗时
+	std::shared_ptr<LifecycleStats> lifecycle_;
+	u64 connected_time_;
+	bool first_read_;
+	bool first_write_;
+	// 由SocketAcceptor占用的限流名额, 断开时按占用时的地址归还
+	std::shared_ptr<ConnectionLimiter> limiter_;
+	IPAddress limiter_host_;
+	// 在EventReactor连接表中的位置, -1表示不在表中
+	i32 connection_index_;
+	TcpInfo tcp_info_;
+	u64 tcp_info_time_;
 
 	static const i32 kReadMax = 4096;
+	static const size_t kMaxWriteSamples = 64;
 };
 
+inline i32 SocketConnection::GetZeroCopyThreshold() const {
+	return zerocopy_threshold_;
+}
+
+inline i64 SocketConnection::GetZeroCopySends() const {
+	return zerocopy_sends_;
+}
+
+inline i64 SocketConnection::GetZeroCopyCopied() const {
+	return zerocopy_copied_;
+}
+
+inline const SocketConnection::TrafficStats & SocketConnection::GetTrafficStats() const {
+	return traffic_;
+}
+
+inline i32 SocketConnection::GetOutBufferSize() const {
+	return out_buffer_->ReadableBytes();
+}
+
+inline i32 SocketConnection::GetMaxOutBufferSize() const {
+	return max_out_buffer_size_;
+}
+
+inline i32 SocketConnection::GetInBufferSize() const {
+	return in_buffer_.ReadableBytes();
+}
+
+inline i32 SocketConnection::GetMaxInBufferSize() const {
+	return max_in_buffer_size_;
+}
+
+inline const SocketAddress & SocketConnection::GetRemoteAddress() const {
+	return address_;
+}
+
+inline const TcpInfo & SocketConnection::GetTcpInfo() const {
+	return tcp_info_;
+}
+
+inline u64 SocketConnection::GetTcpInfoTime() const {
+	return tcp_info_time_;
+}
+
 inline ConnectState::eState SocketConnection::GetConnectState() const {
 	return connect_state_;
 }
@@ -110,6 +262,14 @@ inline void SocketConnection::SetSocket(const StreamSocket & socket) {
 	socket_ = socket;
 }
 
+inline void SocketConnection::SetSocketOptions(const SocketOptions & options) {
+	options_ = options;
+}
+
+inline const SocketOptions & SocketConnection::GetSocketOptions() const {
+	return options_;
+}
+
 inline i8 * SocketConnection::GetRecvData() {
 	i32 readable_size = 0;
 	return in_buffer_.ReadableBlock(readable_size);
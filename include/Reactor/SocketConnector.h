@@ -28,6 +28,13 @@
 #include "Reactor/EventHandler.h"
 #include "Address/SocketAddress.h"
 #include "Sockets/StreamSocket.h"
+#include "Sockets/SocketOptions.h"
+#include "Reactor/LifecycleStats.h"
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace Net {
 
@@ -36,8 +43,30 @@ class COMMON_EXTERN SocketConnector : public EventHandler {
 public:
 	virtual ~SocketConnector();
 
+	// 并发数未满时立即发起连接, 否则排队, 队列也满时返回false
 	bool Connect(const SocketAddress & address);
+	// 经EventReactor::GetResolver()解析后连接, 解析中也占用并发数, 与按地址连接共用并发数和队列
+	// 解析到多个地址时交替IPv6/IPv4逐个发起, 上一个未在fallback delay内完成就并行发起下一个, 先建立的胜出
+	// 解析失败或全部地址失败时回调一次OnConnectFailed
+	bool Connect(const std::string & host, u16 port);
+	// 取消所有进行中的连接和解析(各自回调OnConnectFailed), 丢弃排队的连接
 	void Close();
+	// 默认(1, 0), 同一时刻只有一个连接
+	void SetConcurrency(i32 max_connecting, i32 max_queued);
+	// 单个连接的超时毫秒数, 超时按UV_ETIMEDOUT失败, 0不限
+	void SetConnectTimeout(i32 msec);
+	i32 GetConnectTimeout() const;
+	// 并行尝试下一个地址前的等待毫秒数, 默认250
+	void SetFallbackDelay(i32 msec);
+	i32 GetFallbackDelay() const;
+	// 进行中(含解析中)的连接数
+	i32 GetConnectingCount() const;
+	i32 GetQueuedCount() const;
+	// 在Connect()前设置, fast_open > 0时连接前开启TCP_FASTOPEN_CONNECT, 其余应用到建立的连接
+	void SetSocketOptions(const SocketOptions & options);
+	const SocketOptions & GetSocketOptions() const;
+	// 按地址连接从Connect()计时(含排队), 按域名连接从解析完成计时, 可在任意线程调用
+	LifecycleStats GetLifecycleStats() const;
 
 protected:
 	explicit SocketConnector(EventReactor * reactor);
@@ -47,15 +76,70 @@ protected:
 	virtual void DestroyConnection(SocketConnection * connection) = 0;
 	virtual void OnConnectFailed() = 0;
 	virtual void ConnectCallback(i32 status, void * arg) override;
+	virtual void ResolveCallback(i32 status, const std::vector<SocketAddress> & addresses, void * arg) override;
 
 private:
+	struct ConnectAttempt;
+	struct ConnectRace;
+
 	bool ActivateConnection(SocketConnection * connection);
+	bool Enqueue(ConnectRace * race);
+	bool StartRace(ConnectRace * race);
+	bool StartNext(ConnectRace * race);
+	void CompleteRace(ConnectRace * race);
+	void DeleteRace(ConnectRace * race);
+	bool StartAttempt(const SocketAddress & address, ConnectRace * race);
+	void FinishAttempt(ConnectAttempt * attempt);
+	void StartQueued();
+	void CheckIdle();
+
+	static void timeout_cb(uv_timer_t * handle);
+	static void fallback_cb(uv_timer_t * handle);
+	static void timer_close_cb(uv_handle_t * handle);
 
 private:
 	bool connect_;
-	StreamSocket socket_;
+	i32 max_connecting_;
+	i32 max_queued_;
+	i32 connect_timeout_;
+	i32 fallback_delay_;
+	i32 connecting_;
+	i32 resolving_;
+	u32 generation_;
+	std::list<ConnectAttempt *> attempts_;
+	std::deque<ConnectRace *> queued_;
+	SocketOptions options_;
+	std::shared_ptr<LifecycleStats> lifecycle_;
 };
 
+inline i32 SocketConnector::GetConnectTimeout() const {
+	return connect_timeout_;
+}
+
+inline i32 SocketConnector::GetFallbackDelay() const {
+	return fallback_delay_;
+}
+
+inline i32 SocketConnector::GetConnectingCount() const {
+	return connecting_ + resolving_;
+}
+
+inline i32 SocketConnector::GetQueuedCount() const {
+	return static_cast<i32>(queued_.size());
+}
+
+inline void SocketConnector::SetSocketOptions(const SocketOptions & options) {
+	options_ = options;
+}
+
+inline const SocketOptions & SocketConnector::GetSocketOptions() const {
+	return options_;
+}
+
+inline LifecycleStats SocketConnector::GetLifecycleStats() const {
+	return *lifecycle_;
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef Net_Reactor_StatsSegment_INCLUDED
+#define Net_Reactor_StatsSegment_INCLUDED
+
+#include "Common.h"
+#include "CObject.h"
+#include "uv.h"
+#include <atomic>
+#include <unordered_map>
+
+namespace Net {
+
+class EventReactor;
+class SocketAcceptor;
+class ConnectionPool;
+class SocketConnection;
+// 把事件循环, 接入器, 连接池和连接的统计定期写到/dev/shm下的共享内存, 其他进程只读映射后查看, 不干扰被观察的进程
+// 每个EventReactor一个, 只能在事件循环线程使用, 写入用顺序锁(seqlock), 读取方复制到版本号不变为止
+// 仅Linux支持
+class COMMON_EXTERN StatsSegment : public Common::CObject {
+public:
+	struct ReactorRecord {
+		i64 iterations;			// 循环次数
+		u64 iteration_p50;		// 每轮耗时, 纳秒
+		u64 iteration_p99;
+		u64 iteration_max;
+		u64 blocked_p50;		// 每轮阻塞耗时, 纳秒
+		u64 busy_p99;			// 每轮执行回调耗时, 纳秒
+		u64 write_latency_p99;	// 抽样写入延迟, 纳秒
+		i64 connections;		// 当前连接数
+		i64 bytes_in;			// 当前连接的累计收发字节数
+		i64 bytes_out;
+		i64 out_buffered;		// 发送缓冲区占用之和
+		i64 in_buffered;		// 接收缓冲区占用之和
+		i64 write_queue;		// libuv写队列字节数之和
+		i64 saturated;			// 发送缓冲区占用超过3/4的连接数
+		i64 pool_bytes;			// BufferPool使用中的字节数(进程内所有线程)
+	};
+
+	struct AcceptorRecord {
+		i8 label[32];
+		i8 address[64];
+		i64 accepted;
+		i64 rejected;
+		i64 rate_limited;
+		i64 over_limit;
+		i64 errors;
+		i64 exhausted;
+		i64 shed;
+		i64 pauses;
+		i32 paused;
+		i32 reserved;
+	};
+
+	struct PoolRecord {
+		i8 label[32];
+		i8 address[64];
+		i32 idle;
+		i32 leased;
+		i32 connecting;
+		i32 failures;
+	};
+
+	// 按本次刷新以来收发字节数排序的连接
+	struct ConnectionRecord {
+		u64 id;
+		i8 peer[64];
+		i64 bytes_in;
+		i64 bytes_out;
+		i64 bytes_delta;		// 距上次刷新收发的字节数
+		i32 out_buffered;
+		i32 out_capacity;
+		i32 in_buffered;
+		i32 write_queue;
+		u32 rtt;				// 最近一次TCP_INFO抽样, 微秒, 0表示未抽样
+		u32 reserved;
+		u64 read_idle;			// 毫秒
+		u64 write_idle;
+	};
+
+	struct Data {
+		u32 magic;
+		u32 version;
+		i32 pid;
+		i32 interval;			// 刷新间隔, 毫秒
+		u64 time;				// 刷新时的uv_hrtime(), 纳秒
+		i64 publishes;
+		i32 acceptor_count;
+		i32 pool_count;
+		i32 connection_count;
+		i32 reserved;
+		ReactorRecord reactor;
+		AcceptorRecord acceptors[8];
+		PoolRecord pools[8];
+		ConnectionRecord connections[32];
+	};
+
+	// 写入期间seq为奇数
+	struct Layout {
+		std::atomic<u64> seq;
+		Data data;
+	};
+
+	explicit StatsSegment(EventReactor * reactor);
+	virtual ~StatsSegment();
+
+	// 创建/dev/shm/<name>, 每interval毫秒刷新一次, 返回0或错误码
+	i32 Open(const std::string & name, i32 interval = 1000);
+	// 停止刷新并删除共享内存
+	void Close();
+	bool IsOpened() const;
+	const std::string & GetName() const;
+	// 持有引用直到移除或Close()
+	bool AddAcceptor(SocketAcceptor * acceptor, const std::string & label);
+	void RemoveAcceptor(SocketAcceptor * acceptor);
+	bool AddPool(ConnectionPool * pool, const std::string & label);
+	void RemovePool(ConnectionPool * pool);
+	// 立即刷新
+	void Publish();
+
+	// 只读映射已有的共享内存, 失败返回nullptr
+	static const Layout * Attach(const std::string & name);
+	static void Detach(const Layout * layout);
+	// 复制一致的快照, 写入方持续写入导致多次重试失败时返回false
+	static bool Read(const Layout * layout, Data & data);
+
+	static const u32 kMagic = 0x5354454E;
+	static const u32 kVersion = 1;
+	static const i32 kMaxAcceptors = 8;
+	static const i32 kMaxPools = 8;
+	static const i32 kMaxConnections = 32;
+
+private:
+	void Fill(Data & data);
+
+	static void timer_cb(uv_timer_t * handle);
+	static void timer_close_cb(uv_handle_t * handle);
+
+private:
+	StatsSegment(StatsSegment &&) = delete;
+	StatsSegment(const StatsSegment &) = delete;
+	StatsSegment & operator=(StatsSegment &&) = delete;
+	StatsSegment & operator=(const StatsSegment &) = delete;
+
+private:
+	EventReactor * reactor_;
+	Layout * layout_;
+	std::string name_;
+	i32 interval_;
+	uv_timer_t * timer_;
+	std::vector<std::pair<SocketAcceptor *, std::string>> acceptors_;
+	std::vector<std::pair<ConnectionPool *, std::string>> pools_;
+	// 上次刷新时各连接的收发字节数
+	std::unordered_map<SocketConnection *, i64> last_bytes_;
+};
+
+inline bool StatsSegment::IsOpened() const {
+	return nullptr != layout_;
+}
+
+inline const std::string & StatsSegment::GetName() const {
+	return name_;
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -28,6 +28,7 @@
 #include "Common.h"
 #include "Sockets/Socket.h"
 #include "Sockets/StreamSocket.h"
+#include "Sockets/ServerSocketImpl.h"
 
 namespace Net {
 
@@ -42,6 +43,8 @@ public:
 	i32 Listen(i32 backlog = 128);
 	bool AcceptSocket(StreamSocket & socket, SocketAddress & client_address);
 	bool AcceptSocket(StreamSocket & socket);
+	i32 ReserveDescriptor();
+	i32 ShedPending();
 };
 
 inline i32 ServerSocket::Bind(const SocketAddress & address, bool ipv6_only, bool reuse_address) {
@@ -52,6 +55,14 @@ inline i32 ServerSocket::Listen(i32 backlog) {
 	return Impl()->Listen(backlog);
 }
 
+inline i32 ServerSocket::ReserveDescriptor() {
+	return static_cast<ServerSocketImpl *>(Impl())->ReserveDescriptor();
+}
+
+inline i32 ServerSocket::ShedPending() {
+	return static_cast<ServerSocketImpl *>(Impl())->ShedPending();
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -33,6 +33,18 @@ class COMMON_EXTERN ServerSocketImpl : public SocketImpl {
 public:
 	ServerSocketImpl();
 	virtual ~ServerSocketImpl();
+
+	virtual void Close() override;
+	// 预留一个文件描述符, 进程描述符耗尽时用它接入并关闭等待中的连接.
+	// libuv的uv__emfile_trick用每个loop一个的预留描述符处理EMFILE/ENFILE, 处理成功时不会回调;
+	// 回调收到这些错误说明它的预留已丢失(清空队列后被其他线程占用, 要等下次uv_tcp_init才重新预留),
+	// 而libuv会在同一次可读事件里立即重试accept, 不清空等待队列线程就一直空转, 所以这里另外预留一个
+	i32 ReserveDescriptor();
+	// 释放预留描述符, 接入并关闭所有等待中的连接后重新预留, 返回关闭的连接数
+	i32 ShedPending();
+
+private:
+	uv_file spare_;
 };
 
 }
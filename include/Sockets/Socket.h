@@ -39,18 +39,28 @@ public:
 	Socket & operator=(const Socket & other);
 	virtual ~Socket();
 	
-	void Open(uv_loop_t * loop);
+	void Open(uv_loop_t * loop, i32 family = AF_UNSPEC);
 	void Close();
 
 	void SetSendBufferSize(i32 size);
 	i32 GetSendBufferSize() const;
 	i32 GetWriteQueueSize() const;
+	i32 GetTcpInfo(TcpInfo & info) const;
 	void SetRecvBufferSize(i32 size);
 	i32 GetRecvBufferSize() const;
 	SocketAddress LocalAddress();
 	SocketAddress RemoteAddress();
 	void SetNoDelay();
 	void SetKeepAlive(i32 interval);
+	i32 SetBusyPoll(i32 usec);
+	i32 SetNotSentLowat(i32 bytes);
+	i32 SetQuickAck(bool enable);
+	i32 SetCork(bool enable);
+	i32 SetFastOpen(i32 queue_length);
+	i32 SetFastOpenConnect(bool enable);
+	i32 SetMaxPacingRate(u32 bytes_per_second);
+	i32 SetUserTimeout(i32 msec);
+	i32 SetOptions(const SocketOptions & options);
 
 	void SetUvData(UvData * data);
 	SocketImpl * Impl() const;
@@ -69,8 +79,8 @@ private:
 	SocketImpl * impl_;
 };
 
-inline void Socket::Open(uv_loop_t * loop) {
-	impl_->Open(loop);
+inline void Socket::Open(uv_loop_t * loop, i32 family) {
+	impl_->Open(loop, family);
 }
 
 inline void Socket::Close() {
@@ -89,6 +99,10 @@ inline i32 Socket::GetWriteQueueSize() const {
 	return impl_->GetWriteQueueSize();
 }
 
+inline i32 Socket::GetTcpInfo(TcpInfo & info) const {
+	return impl_->GetTcpInfo(info);
+}
+
 inline void Socket::SetRecvBufferSize(i32 size) {
 	impl_->SetRecvBufferSize(size);
 }
@@ -113,6 +127,42 @@ inline void Socket::SetKeepAlive(i32 interval) {
 	impl_->SetKeepAlive(interval);
 }
 
+inline i32 Socket::SetBusyPoll(i32 usec) {
+	return impl_->SetBusyPoll(usec);
+}
+
+inline i32 Socket::SetNotSentLowat(i32 bytes) {
+	return impl_->SetNotSentLowat(bytes);
+}
+
+inline i32 Socket::SetQuickAck(bool enable) {
+	return impl_->SetQuickAck(enable);
+}
+
+inline i32 Socket::SetCork(bool enable) {
+	return impl_->SetCork(enable);
+}
+
+inline i32 Socket::SetFastOpen(i32 queue_length) {
+	return impl_->SetFastOpen(queue_length);
+}
+
+inline i32 Socket::SetFastOpenConnect(bool enable) {
+	return impl_->SetFastOpenConnect(enable);
+}
+
+inline i32 Socket::SetMaxPacingRate(u32 bytes_per_second) {
+	return impl_->SetMaxPacingRate(bytes_per_second);
+}
+
+inline i32 Socket::SetUserTimeout(i32 msec) {
+	return impl_->SetUserTimeout(msec);
+}
+
+inline i32 Socket::SetOptions(const SocketOptions & options) {
+	return impl_->SetOptions(options);
+}
+
 inline void Socket::SetUvData(UvData * data) {
 	impl_->SetUvData(data);
 }
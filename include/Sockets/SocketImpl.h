@@ -30,6 +30,8 @@
 #include "RefCountedObject.h"
 #include "Address/SocketAddress.h"
 #include "Sockets/UvData.h"
+#include "Sockets/SocketOptions.h"
+#include "Sockets/TcpInfo.h"
 #include "Category.h"
 #include "uv.h"
 
@@ -39,7 +41,8 @@ class COMMON_EXTERN SocketImpl : public Common::RefCountedObject {
 public:
 	virtual ~SocketImpl();
 
-	virtual void Open(uv_loop_t * loop);
+	// family不为AF_UNSPEC时立即创建套接字, 以便在Connect()前设置选项
+	virtual void Open(uv_loop_t * loop, i32 family = AF_UNSPEC);
 	virtual void Close();
 	virtual i32 Bind(const SocketAddress & address, bool ipv6_only = false, bool reuse_address = false);
 	virtual i32 Listen(i32 backlog = 128);
@@ -50,6 +53,18 @@ public:
 	virtual i32 ShutdownRead();
 	virtual i32 Established();
 	virtual i32 Write(const i8 * data, i32 len, void * arg = nullptr);
+	// MSG_ZEROCOPY发送, 只在libuv写队列为空时直接send, 返回已发送字节数
+	// 每次成功调用对应一个完成通知, 通知返回前data不可修改
+	virtual i32 WriteZeroCopy(const i8 * data, i32 len);
+	// 读取错误队列中的完成通知, 返回完成的WriteZeroCopy次数, copied为其中被内核退化为拷贝的次数
+	virtual i32 ReapZeroCopy(i32 * copied = nullptr);
+	// 在事件循环线程中随可写事件用非阻塞sendfile发送文件[offset, offset + length), 期间不能有其他写请求
+	// 完成或Close()取消后回调SendFileCallback, 仅Linux支持
+	virtual i32 SendFile(uv_file file, i64 offset, i64 length, void * arg = nullptr);
+	// 停止读回调, 在事件循环线程中随可读事件把接下来的length字节写入文件(offset < 0时从文件当前位置写)或内存
+	// 优先用splice(socket -> pipe -> file), 完成后回调ReceiveFileCallback, 需调用Established()恢复读
+	virtual i32 ReceiveFile(uv_file file, i64 offset, i64 length, void * arg = nullptr);
+	virtual i32 ReceiveMemory(i8 * data, i64 length, void * arg = nullptr);
 
 	virtual void SetSendBufferSize(i32 size);
 	virtual i32 GetSendBufferSize() const;
@@ -60,13 +75,42 @@ public:
 	virtual SocketAddress RemoteAddress() const;
 	virtual void SetNoDelay();
 	virtual void SetKeepAlive(i32 interval);
+	// 返回SO_BUSY_POLL的设置结果, 调大超过net.core.busy_read需要CAP_NET_ADMIN; SO_PREFER_BUSY_POLL尽力设置
+	virtual i32 SetBusyPoll(i32 usec);
+	virtual i32 SetZeroCopy(bool enable);
+	// 内核中未发送数据超过bytes时不再报告可写, 数据留在应用层缓冲区
+	virtual i32 SetNotSentLowat(i32 bytes);
+	// 内核会自动退出quick ack模式, 需要时每次读后重新设置
+	virtual i32 SetQuickAck(bool enable);
+	virtual i32 SetCork(bool enable);
+	// 监听端在Listen()前设置队列长度, 连接端需Open()时指定family并在Connect()前开启
+	virtual i32 SetFastOpen(i32 queue_length);
+	virtual i32 SetFastOpenConnect(bool enable);
+	virtual i32 SetMaxPacingRate(u32 bytes_per_second);
+	virtual i32 SetUserTimeout(i32 msec);
+	// 应用缓冲区大小, TCP_NOTSENT_LOWAT, TCP_USER_TIMEOUT, SO_MAX_PACING_RATE和TCP_QUICKACK, 返回第一个错误
+	// TCP_CORK和TCP_FASTOPEN与时机相关, 由调用方处理
+	virtual i32 SetOptions(const SocketOptions & options);
+	// 读取TCP_INFO, 未确认和未发送字节数来自SIOCOUTQ/SIOCOUTQNSD
+	virtual i32 GetTcpInfo(TcpInfo & info) const;
 
 	virtual void SetUvData(UvData * data);
 
 protected:
 	SocketImpl();
+	i32 SetOption(i32 level, i32 option, i32 value);
 
 private:
+	struct FileRequest;
+
+	i32 WatchFileRequest(bool receive, uv_file file, i8 * memory, i64 offset, i64 length, void * arg);
+	static void FinishFileRequest(FileRequest * request, i32 status);
+	static void ClosePipe(FileRequest * request);
+	static void SendFileStep(FileRequest * request);
+	static void ReceiveStep(FileRequest * request);
+	static i32 DrainPipe(FileRequest * request, i64 size, i8 * buf, i64 buf_size);
+	static i32 WriteFile(FileRequest * request, const i8 * data, i64 size);
+
 	static void close_cb(uv_handle_t * handle);
 	static void connection_cb(uv_stream_t * server, int status);
 	static void connect_cb(uv_connect_t * req, int status);
@@ -74,6 +118,8 @@ private:
 	static void alloc_cb(uv_handle_t * handle, size_t suggested_size, uv_buf_t * buf);
 	static void read_cb(uv_stream_t * stream, ssize_t nread, const uv_buf_t * buf);
 	static void write_cb(uv_write_t * req, int status);
+	static void file_poll_cb(uv_poll_t * handle, int status, int events);
+	static void file_close_cb(uv_handle_t * handle);
 
 	SocketImpl(SocketImpl &&) = delete;
 	SocketImpl(const SocketImpl &) = delete;
@@ -83,6 +129,12 @@ private:
 protected:
 	uv_handle_t * handle_;
 	Logger::Category * logger_;
+
+private:
+	FileRequest * sendfile_;
+	FileRequest * recvfile_;
+
+	static const i64 kFileChunk = 1 << 20;
 };
 
 }
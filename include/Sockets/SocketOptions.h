@@ -0,0 +1,55 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef Net_Sockets_SocketOptions_INCLUDED
+#define Net_Sockets_SocketOptions_INCLUDED
+
+#include "Common.h"
+
+namespace Net {
+
+// 套接字选项配置, 由SocketAcceptor/SocketConnector应用到每个连接
+// 默认值表示不设置, 保持系统默认
+struct SocketOptions {
+	SocketOptions();
+
+	i32 send_buffer_size;	// SO_SNDBUF, <= 0不设置
+	i32 recv_buffer_size;	// SO_RCVBUF, <= 0不设置
+	i32 not_sent_lowat;		// TCP_NOTSENT_LOWAT, 内核中未发送数据的上限, < 0不设置
+	i32 user_timeout;		// TCP_USER_TIMEOUT, 数据未被确认的最长毫秒数, < 0不设置
+	i32 fast_open;			// TCP_FASTOPEN, 监听端为队列长度, 连接端 > 0开启, <= 0不设置
+	u32 max_pacing_rate;	// SO_MAX_PACING_RATE, 字节/秒, 0不设置
+	bool quick_ack;			// TCP_QUICKACK, 每次读后重新开启
+	bool cork;				// TCP_CORK, 同一轮事件循环中的写入在检查阶段一次发出
+};
+
+inline SocketOptions::SocketOptions()
+	: send_buffer_size(0), recv_buffer_size(0), not_sent_lowat(-1), user_timeout(-1)
+	, fast_open(0), max_pacing_rate(0), quick_ack(false), cork(false) {
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -46,6 +46,12 @@ public:
 	i32 ShutdownRead();
 	i32 Established();
 	i32 Write(const i8 * data, i32 len, void * arg = nullptr);
+	i32 WriteZeroCopy(const i8 * data, i32 len);
+	i32 ReapZeroCopy(i32 * copied = nullptr);
+	i32 SetZeroCopy(bool enable);
+	i32 SendFile(uv_file file, i64 offset, i64 length, void * arg = nullptr);
+	i32 ReceiveFile(uv_file file, i64 offset, i64 length, void * arg = nullptr);
+	i32 ReceiveMemory(i8 * data, i64 length, void * arg = nullptr);
 
 protected:
 	explicit StreamSocket(SocketImpl * impl);
@@ -79,6 +85,30 @@ inline i32 StreamSocket::Write(const i8 * data, i32 len, void * arg) {
 	return Impl()->Write(data, len, arg);
 }
 
+inline i32 StreamSocket::WriteZeroCopy(const i8 * data, i32 len) {
+	return Impl()->WriteZeroCopy(data, len);
+}
+
+inline i32 StreamSocket::ReapZeroCopy(i32 * copied) {
+	return Impl()->ReapZeroCopy(copied);
+}
+
+inline i32 StreamSocket::SetZeroCopy(bool enable) {
+	return Impl()->SetZeroCopy(enable);
+}
+
+inline i32 StreamSocket::SendFile(uv_file file, i64 offset, i64 length, void * arg) {
+	return Impl()->SendFile(file, offset, length, arg);
+}
+
+inline i32 StreamSocket::ReceiveFile(uv_file file, i64 offset, i64 length, void * arg) {
+	return Impl()->ReceiveFile(file, offset, length, arg);
+}
+
+inline i32 StreamSocket::ReceiveMemory(i8 * data, i64 length, void * arg) {
+	return Impl()->ReceiveMemory(data, length, arg);
+}
+
 }
 
 #endif
\ No newline at end of file
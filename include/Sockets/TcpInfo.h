@@ -0,0 +1,44 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef Net_Sockets_TcpInfo_INCLUDED
+#define Net_Sockets_TcpInfo_INCLUDED
+
+#include "Common.h"
+
+namespace Net {
+
+// 内核TCP状态快照(TCP_INFO), 仅Linux支持
+struct TcpInfo {
+	u32 rtt;			// 平滑RTT, 微秒
+	u32 rttvar;			// RTT偏差, 微秒
+	u32 retransmits;	// 累计重传段数
+	u32 snd_cwnd;		// 拥塞窗口, 段
+	u32 unacked;		// 已发送未确认的字节数
+	u32 notsent;		// 内核中尚未发送的字节数
+};
+
+}
+
+#endif
\ No newline at end of file
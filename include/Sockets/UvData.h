@@ -48,6 +48,8 @@ protected:
 	virtual void AllocCallback(uv_buf_t * buf) {}
 	virtual void ReadCallback(i32 status) {}
 	virtual void WrittenCallback(i32 status, void * arg) {}
+	virtual void SendFileCallback(i32 status, i64 sent, void * arg) {}
+	virtual void ReceiveFileCallback(i32 status, i64 received, void * arg) {}
 
 protected:
 	UvData(Logger::Category * logger = Logger::Category::GetCategory("UvData")) : logger_(logger) {}
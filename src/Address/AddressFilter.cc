@@ -0,0 +1,286 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Address/AddressFilter.h"
+#include <fstream>
+#include <sstream>
+
+namespace Net {
+
+namespace {
+
+// 网络字节序的地址转成4个主机序的32位字, 高位在前
+void FillKey(const u8 * bytes, i32 length, u32 * key) {
+	std::memset(key, 0, sizeof(u32) * 4);
+	for (i32 i = 0; i < length; ++i) {
+		key[i / 4] |= static_cast<u32>(bytes[i]) << (24 - (i % 4) * 8);
+	}
+}
+
+// IPv4映射地址转成IPv4的键
+void ToKey(const IPAddress & address, u32 * key, i32 & bits) {
+	static const u8 kMapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+	const u8 * bytes = static_cast<const u8 *>(address.Addr());
+	i32 length = static_cast<i32>(address.Length());
+	if (16 == length && 0 == std::memcmp(bytes, kMapped, sizeof(kMapped))) {
+		bytes += 12;
+		length = 4;
+	}
+	FillKey(bytes, length, key);
+	bits = length * 8;
+}
+
+inline i32 LeadingZeros(u32 value) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_clz(value);
+#else
+	i32 count = 0;
+	while (0 == (value & 0x80000000u)) {
+		value <<= 1;
+		++count;
+	}
+	return count;
+#endif
+}
+
+inline i32 Bit(const u32 * key, i32 index) {
+	return (key[index / 32] >> (31 - index % 32)) & 1;
+}
+
+// 前limit位中相同的前缀长度
+i32 CommonPrefix(const u32 * a, const u32 * b, i32 limit) {
+	i32 common = 0;
+	for (i32 i = 0; common < limit; ++i) {
+		u32 diff = a[i] ^ b[i];
+		if (diff) {
+			common += LeadingZeros(diff);
+			break;
+		}
+		common += 32;
+	}
+	return common < limit ? common : limit;
+}
+
+void MaskKey(u32 * key, i32 length) {
+	for (i32 i = 0; i < 4; ++i) {
+		i32 keep = length - i * 32;
+		if (keep <= 0) {
+			key[i] = 0;
+		} else if (keep < 32) {
+			key[i] &= ~(0xFFFFFFFFu >> keep);
+		}
+	}
+}
+
+}
+
+AddressFilter::AddressFilter(bool allow_default) : root4_(-1), root6_(-1), rules_(0), allow_default_(allow_default) {
+}
+
+AddressFilter::~AddressFilter() {
+}
+
+bool AddressFilter::Allow(const i8 * cidr) {
+	return Add(cidr, true);
+}
+
+bool AddressFilter::Deny(const i8 * cidr) {
+	return Add(cidr, false);
+}
+
+bool AddressFilter::Add(const i8 * cidr, bool allow) {
+	if (!cidr) {
+		return false;
+	}
+	i32 length = static_cast<i32>(std::strlen(cidr));
+	const i8 * slash = static_cast<const i8 *>(std::memchr(cidr, '/', length));
+	i32 address_length = slash ? static_cast<i32>(slash - cidr) : length;
+	IPAddress address;
+	if (0 == address_length || !IPAddress::TryParse(cidr, address_length, address)) {
+		return false;
+	}
+
+	i32 prefix = static_cast<i32>(address.Length()) * 8;
+	if (slash) {
+		const i8 * p = slash + 1;
+		if ('\0' == *p) {
+			return false;
+		}
+		i32 value = 0;
+		for (; *p; ++p) {
+			if (*p < '0' || *p > '9' || (value = value * 10 + (*p - '0')) > prefix) {
+				return false;
+			}
+		}
+		prefix = value;
+	}
+	return Add(address, prefix, allow);
+}
+
+bool AddressFilter::Add(const IPAddress & address, i32 prefix, bool allow) {
+	if (prefix < 0 || prefix > static_cast<i32>(address.Length()) * 8) {
+		return false;
+	}
+	u32 key[4];
+	i32 bits = 0;
+	ToKey(address, key, bits);
+	if (IPAddress::IPv6 == address.Family() && 32 == bits) {
+		// 覆盖整个::ffff:0:0/96的规则写入IPv4树, 更短的前缀按普通IPv6规则
+		if (prefix >= 96) {
+			prefix -= 96;
+		} else {
+			FillKey(static_cast<const u8 *>(address.Addr()), 16, key);
+			bits = 128;
+		}
+	}
+	MaskKey(key, prefix);
+	Insert(32 == bits ? root4_ : root6_, key, prefix, allow);
+	++rules_;
+	return true;
+}
+
+i32 AddressFilter::Load(const std::string & path) {
+	std::ifstream file(path.c_str());
+	if (!file) {
+		return UV_ENOENT;
+	}
+
+	i32 count = 0;
+	std::string line;
+	while (std::getline(file, line)) {
+		std::string::size_type comment = line.find('#');
+		if (comment != std::string::npos) {
+			line.erase(comment);
+		}
+		std::istringstream fields(line);
+		std::string action, cidr;
+		if (!(fields >> action)) {
+			continue;
+		}
+		if (!(fields >> cidr) || ("allow" != action && "deny" != action) || !Add(cidr.c_str(), "allow" == action)) {
+			return UV_EINVAL;
+		}
+		++count;
+	}
+	return count;
+}
+
+void AddressFilter::Clear() {
+	nodes_.clear();
+	root4_ = -1;
+	root6_ = -1;
+	rules_ = 0;
+}
+
+bool AddressFilter::IsAllowed(const IPAddress & address) const {
+	u32 key[4];
+	i32 bits = 0;
+	ToKey(address, key, bits);
+	i32 action = Lookup(32 == bits ? root4_ : root6_, key, bits);
+	return action < 0 ? allow_default_ : 1 == action;
+}
+
+void AddressFilter::Insert(i32 & root, const u32 * key, i32 length, bool allow) {
+	// 用下标而非指针记录父节点, 插入可能使nodes_重新分配
+	i32 parent = -1;
+	i32 side = 0;
+	i32 index = root;
+	Node leaf;
+	std::memcpy(leaf.key, key, sizeof(leaf.key));
+	leaf.length = length;
+	leaf.child[0] = leaf.child[1] = -1;
+	leaf.action = allow ? 1 : 0;
+
+	while (index >= 0) {
+		Node & node = nodes_[index];
+		i32 common = CommonPrefix(key, node.key, length < node.length ? length : node.length);
+		if (common == node.length) {
+			if (length == node.length) {
+				if (node.action >= 0) {
+					--rules_;
+				}
+				node.action = leaf.action;
+				return;
+			}
+			parent = index;
+			side = Bit(key, node.length);
+			index = node.child[side];
+			continue;
+		}
+
+		// 在common位处分裂
+		i32 old = index;
+		i32 old_side = Bit(node.key, common);
+		Node split;
+		std::memcpy(split.key, key, sizeof(split.key));
+		MaskKey(split.key, common);
+		split.length = common;
+		split.child[0] = split.child[1] = -1;
+		split.child[old_side] = old;
+		if (common == length) {
+			split.action = leaf.action;
+		} else {
+			split.action = -1;
+			split.child[old_side ^ 1] = static_cast<i32>(nodes_.size()) + 1;
+		}
+		index = static_cast<i32>(nodes_.size());
+		nodes_.push_back(split);
+		if (common != length) {
+			nodes_.push_back(leaf);
+		}
+		break;
+	}
+
+	if (index < 0) {
+		index = static_cast<i32>(nodes_.size());
+		nodes_.push_back(leaf);
+	}
+	if (parent < 0) {
+		root = index;
+	} else {
+		nodes_[parent].child[side] = index;
+	}
+}
+
+i32 AddressFilter::Lookup(i32 root, const u32 * key, i32 length) const {
+	i32 action = -1;
+	i32 index = root;
+	while (index >= 0) {
+		const Node & node = nodes_[index];
+		if (node.length > length || CommonPrefix(key, node.key, node.length) < node.length) {
+			break;
+		}
+		if (node.action >= 0) {
+			action = node.action;
+		}
+		if (node.length == length) {
+			break;
+		}
+		index = node.child[Bit(key, node.length)];
+	}
+	return action;
+}
+
+}
\ No newline at end of file
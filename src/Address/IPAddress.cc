@@ -22,105 +22,364 @@
  * SOFTWARE.
  */
 
+
 #include "Address/IPAddress.h"
 #include "NetworkException.h"
+#include <type_traits>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NET_ADDRESS_SSE2
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <net/if.h>
+#endif
 
 namespace Net {
 
+static_assert(std::is_trivially_copyable<IPAddress>::value, "IPAddress must be trivially copyable");
+
 const AddressFamily::eFamily IPAddress::IPv4;
 const AddressFamily::eFamily IPAddress::IPv6;
+const i32 IPAddress::kMaxStringLength;
 
-IPAddress::IPAddress() {
-	NewIPv4();
+namespace {
+
+// 最长的IPv6文本 "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255"
+const i32 kMaxIPv6Length = 45;
+const i32 kClassifySize = 48;
+
+inline bool IsSpace(i8 c) {
+	return ' ' == c || ('\t' <= c && c <= '\r');
 }
 
-IPAddress::IPAddress(const i8 * ip) {
-	Common::SDString trim_ip = Common::SDString(ip).TrimStartAndEnd();
-	if (trim_ip.Empty() || trim_ip == "0.0.0.0") {
-		NewIPv4();
-		return;
+// 点分十进制, 每段1-3位且不超过255, 不允许前导0, 与inet_pton一致
+bool ParseIPv4(const i8 * s, i32 len, u8 * out) {
+	const i8 * end = s + len;
+	for (i32 part = 0; part < 4; ++part) {
+		if (part > 0) {
+			if (s == end || '.' != *s) {
+				return false;
+			}
+			++s;
+		}
+		i32 digits = 0;
+		u32 value = 0;
+		while (s != end && '0' <= *s && *s <= '9') {
+			if (digits > 0 && 0 == value) {
+				return false;
+			}
+			value = value * 10 + static_cast<u32>(*s - '0');
+			if (++digits > 3 || value > 255) {
+				return false;
+			}
+			++s;
+		}
+		if (0 == digits) {
+			return false;
+		}
+		out[part] = static_cast<u8>(value);
 	}
+	return s == end;
+}
+
+// 一次分类16字节: 冒号/点的位图, 非法字符位图, 以及每个字节对应的16进制值
+struct HexClass {
+	u64 colons;
+	u64 dots;
+	u64 invalid;
+	u8 nibbles[kClassifySize];
+};
+
+void Classify(const i8 * s, i32 len, HexClass & hc) {
+	hc.colons = 0;
+	hc.dots = 0;
+	hc.invalid = 0;
+#ifdef NET_ADDRESS_SSE2
+	alignas(16) i8 buf[kClassifySize];
+	std::memset(buf, 0, sizeof(buf));
+	std::memcpy(buf, s, len);
+	const __m128i zero = _mm_set1_epi8('0' - 1);
+	const __m128i nine = _mm_set1_epi8('9' + 1);
+	const __m128i lower_a = _mm_set1_epi8('a' - 1);
+	const __m128i lower_f = _mm_set1_epi8('f' + 1);
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i colon = _mm_set1_epi8(':');
+	const __m128i dot = _mm_set1_epi8('.');
+	const __m128i digit_base = _mm_set1_epi8('0');
+	const __m128i alpha_base = _mm_set1_epi8('a' - 10);
+	for (i32 i = 0; i < kClassifySize; i += 16) {
+		__m128i x = _mm_load_si128(reinterpret_cast<const __m128i *>(buf + i));
+		__m128i lower = _mm_or_si128(x, case_bit);
+		// 非ASCII字节按有符号比较为负数, 不会落入任何区间
+		__m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(x, zero), _mm_cmplt_epi8(x, nine));
+		__m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, lower_a), _mm_cmplt_epi8(lower, lower_f));
+		__m128i is_colon = _mm_cmpeq_epi8(x, colon);
+		__m128i is_dot = _mm_cmpeq_epi8(x, dot);
+		__m128i valid = _mm_or_si128(_mm_or_si128(is_digit, is_alpha), _mm_or_si128(is_colon, is_dot));
+		__m128i nibble = _mm_or_si128(_mm_and_si128(is_digit, _mm_sub_epi8(x, digit_base)), _mm_andnot_si128(is_digit, _mm_sub_epi8(lower, alpha_base)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(hc.nibbles + i), nibble);
+		hc.colons |= static_cast<u64>(static_cast<u32>(_mm_movemask_epi8(is_colon))) << i;
+		hc.dots |= static_cast<u64>(static_cast<u32>(_mm_movemask_epi8(is_dot))) << i;
+		hc.invalid |= static_cast<u64>(static_cast<u32>(~_mm_movemask_epi8(valid) & 0xFFFF)) << i;
+	}
+	hc.invalid &= (static_cast<u64>(1) << len) - 1;
+#else
+	for (i32 i = 0; i < len; ++i) {
+		i8 c = s[i];
+		i8 lower = static_cast<i8>(c | 0x20);
+		if ('0' <= c && c <= '9') {
+			hc.nibbles[i] = static_cast<u8>(c - '0');
+		} else if ('a' <= lower && lower <= 'f') {
+			hc.nibbles[i] = static_cast<u8>(lower - 'a' + 10);
+		} else if (':' == c) {
+			hc.colons |= static_cast<u64>(1) << i;
+		} else if ('.' == c) {
+			hc.dots |= static_cast<u64>(1) << i;
+		} else {
+			hc.invalid |= static_cast<u64>(1) << i;
+		}
+	}
+#endif
+}
 
-	if (trim_ip == "::") {
-		NewIPv6();
-		return;
+inline i32 CountTrailingZeros(u64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(value);
+#else
+	i32 count = 0;
+	while (0 == (value & 1)) {
+		value >>= 1;
+		++count;
 	}
+	return count;
+#endif
+}
 
-	IPv4AddressImpl ipv4(IPv4AddressImpl::Parse(*trim_ip));
-	if (ipv4 != IPv4AddressImpl()) {
-		NewIPv4(ipv4.Addr());
-		return;
+// 冒号分隔的16进制段, 最多一个"::", 最后32位可以是点分十进制
+bool ParseIPv6(const i8 * s, i32 len, u8 * out) {
+	if (len < 2 || len > kMaxIPv6Length) {
+		return false;
+	}
+	HexClass hc;
+	Classify(s, len, hc);
+	if (hc.invalid) {
+		return false;
 	}
 
-	IPv6AddressImpl ipv6(IPv6AddressImpl::Parse(*trim_ip));
-	if (ipv6 != IPv6AddressImpl()) {
-		NewIPv6(ipv6.Addr(), ipv6.Scope());
-		return;
+	u16 groups[8];
+	i32 count = 0;
+	i32 gap = -1;
+	i32 pos = 0;
+	if (':' == s[0]) {
+		if (':' != s[1]) {
+			return false;
+		}
+		gap = 0;
+		pos = 2;
+	}
+	while (pos < len) {
+		u64 rest = hc.colons >> pos;
+		i32 end = rest ? pos + CountTrailingZeros(rest) : len;
+		if ((hc.dots >> pos) & ((static_cast<u64>(1) << (end - pos)) - 1)) {
+			// 内嵌IPv4只能是最后一段
+			u8 ipv4[4];
+			if (end != len || count > 6 || !ParseIPv4(s + pos, len - pos, ipv4)) {
+				return false;
+			}
+			groups[count++] = static_cast<u16>((ipv4[0] << 8) | ipv4[1]);
+			groups[count++] = static_cast<u16>((ipv4[2] << 8) | ipv4[3]);
+			pos = len;
+			break;
+		}
+		i32 digits = end - pos;
+		if (0 == digits || digits > 4 || count >= 8) {
+			return false;
+		}
+		u32 value = 0;
+		for (i32 i = pos; i < end; ++i) {
+			value = (value << 4) | hc.nibbles[i];
+		}
+		groups[count++] = static_cast<u16>(value);
+		pos = end;
+		if (pos == len) {
+			break;
+		}
+		if (++pos == len) {
+			return false;
+		}
+		if (':' == s[pos]) {
+			if (gap >= 0) {
+				return false;
+			}
+			gap = count;
+			++pos;
+		}
 	}
 
-	throw NetworkException(*Common::SDString::Format("invalid or unsupported address %s", *trim_ip));
+	if (gap < 0 ? 8 != count : count > 7) {
+		return false;
+	}
+	std::memset(out, 0, 16);
+	i32 zeros = 8 - count;
+	for (i32 i = 0, index = 0; i < count; ++i, ++index) {
+		if (i == gap) {
+			index += zeros;
+		}
+		out[index * 2] = static_cast<u8>(groups[i] >> 8);
+		out[index * 2 + 1] = static_cast<u8>(groups[i]);
+	}
+	return true;
 }
 
-IPAddress::IPAddress(const void * addr, socklen_t length, u32 scope) {
-	if (sizeof(struct in_addr) == length) {
-		NewIPv4(addr);
-	} else if (sizeof(struct in6_addr) == length) {
-		NewIPv6(addr, scope);
-	} else {
-		throw NetworkException("invalid address length");
+// 数字或接口名
+u32 ParseScope(const i8 * s, i32 len) {
+	u32 scope = 0;
+	i32 i = 0;
+	while (i < len && '0' <= s[i] && s[i] <= '9') {
+		scope = scope * 10 + static_cast<u32>(s[i] - '0');
+		++i;
 	}
+	if (i == len) {
+		return scope;
+	}
+#ifndef _WIN32
+	i8 name[IF_NAMESIZE];
+	if (len < IF_NAMESIZE) {
+		std::memcpy(name, s, len);
+		name[len] = 0;
+		return if_nametoindex(name);
+	}
+#endif
+	return 0;
 }
 
-IPAddress::IPAddress(const IPAddress & other) {
-	if (IPv4 == other.Family()) {
-		NewIPv4(other.Addr());
-	} else if (IPv6 == other.Family()) {
-		NewIPv6(other.Addr(), other.Scope());
+i8 * FormatIPv4(const u8 * addr, i8 * p) {
+	for (i32 i = 0; i < 4; ++i) {
+		if (i > 0) {
+			*p++ = '.';
+		}
+		u32 value = addr[i];
+		if (value >= 100) {
+			*p++ = static_cast<i8>('0' + value / 100);
+			value %= 100;
+			*p++ = static_cast<i8>('0' + value / 10);
+		} else if (value >= 10) {
+			*p++ = static_cast<i8>('0' + value / 10);
+		}
+		*p++ = static_cast<i8>('0' + value % 10);
 	}
+	return p;
 }
 
-IPAddress & IPAddress::operator=(const IPAddress & other) {
-	if (this != std::addressof(other)) {
-		Destroy();
-		if (IPv4 == other.Family()) {
-			NewIPv4(other.Addr());
-		} else if (IPv6 == other.Family()) {
-			NewIPv6(other.Addr(), other.Scope());
+// 与uv_inet_ntop输出一致: 压缩最长(相同取最先)的连续0段, 兼容和映射地址的后32位用点分十进制
+i8 * FormatIPv6(const u8 * addr, i8 * p) {
+	static const i8 kHex[] = "0123456789abcdef";
+	u32 words[8];
+	for (i32 i = 0; i < 8; ++i) {
+		words[i] = (static_cast<u32>(addr[i * 2]) << 8) | addr[i * 2 + 1];
+	}
+	i32 best_base = -1, best_len = 0, cur_base = -1, cur_len = 0;
+	for (i32 i = 0; i < 8; ++i) {
+		if (0 == words[i]) {
+			if (cur_base < 0) {
+				cur_base = i;
+				cur_len = 1;
+			} else {
+				++cur_len;
+			}
+			if (cur_len > best_len) {
+				best_base = cur_base;
+				best_len = cur_len;
+			}
+		} else {
+			cur_base = -1;
 		}
 	}
-	return *this;
+	if (best_len < 2) {
+		best_base = -1;
+	}
+
+	for (i32 i = 0; i < 8; ++i) {
+		if (best_base >= 0 && i >= best_base && i < best_base + best_len) {
+			if (i == best_base) {
+				*p++ = ':';
+			}
+			continue;
+		}
+		if (i > 0) {
+			*p++ = ':';
+		}
+		if (6 == i && 0 == best_base && (6 == best_len || (7 == best_len && 1 != words[7]) || (5 == best_len && 0xFFFF == words[5]))) {
+			return FormatIPv4(addr + 12, p);
+		}
+		u32 word = words[i];
+		i32 shift = word >= 0x1000 ? 12 : (word >= 0x100 ? 8 : (word >= 0x10 ? 4 : 0));
+		for (; shift >= 0; shift -= 4) {
+			*p++ = kHex[(word >> shift) & 0xF];
+		}
+	}
+	if (best_base >= 0 && best_base + best_len == 8) {
+		*p++ = ':';
+	}
+	return p;
 }
 
-IPAddress::~IPAddress() {
-	Destroy();
 }
 
-bool IPAddress::operator==(const IPAddress & other) const {
-	return Length() == other.Length() && Scope() == other.Scope() && 0 == std::memcmp(Addr(), other.Addr(), Length());
+IPAddress::IPAddress() {
+	SetIPv4(nullptr);
 }
 
-bool IPAddress::operator!=(const IPAddress & other) const {
-	return !(*this == other);
+IPAddress::IPAddress(const i8 * ip) {
+	if (!TryParse(ip, *this)) {
+		throw NetworkException(*Common::SDString::Format("invalid or unsupported address %s", *Common::SDString(ip).TrimStartAndEnd()));
+	}
 }
 
-void IPAddress::NewIPv4() {
-	new(Storage())IPv4AddressImpl();
+IPAddress::IPAddress(const void * addr, socklen_t length, u32 scope) {
+	if (sizeof(struct in_addr) == length) {
+		SetIPv4(addr);
+	} else if (sizeof(struct in6_addr) == length) {
+		SetIPv6(addr, scope);
+	} else {
+		throw NetworkException("invalid address length");
+	}
 }
 
-void IPAddress::NewIPv4(const void * addr) {
-	new(Storage())IPv4AddressImpl(addr);
+Common::SDString IPAddress::ToString() const {
+	i8 buf[kMaxStringLength];
+	Format(buf, sizeof(buf));
+	return Common::SDString(buf);
 }
 
-void IPAddress::NewIPv6() {
-	new(Storage())IPv6AddressImpl();
+i32 IPAddress::Format(i8 * buf, i32 size) const {
+	i8 temp[kMaxStringLength];
+	i8 * end = IPv4 == family_ ? FormatIPv4(reinterpret_cast<const u8 *>(&addr_), temp) : FormatIPv6(reinterpret_cast<const u8 *>(&addr_), temp);
+	i32 length = static_cast<i32>(end - temp);
+	if (length >= size) {
+		return UV_ENOSPC;
+	}
+	std::memcpy(buf, temp, length);
+	buf[length] = 0;
+	return length;
 }
 
-void IPAddress::NewIPv6(const void * addr, u32 scope) {
-	new(Storage())IPv6AddressImpl(addr, scope);
+void IPAddress::SetIPv4(const void * addr) {
+	std::memset(&addr_, 0, sizeof(addr_));
+	if (addr) {
+		std::memcpy(&addr_.v4, addr, sizeof(addr_.v4));
+	}
+	scope_ = 0;
+	family_ = IPv4;
 }
 
-void IPAddress::Destroy() {
-	Impl()->~IPAddressImpl();
+void IPAddress::SetIPv6(const void * addr, u32 scope) {
+	std::memset(&addr_, 0, sizeof(addr_));
+	if (addr) {
+		std::memcpy(&addr_.v6, addr, sizeof(addr_.v6));
+	}
+	scope_ = scope;
+	family_ = IPv6;
 }
 
 IPAddress IPAddress::Parse(const i8 * ip) {
@@ -128,30 +387,42 @@ IPAddress IPAddress::Parse(const i8 * ip) {
 }
 
 bool IPAddress::TryParse(const i8 * ip, IPAddress & result) {
-	Common::SDString trim_ip = Common::SDString(ip).TrimStartAndEnd();
-	if (trim_ip.Empty() || trim_ip == "0.0.0.0") {
-		result.NewIPv4();
-		return true;
-	}
+	return TryParse(ip, ip ? static_cast<i32>(std::strlen(ip)) : 0, result);
+}
 
-	if (trim_ip == "::") {
-		result.NewIPv6();
-		return true;
+bool IPAddress::TryParse(const i8 * ip, i32 length, IPAddress & result) {
+	const i8 * begin = ip;
+	const i8 * end = ip + (length > 0 ? length : 0);
+	while (begin != end && IsSpace(*begin)) {
+		++begin;
 	}
-
-	IPv4AddressImpl ipv4(IPv4AddressImpl::Parse(*trim_ip));
-	if (ipv4 != IPv4AddressImpl()) {
-		result.NewIPv4(ipv4.Addr());
+	while (begin != end && IsSpace(*(end - 1))) {
+		--end;
+	}
+	if (begin == end) {
+		result.SetIPv4(nullptr);
 		return true;
 	}
 
-	IPv6AddressImpl ipv6(IPv6AddressImpl::Parse(*trim_ip));
-	if (ipv6 != IPv6AddressImpl()) {
-		result.NewIPv6(ipv6.Addr(), ipv6.Scope());
+	i32 len = static_cast<i32>(end - begin);
+	const i8 * percent = static_cast<const i8 *>(std::memchr(begin, '%', len));
+	const i8 * colon = static_cast<const i8 *>(std::memchr(begin, ':', percent ? percent - begin : len));
+	if (!colon) {
+		u8 ipv4[4];
+		if (percent || !ParseIPv4(begin, len, ipv4)) {
+			return false;
+		}
+		result.SetIPv4(ipv4);
 		return true;
 	}
 
-	return false;
+	u8 ipv6[16];
+	i32 addr_len = percent ? static_cast<i32>(percent - begin) : len;
+	if (!ParseIPv6(begin, addr_len, ipv6)) {
+		return false;
+	}
+	result.SetIPv6(ipv6, percent ? ParseScope(percent + 1, static_cast<i32>(end - percent - 1)) : 0);
+	return true;
 }
 
 }
\ No newline at end of file
@@ -22,13 +22,20 @@
  * SOFTWARE.
  */
 
+
 #include "Address/SocketAddress.h"
 #include "NetworkException.h"
+#include <algorithm>
+#include <type_traits>
 
 namespace Net {
 
+static_assert(std::is_trivially_copyable<SocketAddress>::value, "SocketAddress must be trivially copyable");
+
+const i32 SocketAddress::kMaxStringLength;
+
 SocketAddress::SocketAddress() {
-	NewIPv4();
+	Init(IPAddress(), 0);
 }
 
 SocketAddress::SocketAddress(u16 port) {
@@ -44,80 +51,64 @@ SocketAddress::SocketAddress(const IPAddress & host, u16 port) {
 }
 
 SocketAddress::SocketAddress(const struct sockaddr * addr, socklen_t length) {
+	std::memset(&addr_, 0, sizeof(addr_));
 	if (length == sizeof(struct sockaddr_in) && AF_INET == addr->sa_family) {
-		NewIPv4(reinterpret_cast<const struct sockaddr_in *>(addr));
+		std::memcpy(&addr_.v4, addr, sizeof(addr_.v4));
 	} else if (length == sizeof(struct sockaddr_in6) && AF_INET6 == addr->sa_family) {
-		NewIPv6(reinterpret_cast<const struct sockaddr_in6 *>(addr));
+		std::memcpy(&addr_.v6, addr, sizeof(addr_.v6));
 	} else {
 		throw NetworkException("invalid address length or family");
 	}
 }
 
-SocketAddress::SocketAddress(const SocketAddress & other) {
-	if (IPAddress::IPv4 == other.Family()) {
-		NewIPv4(reinterpret_cast<const struct sockaddr_in *>(other.Addr()));
-	} else if (IPAddress::IPv6 == other.Family()) {
-		NewIPv6(reinterpret_cast<const struct sockaddr_in6 *>(other.Addr()));
-	}
+Common::SDString SocketAddress::ToString() const {
+	i8 buf[kMaxStringLength];
+	Format(buf, sizeof(buf));
+	return Common::SDString(buf);
 }
 
-SocketAddress & SocketAddress::operator=(const SocketAddress & other) {
-	if (this != std::addressof(other)) {
-		Destroy();
-		if (IPAddress::IPv4 == other.Family()) {
-			NewIPv4(reinterpret_cast<const struct sockaddr_in *>(other.Addr()));
-		} else if (IPAddress::IPv6 == other.Family()) {
-			NewIPv6(reinterpret_cast<const struct sockaddr_in6 *>(other.Addr()));
-		}
+i32 SocketAddress::Format(i8 * buf, i32 size) const {
+	i8 temp[kMaxStringLength];
+	i8 * p = temp;
+	bool ipv6 = AF_INET6 == addr_.sa.sa_family;
+	if (ipv6) {
+		*p++ = '[';
 	}
-	return *this;
-}
-
-SocketAddress::~SocketAddress() {
-	Destroy();
-}
-
-bool SocketAddress::operator==(const SocketAddress & other) const {
-	return Host() == other.Host() && Port() == other.Port();
-}
-
-bool SocketAddress::operator!=(const SocketAddress & other) const {
-	return !(*this == other);
+	p += Host().Format(p, IPAddress::kMaxStringLength);
+	if (ipv6) {
+		*p++ = ']';
+	}
+	*p++ = ':';
+	// 端口倒序写出再翻转
+	u32 port = Port();
+	i8 * digits = p;
+	do {
+		*p++ = static_cast<i8>('0' + port % 10);
+		port /= 10;
+	} while (port > 0);
+	std::reverse(digits, p);
+
+	i32 length = static_cast<i32>(p - temp);
+	if (length >= size) {
+		return UV_ENOSPC;
+	}
+	std::memcpy(buf, temp, length);
+	buf[length] = 0;
+	return length;
 }
 
 void SocketAddress::Init(const IPAddress & host, u16 port) {
+	std::memset(&addr_, 0, sizeof(addr_));
 	if (IPAddress::IPv4 == host.Family()) {
-		struct sockaddr_in addr;
-		std::memset(&addr, 0, sizeof(addr));
-		addr.sin_family = host.AF();
-		std::memcpy(&addr.sin_addr, host.Addr(), host.Length());
-		addr.sin_port = htons(port);
-		NewIPv4(&addr);
-	} else if (IPAddress::IPv6 == host.Family()) {
-		struct sockaddr_in6 addr;
-		std::memset(&addr, 0, sizeof(addr));
-		addr.sin6_family = host.AF();
-		std::memcpy(&addr.sin6_addr, host.Addr(), host.Length());
-		addr.sin6_scope_id = host.Scope();
-		addr.sin6_port = htons(port);
-		NewIPv6(&addr);
+		addr_.v4.sin_family = AF_INET;
+		std::memcpy(&addr_.v4.sin_addr, host.Addr(), host.Length());
+		addr_.v4.sin_port = htons(port);
+	} else {
+		addr_.v6.sin6_family = AF_INET6;
+		std::memcpy(&addr_.v6.sin6_addr, host.Addr(), host.Length());
+		addr_.v6.sin6_scope_id = host.Scope();
+		addr_.v6.sin6_port = htons(port);
 	}
 }
 
-void SocketAddress::NewIPv4() {
-	new(Storage())IPv4SocketAddressImpl();
-}
-
-void SocketAddress::NewIPv4(const struct sockaddr_in * addr) {
-	new(Storage())IPv4SocketAddressImpl(addr);
-}
-
-void SocketAddress::NewIPv6(const struct sockaddr_in6 * addr) {
-	new(Storage())IPv6SocketAddressImpl(addr);
-}
-
-void SocketAddress::Destroy() {
-	Impl()->~SocketAddressImpl();
-}
-
 }
\ No newline at end of file
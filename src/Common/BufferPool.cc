@@ -0,0 +1,358 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Common/BufferPool.h"
+#include "Allocator.h"
+#include <mutex>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace Net {
+
+const i32 BufferPool::kMinBlockShift;
+const i32 BufferPool::kClassCount;
+const i32 BufferPool::kMaxBlockSize;
+const i32 BufferPool::kLocalCacheMax;
+const i32 BufferPool::kTransferBatch;
+
+namespace {
+
+// 块头, 保持16字节对齐
+struct BlockHeader {
+	i32 index;
+	i32 from_slab;
+	i64 reserved;
+};
+
+struct FreeNode {
+	FreeNode * next;
+};
+
+struct SizeClass {
+	SizeClass() : head(nullptr), count(0), allocs(0), frees(0), local_hits(0), central_hits(0), heap_allocs(0) {}
+
+	std::mutex mutex;
+	FreeNode * head;
+	i64 count;
+	std::atomic<i64> allocs;
+	std::atomic<i64> frees;
+	std::atomic<i64> local_hits;
+	std::atomic<i64> central_hits;
+	std::atomic<i64> heap_allocs;
+};
+
+struct SlabArena {
+	SlabArena() : cursor(nullptr), remaining(0), enabled(false) {}
+
+	std::mutex mutex;
+	i8 * cursor;
+	size_t remaining;
+	std::atomic<bool> enabled;
+};
+
+SizeClass kClasses[BufferPool::kClassCount];
+SlabArena kArena;
+const size_t kSlabSize = 2 * 1024 * 1024;
+
+inline i32 BlockSizeOf(i32 index) {
+	return 1 << (BufferPool::kMinBlockShift + index);
+}
+
+inline i32 ClassIndexOf(i32 size) {
+	i32 index = 0;
+	while (index < BufferPool::kClassCount && BlockSizeOf(index) < size) {
+		++index;
+	}
+	return index;
+}
+
+inline BlockHeader * HeaderOf(void * ptr) {
+	return static_cast<BlockHeader *>(ptr) - 1;
+}
+
+inline FreeNode * NodeOf(BlockHeader * header) {
+	return reinterpret_cast<FreeNode *>(header + 1);
+}
+
+void * AllocateFromSlab(size_t size) {
+#ifdef __linux__
+	size = (size + 15) & ~static_cast<size_t>(15);
+	std::lock_guard<std::mutex> lock(kArena.mutex);
+	if (kArena.remaining < size) {
+		void * slab = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		slab = mmap(nullptr, kSlabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+		if (MAP_FAILED == slab) {
+			slab = mmap(nullptr, kSlabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (MAP_FAILED == slab) {
+				return nullptr;
+			}
+#ifdef MADV_HUGEPAGE
+			madvise(slab, kSlabSize, MADV_HUGEPAGE);
+#endif
+		}
+		kArena.cursor = static_cast<i8 *>(slab);
+		kArena.remaining = kSlabSize;
+	}
+	void * block = kArena.cursor;
+	kArena.cursor += size;
+	kArena.remaining -= size;
+	return block;
+#else
+	return nullptr;
+#endif
+}
+
+BlockHeader * NewBlock(i32 index) {
+	size_t size = sizeof(BlockHeader) + BlockSizeOf(index);
+	BlockHeader * header = nullptr;
+	i32 from_slab = 0;
+	if (kArena.enabled.load(std::memory_order_relaxed)) {
+		header = static_cast<BlockHeader *>(AllocateFromSlab(size));
+		from_slab = header ? 1 : 0;
+	}
+	if (!header) {
+		header = static_cast<BlockHeader *>(jc_malloc(size));
+		if (!header) {
+			return nullptr;
+		}
+	}
+	header->index = index;
+	header->from_slab = from_slab;
+	header->reserved = 0;
+	return header;
+}
+
+void ReturnToCentral(i32 index, FreeNode * head, FreeNode * tail, i32 count) {
+	SizeClass & sc = kClasses[index];
+	std::lock_guard<std::mutex> lock(sc.mutex);
+	tail->next = sc.head;
+	sc.head = head;
+	sc.count += count;
+}
+
+struct LocalCache {
+	LocalCache() {
+		std::memset(head, 0, sizeof(head));
+		std::memset(count, 0, sizeof(count));
+	}
+
+	~LocalCache();
+
+	void Flush() {
+		for (i32 i = 0; i < BufferPool::kClassCount; ++i) {
+			if (head[i]) {
+				FreeNode * tail = head[i];
+				while (tail->next) {
+					tail = tail->next;
+				}
+				ReturnToCentral(i, head[i], tail, count[i]);
+				head[i] = nullptr;
+				count[i] = 0;
+			}
+		}
+	}
+
+	FreeNode * head[BufferPool::kClassCount];
+	i32 count[BufferPool::kClassCount];
+};
+
+thread_local LocalCache kLocalCache;
+// 主线程的thread_local先于静态对象析构, 之后释放的块直接走中心链表
+thread_local bool kLocalCacheDestroyed = false;
+
+LocalCache::~LocalCache() {
+	Flush();
+	kLocalCacheDestroyed = true;
+}
+
+void TakeFromCentral(i32 index, FreeNode *& head, i32 & count, i32 batch) {
+	SizeClass & sc = kClasses[index];
+	std::lock_guard<std::mutex> lock(sc.mutex);
+	i32 taken = 0;
+	while (sc.head && taken < batch) {
+		FreeNode * next = sc.head->next;
+		sc.head->next = head;
+		head = sc.head;
+		sc.head = next;
+		++taken;
+	}
+	sc.count -= taken;
+	count += taken;
+}
+
+}
+
+void * BufferPool::Allocate(i32 size) {
+	if (size <= 0) {
+		return nullptr;
+	}
+
+	i32 index = ClassIndexOf(size);
+	if (index >= kClassCount) {
+		BlockHeader * header = static_cast<BlockHeader *>(jc_malloc(sizeof(BlockHeader) + size));
+		if (!header) {
+			return nullptr;
+		}
+		header->index = kClassCount;
+		header->from_slab = 0;
+		header->reserved = 0;
+		return header + 1;
+	}
+
+	SizeClass & sc = kClasses[index];
+	sc.allocs.fetch_add(1, std::memory_order_relaxed);
+
+	if (kLocalCacheDestroyed) {
+		FreeNode * node = nullptr;
+		i32 count = 0;
+		TakeFromCentral(index, node, count, 1);
+		if (node) {
+			sc.central_hits.fetch_add(1, std::memory_order_relaxed);
+			return node;
+		}
+	} else {
+		LocalCache & cache = kLocalCache;
+		FreeNode * node = cache.head[index];
+		if (node) {
+			cache.head[index] = node->next;
+			--cache.count[index];
+			sc.local_hits.fetch_add(1, std::memory_order_relaxed);
+			return node;
+		}
+
+		TakeFromCentral(index, cache.head[index], cache.count[index], kTransferBatch);
+		node = cache.head[index];
+		if (node) {
+			cache.head[index] = node->next;
+			--cache.count[index];
+			sc.central_hits.fetch_add(1, std::memory_order_relaxed);
+			return node;
+		}
+	}
+
+	BlockHeader * header = NewBlock(index);
+	if (!header) {
+		sc.allocs.fetch_sub(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	sc.heap_allocs.fetch_add(1, std::memory_order_relaxed);
+	return header + 1;
+}
+
+void BufferPool::DeAllocate(void * ptr) {
+	if (!ptr) {
+		return;
+	}
+
+	BlockHeader * header = HeaderOf(ptr);
+	i32 index = header->index;
+	if (index >= kClassCount) {
+		jc_free(header);
+		return;
+	}
+
+	kClasses[index].frees.fetch_add(1, std::memory_order_relaxed);
+
+	FreeNode * node = NodeOf(header);
+	if (kLocalCacheDestroyed) {
+		node->next = nullptr;
+		ReturnToCentral(index, node, node, 1);
+		return;
+	}
+	LocalCache & cache = kLocalCache;
+	node->next = cache.head[index];
+	cache.head[index] = node;
+	if (++cache.count[index] > kLocalCacheMax) {
+		FreeNode * head = cache.head[index];
+		FreeNode * tail = head;
+		for (i32 i = 1; i < kTransferBatch; ++i) {
+			tail = tail->next;
+		}
+		cache.head[index] = tail->next;
+		cache.count[index] -= kTransferBatch;
+		ReturnToCentral(index, head, tail, kTransferBatch);
+	}
+}
+
+void BufferPool::SetHugePages(bool enable) {
+	kArena.enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool BufferPool::IsHugePages() {
+	return kArena.enabled.load(std::memory_order_relaxed);
+}
+
+i32 BufferPool::GetClassCount() {
+	return kClassCount;
+}
+
+bool BufferPool::GetClassStats(i32 index, ClassStats & stats) {
+	if (index < 0 || index >= kClassCount) {
+		return false;
+	}
+
+	SizeClass & sc = kClasses[index];
+	stats.block_size = BlockSizeOf(index);
+	stats.allocs = sc.allocs.load(std::memory_order_relaxed);
+	stats.frees = sc.frees.load(std::memory_order_relaxed);
+	stats.local_hits = sc.local_hits.load(std::memory_order_relaxed);
+	stats.central_hits = sc.central_hits.load(std::memory_order_relaxed);
+	stats.heap_allocs = sc.heap_allocs.load(std::memory_order_relaxed);
+	stats.in_use = stats.allocs - stats.frees;
+	std::lock_guard<std::mutex> lock(sc.mutex);
+	stats.central_cached = sc.count;
+	return true;
+}
+
+void BufferPool::Trim() {
+	if (!kLocalCacheDestroyed) {
+		kLocalCache.Flush();
+	}
+	for (i32 i = 0; i < kClassCount; ++i) {
+		SizeClass & sc = kClasses[i];
+		std::lock_guard<std::mutex> lock(sc.mutex);
+		FreeNode * keep = nullptr;
+		i64 kept = 0;
+		FreeNode * node = sc.head;
+		while (node) {
+			FreeNode * next = node->next;
+			BlockHeader * header = HeaderOf(node);
+			if (header->from_slab) {
+				node->next = keep;
+				keep = node;
+				++kept;
+			} else {
+				jc_free(header);
+			}
+			node = next;
+		}
+		sc.head = keep;
+		sc.count = kept;
+	}
+}
+
+}
\ No newline at end of file
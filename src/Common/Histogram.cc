@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Common/Histogram.h"
+
+namespace Net {
+
+const i32 Histogram::kSubBucketBits;
+const i32 Histogram::kSubBucketCount;
+const i32 Histogram::kMaxExponent;
+const i32 Histogram::kBucketCount;
+
+Histogram::Histogram() {
+	Reset();
+}
+
+Histogram::Histogram(const Histogram & other) {
+	CopyFrom(other);
+}
+
+Histogram & Histogram::operator=(const Histogram & other) {
+	if (this != &other) {
+		CopyFrom(other);
+	}
+	return *this;
+}
+
+void Histogram::CopyFrom(const Histogram & other) {
+	// 先读总数, 与写入并发时各桶之和可能略大于count_
+	count_.store(other.count_.load(std::memory_order_acquire), std::memory_order_relaxed);
+	min_.store(other.min_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	max_.store(other.max_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	sum_.store(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	for (i32 i = 0; i < kBucketCount; ++i) {
+		counts_[i].store(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+void Histogram::Reset() {
+	for (i32 i = 0; i < kBucketCount; ++i) {
+		counts_[i].store(0, std::memory_order_relaxed);
+	}
+	min_.store(~static_cast<u64>(0), std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+	sum_.store(0, std::memory_order_relaxed);
+	count_.store(0, std::memory_order_release);
+}
+
+void Histogram::Merge(const Histogram & other) {
+	if (0 == other.Count()) {
+		return;
+	}
+	for (i32 i = 0; i < kBucketCount; ++i) {
+		counts_[i].store(counts_[i].load(std::memory_order_relaxed) + other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	if (other.Min() < min_.load(std::memory_order_relaxed)) {
+		min_.store(other.Min(), std::memory_order_relaxed);
+	}
+	if (other.Max() > max_.load(std::memory_order_relaxed)) {
+		max_.store(other.Max(), std::memory_order_relaxed);
+	}
+	sum_.store(Sum() + other.Sum(), std::memory_order_relaxed);
+	count_.store(Count() + other.Count(), std::memory_order_release);
+}
+
+double Histogram::Mean() const {
+	i64 count = Count();
+	return count > 0 ? static_cast<double>(Sum()) / count : 0;
+}
+
+u64 Histogram::Percentile(double percentile) const {
+	i64 count = Count();
+	if (count <= 0) {
+		return 0;
+	}
+	if (percentile < 0) {
+		percentile = 0;
+	} else if (percentile > 100) {
+		percentile = 100;
+	}
+	i64 target = static_cast<i64>(count * percentile / 100 + 0.5);
+	if (target < 1) {
+		target = 1;
+	}
+	i64 seen = 0;
+	for (i32 i = 0; i < kBucketCount; ++i) {
+		seen += static_cast<i64>(counts_[i].load(std::memory_order_relaxed));
+		if (seen >= target) {
+			u64 upper = UpperBoundOf(i);
+			return upper < Max() ? upper : Max();
+		}
+	}
+	return Max();
+}
+
+u64 Histogram::LowerBoundOf(i32 index) {
+	if (index < kSubBucketCount) {
+		return static_cast<u64>(index);
+	}
+	i32 exponent = index / kSubBucketCount + kSubBucketBits - 1;
+	u64 sub = static_cast<u64>(index % kSubBucketCount);
+	return (kSubBucketCount + sub) << (exponent - kSubBucketBits);
+}
+
+u64 Histogram::UpperBoundOf(i32 index) {
+	if (index >= kBucketCount - 1) {
+		return ~static_cast<u64>(0);
+	}
+	return LowerBoundOf(index + 1) - 1;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Common/LoopStats.h"
+
+namespace Net {
+
+namespace {
+
+thread_local LoopStats * kCurrent = nullptr;
+
+const i8 * const kCallbackNames[LoopStats::kCallbackCount] = {
+	"read", "write", "accept", "connect", "close",
+};
+
+}
+
+LoopStats::Scope::Scope(LoopStats * stats) : stats_(stats), previous_(kCurrent) {
+	kCurrent = stats;
+	if (stats) {
+		stats->Enter(uv_hrtime());
+	}
+}
+
+LoopStats::Scope::~Scope() {
+	if (stats_) {
+		stats_->Leave(uv_hrtime());
+	}
+	kCurrent = previous_;
+}
+
+LoopStats::LoopStats()
+	: iteration_start_(0), poll_start_(0), poll_ready_(0), poll_blocked_(0), callback_time_(0), poll_callback_time_(0)
+	, events_pending_(0), polling_(false), trace_(nullptr) {
+}
+
+void LoopStats::Enter(u64 now) {
+	iteration_start_ = now;
+	polling_ = false;
+	if (trace_) {
+		trace_->Record(TraceRecorder::kBegin, "iteration", 0, now);
+	}
+}
+
+void LoopStats::Leave(u64 now) {
+	if (trace_) {
+		if (polling_) {
+			trace_->Record(TraceRecorder::kEnd, "poll", 0, now);
+		}
+		trace_->Record(TraceRecorder::kEnd, "iteration", events_pending_, now);
+	}
+}
+
+void LoopStats::BeginPoll(u64 now) {
+	poll_start_ = now;
+	poll_ready_ = 0;
+	poll_callback_time_ = callback_time_;
+	polling_ = true;
+	if (trace_) {
+		trace_->Record(TraceRecorder::kBegin, "poll", 0, now);
+	}
+}
+
+void LoopStats::EndPoll(u64 now) {
+	if (!polling_) {
+		poll_blocked_ = 0;
+		return;
+	}
+	// epoll等待期间执行的I/O回调不算阻塞时间
+	u64 elapsed = now - poll_start_;
+	u64 callbacks = callback_time_ - poll_callback_time_;
+	poll_blocked_ = elapsed > callbacks ? elapsed - callbacks : 0;
+	polling_ = false;
+	if (trace_) {
+		trace_->Record(TraceRecorder::kEnd, "poll", 0, now);
+	}
+}
+
+void LoopStats::EndIteration(u64 now) {
+	if (iteration_start_ > 0 && now > iteration_start_) {
+		u64 elapsed = now - iteration_start_;
+		iteration_.Record(elapsed);
+		blocked_.Record(poll_blocked_);
+		busy_.Record(elapsed > poll_blocked_ ? elapsed - poll_blocked_ : 0);
+		events_.Record(static_cast<u64>(events_pending_));
+	}
+	if (trace_) {
+		// 结束事件的参数为本轮处理的套接字回调数
+		trace_->Record(TraceRecorder::kEnd, "iteration", events_pending_, now);
+		trace_->Record(TraceRecorder::kBegin, "iteration", 0, now);
+	}
+	iteration_start_ = now;
+	poll_blocked_ = 0;
+	events_pending_ = 0;
+}
+
+void LoopStats::GetSnapshot(Snapshot & snapshot) const {
+	snapshot.iteration = iteration_;
+	snapshot.blocked = blocked_;
+	snapshot.busy = busy_;
+	snapshot.events = events_;
+	for (i32 i = 0; i < kCallbackCount; ++i) {
+		snapshot.callbacks[i] = callbacks_[i];
+	}
+	snapshot.write_latency = write_latency_;
+	snapshot.iterations = snapshot.iteration.Count();
+}
+
+LoopStats * LoopStats::Current() {
+	return kCurrent;
+}
+
+const i8 * LoopStats::CallbackName(eCallback type) {
+	return type >= 0 && type < kCallbackCount ? kCallbackNames[type] : "unknown";
+}
+
+}
\ No newline at end of file
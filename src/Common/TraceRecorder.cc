@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Common/TraceRecorder.h"
+#include <cstdio>
+#include <fstream>
+
+namespace Net {
+
+const i32 TraceRecorder::kDefaultCapacity;
+
+TraceRecorder::TraceRecorder(i32 capacity) : slots_(nullptr), mask_(0), head_(0) {
+	u64 size = 16;
+	while (size < static_cast<u64>(capacity)) {
+		size <<= 1;
+	}
+	slots_ = new Slot[size];
+	for (u64 i = 0; i < size; ++i) {
+		slots_[i].seq.store(0, std::memory_order_relaxed);
+	}
+	mask_ = size - 1;
+}
+
+TraceRecorder::~TraceRecorder() {
+	delete[] slots_;
+}
+
+i32 TraceRecorder::GetEvents(std::vector<Event> & events) const {
+	events.clear();
+	u64 head = head_.load(std::memory_order_acquire);
+	u64 begin = head > mask_ + 1 ? head - mask_ - 1 : 0;
+	events.reserve(static_cast<size_t>(head - begin));
+	for (u64 index = begin; index < head; ++index) {
+		const Slot & slot = slots_[index & mask_];
+		if (slot.seq.load(std::memory_order_acquire) != index + 1) {
+			continue;
+		}
+		Event event;
+		event.time = slot.time.load(std::memory_order_relaxed);
+		event.name = slot.name.load(std::memory_order_relaxed);
+		event.arg = slot.arg.load(std::memory_order_relaxed);
+		event.phase = slot.phase.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// 复制期间被写入线程覆盖
+		if (slot.seq.load(std::memory_order_relaxed) != index + 1) {
+			continue;
+		}
+		events.push_back(event);
+	}
+	return static_cast<i32>(events.size());
+}
+
+i32 TraceRecorder::WriteChromeTrace(const std::string & path, i32 pid, i32 tid) const {
+	std::vector<Event> events;
+	GetEvents(events);
+
+	std::ofstream file(path.c_str(), std::ios::out | std::ios::trunc);
+	if (!file) {
+		return UV_EACCES;
+	}
+
+	// 缓冲区开头可能是被截断的span, 跳过没有开始事件的结束事件
+	i32 depth = 0;
+	i32 count = 0;
+	i8 line[256];
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	for (auto & it : events) {
+		if (kEnd == it.phase) {
+			if (0 == depth) {
+				continue;
+			}
+			--depth;
+		} else if (kBegin == it.phase) {
+			++depth;
+		}
+		std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":%d,\"tid\":%d%s,\"args\":{\"arg\":%lld}}",
+			count > 0 ? "," : "", it.name, it.phase, static_cast<unsigned long long>(it.time / 1000), static_cast<u32>(it.time % 1000),
+			pid, tid, kInstant == it.phase ? ",\"s\":\"t\"" : "", static_cast<long long>(it.arg));
+		file << line;
+		++count;
+	}
+	file << "\n]}\n";
+	file.close();
+	if (!file) {
+		return UV_EIO;
+	}
+	return count;
+}
+
+}
\ No newline at end of file
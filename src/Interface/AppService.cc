@@ -295,4 +295,25 @@ SocketAddress AppService::GetConnectionRemoteAddress(i64 mgr_id, i64 connection_
 	return SocketAddress();
 }
 
+bool AppService::GetConnectionTrafficStats(i64 mgr_id, i64 connection_id, SocketConnection::TrafficStats & stats) {
+	ConnectionMgr * mgr = socket_mgr_->GetObj(mgr_id);
+	if (mgr) {
+		Connection * connection = mgr->GetConnection(connection_id);
+		if (connection) {
+			stats = connection->GetTrafficStats();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AppService::GetMgrTrafficStats(i64 mgr_id, SocketConnection::TrafficStats & stats) {
+	ConnectionMgr * mgr = socket_mgr_->GetObj(mgr_id);
+	if (mgr) {
+		stats = mgr->GetTrafficStats();
+		return true;
+	}
+	return false;
+}
+
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ namespace Net {
 ConnectionMgr::ConnectionMgr(const std::string & name)
 	: mgr_id_(-1), name_(name), notification_(nullptr), object_mgr_(new ObjectMgr<Connection>())
 	, need_delete_list_(new std::list<i64>()) {
+	std::memset(&closed_traffic_, 0, sizeof(closed_traffic_));
 }
 
 ConnectionMgr::~ConnectionMgr() {
@@ -69,6 +70,7 @@ void ConnectionMgr::Register(Connection * connection) {
 void ConnectionMgr::UnRegister(Connection * connection) {
 	if (connection->IsRegister2Mgr()) {
 		connection->SetRegister2Mgr(false);
+		closed_traffic_.Add(connection->GetTrafficStats());
 		need_delete_list_->push_back(connection->GetConnectionId());
 	}
 }
@@ -84,6 +86,12 @@ void ConnectionMgr::ShutDownOneConnection(i64 id, bool now) {
 	}
 }
 
+SocketConnection::TrafficStats ConnectionMgr::GetTrafficStats() const {
+	SocketConnection::TrafficStats stats = closed_traffic_;
+	object_mgr_->VisitObj(AddTrafficStats, &stats);
+	return stats;
+}
+
 void ConnectionMgr::DestroyConnection(Connection * connection, void * ud) {
 	delete connection;
 }
@@ -92,4 +100,10 @@ void ConnectionMgr::ShutdownConnection(Connection * connection, void * ud) {
 	connection->Shutdown(false);
 }
 
+void ConnectionMgr::AddTrafficStats(Connection * connection, void * ud) {
+	if (connection->IsRegister2Mgr()) {
+		static_cast<SocketConnection::TrafficStats *>(ud)->Add(connection->GetTrafficStats());
+	}
+}
+
 }
\ No newline at end of file
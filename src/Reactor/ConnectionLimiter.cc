@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Reactor/ConnectionLimiter.h"
+
+namespace Net {
+
+const i32 ConnectionLimiter::kEvictScan;
+
+ConnectionLimiter::ConnectionLimiter(i32 capacity)
+	: capacity_(capacity > 0 ? capacity : 1), rate_(0), burst_(0), max_per_address_(0), evictions_(0)
+	, lru_head_(-1), lru_tail_(-1) {
+	size_t buckets = 1;
+	while (buckets < static_cast<size_t>(capacity_) * 2) {
+		buckets <<= 1;
+	}
+	buckets_.assign(buckets, -1);
+	mask_ = buckets - 1;
+	entries_.reserve(capacity_);
+}
+
+ConnectionLimiter::~ConnectionLimiter() {
+}
+
+void ConnectionLimiter::SetRate(double rate, double burst) {
+	rate_ = rate > 0 ? rate : 0;
+	burst_ = burst >= 1 ? burst : 1;
+}
+
+void ConnectionLimiter::SetMaxPerAddress(i32 max) {
+	max_per_address_ = max > 0 ? max : 0;
+}
+
+ConnectionLimiter::eResult ConnectionLimiter::Acquire(const IPAddress & address, u64 now) {
+	if (rate_ <= 0 && 0 == max_per_address_) {
+		return kAccepted;
+	}
+
+	u64 hash = address.Hash();
+	i32 index = Find(address, hash);
+	if (index < 0) {
+		index = Insert(address, hash, now);
+	} else {
+		Unlink(index);
+		PushFront(index);
+	}
+
+	Entry & entry = entries_[index];
+	if (max_per_address_ > 0 && entry.active >= max_per_address_) {
+		return kTooManyConnections;
+	}
+	if (rate_ > 0) {
+		if (now > entry.updated) {
+			entry.tokens += static_cast<double>(now - entry.updated) * rate_ / 1000;
+			if (entry.tokens > burst_) {
+				entry.tokens = burst_;
+			}
+			entry.updated = now;
+		}
+		if (entry.tokens < 1) {
+			return kRateLimited;
+		}
+		entry.tokens -= 1;
+	}
+	++entry.active;
+	return kAccepted;
+}
+
+void ConnectionLimiter::Release(const IPAddress & address) {
+	i32 index = Find(address, address.Hash());
+	if (index >= 0 && entries_[index].active > 0) {
+		--entries_[index].active;
+	}
+}
+
+i32 ConnectionLimiter::GetActive(const IPAddress & address) const {
+	i32 index = Find(address, address.Hash());
+	return index >= 0 ? entries_[index].active : 0;
+}
+
+i32 ConnectionLimiter::Find(const IPAddress & address, u64 hash) const {
+	i32 index = buckets_[hash & mask_];
+	while (index >= 0 && entries_[index].address != address) {
+		index = entries_[index].next;
+	}
+	return index;
+}
+
+i32 ConnectionLimiter::Insert(const IPAddress & address, u64 hash, u64 now) {
+	i32 index = -1;
+	if (static_cast<i32>(entries_.size()) < capacity_) {
+		index = static_cast<i32>(entries_.size());
+		entries_.push_back(Entry());
+	} else {
+		// 从最久未使用端找一个没有在线连接的条目, 找不到就淘汰最旧的
+		index = lru_tail_;
+		i32 candidate = lru_tail_;
+		for (i32 i = 0; i < kEvictScan && candidate >= 0; ++i) {
+			if (0 == entries_[candidate].active) {
+				index = candidate;
+				break;
+			}
+			candidate = entries_[candidate].lru_prev;
+		}
+		Evict(index);
+	}
+
+	Entry & entry = entries_[index];
+	entry.address = address;
+	entry.tokens = burst_;
+	entry.updated = now;
+	entry.active = 0;
+	i32 & bucket = buckets_[hash & mask_];
+	entry.next = bucket;
+	bucket = index;
+	PushFront(index);
+	return index;
+}
+
+void ConnectionLimiter::Evict(i32 index) {
+	i32 * link = &buckets_[entries_[index].address.Hash() & mask_];
+	while (*link != index) {
+		link = &entries_[*link].next;
+	}
+	*link = entries_[index].next;
+	Unlink(index);
+	++evictions_;
+}
+
+void ConnectionLimiter::Unlink(i32 index) {
+	Entry & entry = entries_[index];
+	if (entry.lru_prev >= 0) {
+		entries_[entry.lru_prev].lru_next = entry.lru_next;
+	} else {
+		lru_head_ = entry.lru_next;
+	}
+	if (entry.lru_next >= 0) {
+		entries_[entry.lru_next].lru_prev = entry.lru_prev;
+	} else {
+		lru_tail_ = entry.lru_prev;
+	}
+}
+
+void ConnectionLimiter::PushFront(i32 index) {
+	Entry & entry = entries_[index];
+	entry.lru_prev = -1;
+	entry.lru_next = lru_head_;
+	if (lru_head_ >= 0) {
+		entries_[lru_head_].lru_prev = index;
+	} else {
+		lru_tail_ = index;
+	}
+	lru_head_ = index;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,228 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Reactor/ConnectionPool.h"
+#include "Reactor/EventReactor.h"
+#include "Reactor/SocketConnection.h"
+#include "Common/BufferPool.h"
+#include "Category.h"
+
+namespace Net {
+
+ConnectionPool::ConnectionPool(EventReactor * reactor, const SocketAddress & address)
+	: SocketConnector(reactor), address_(address), min_idle_(1), max_total_(8), health_interval_(1000)
+	, backoff_min_(100), backoff_max_(30000), failures_(0), next_connect_(0), leased_(0), started_(false)
+	, timer_(nullptr), retry_timer_(nullptr), random_(static_cast<u32>(uv_hrtime())) {
+}
+
+ConnectionPool::~ConnectionPool() {
+	Stop();
+	if (timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(timer_), timer_close_cb);
+		timer_ = nullptr;
+	}
+	if (retry_timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(retry_timer_), timer_close_cb);
+		retry_timer_ = nullptr;
+	}
+}
+
+void ConnectionPool::SetLimits(i32 min_idle, i32 max_total) {
+	max_total_ = max_total > 0 ? max_total : 1;
+	min_idle_ = min_idle < 0 ? 0 : (min_idle > max_total_ ? max_total_ : min_idle);
+	SetConcurrency(max_total_, 0);
+}
+
+void ConnectionPool::SetHealthInterval(i32 msec) {
+	health_interval_ = msec > 0 ? msec : 1000;
+}
+
+void ConnectionPool::SetBackoff(i32 min_msec, i32 max_msec) {
+	backoff_min_ = min_msec > 0 ? min_msec : 1;
+	backoff_max_ = max_msec > backoff_min_ ? max_msec : backoff_min_;
+}
+
+bool ConnectionPool::Start() {
+	if (started_) {
+		return false;
+	}
+	if (!timer_) {
+		timer_ = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+		uv_timer_init(GetReactor()->GetUvLoop(), timer_);
+		timer_->data = this;
+		retry_timer_ = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+		uv_timer_init(GetReactor()->GetUvLoop(), retry_timer_);
+		retry_timer_->data = this;
+	}
+	SetConcurrency(max_total_, 0);
+	started_ = true;
+	failures_ = 0;
+	next_connect_ = 0;
+	uv_timer_start(timer_, health_cb, health_interval_, health_interval_);
+	Refill();
+	return true;
+}
+
+void ConnectionPool::Stop() {
+	if (!started_) {
+		return;
+	}
+	started_ = false;
+	if (timer_) {
+		uv_timer_stop(timer_);
+		uv_timer_stop(retry_timer_);
+	}
+	SocketConnector::Close();
+	std::list<SocketConnection *> idle;
+	idle.swap(idle_);
+	for (auto & it : idle) {
+		Discard(it);
+	}
+}
+
+SocketConnection * ConnectionPool::Lease() {
+	while (!idle_.empty()) {
+		// 后进先出, 取最近使用过的连接
+		SocketConnection * connection = idle_.back();
+		idle_.pop_back();
+		if (ConnectState::kConnected == connection->GetConnectState()) {
+			++leased_;
+			Refill();
+			return connection;
+		}
+		connection->Release();
+	}
+	Refill();
+	return nullptr;
+}
+
+void ConnectionPool::Return(SocketConnection * connection) {
+	if (!connection) {
+		return;
+	}
+	if (leased_ > 0) {
+		--leased_;
+	}
+	if (started_ && ConnectState::kConnected == connection->GetConnectState() && static_cast<i32>(idle_.size()) + leased_ < max_total_) {
+		idle_.push_back(connection);
+	} else {
+		Discard(connection);
+		Refill();
+	}
+}
+
+bool ConnectionPool::CheckHealth(SocketConnection * connection) {
+	return ConnectState::kConnected == connection->GetConnectState();
+}
+
+SocketConnection * ConnectionPool::CreateConnection() {
+	if (!started_) {
+		return nullptr;
+	}
+	SocketConnection * connection = NewConnection();
+	if (connection) {
+		failures_ = 0;
+		next_connect_ = 0;
+		idle_.push_back(connection);
+	}
+	return connection;
+}
+
+void ConnectionPool::DestroyConnection(SocketConnection * connection) {
+	idle_.remove(connection);
+	connection->Release();
+}
+
+void ConnectionPool::OnConnectFailed() {
+	if (!started_) {
+		return;
+	}
+	// 指数退避, 在[backoff / 2, backoff]之间随机, 避免多个池同时重连
+	++failures_;
+	i32 backoff = backoff_min_;
+	for (i32 i = 1; i < failures_ && backoff < backoff_max_; ++i) {
+		backoff = backoff > backoff_max_ / 2 ? backoff_max_ : backoff * 2;
+	}
+	i32 delay = backoff / 2 + static_cast<i32>(random_() % static_cast<u32>(backoff / 2 + 1));
+	next_connect_ = uv_now(GetReactor()->GetUvLoop()) + delay;
+	uv_timer_start(retry_timer_, retry_cb, delay, 0);
+	logger_->Warn("OnConnectFailed - %s:retry in %dms, failures %d", *address_.ToString(), delay, failures_);
+}
+
+void ConnectionPool::Refill() {
+	if (!started_ || (next_connect_ > 0 && uv_now(GetReactor()->GetUvLoop()) < next_connect_)) {
+		return;
+	}
+	i32 idle = static_cast<i32>(idle_.size()) + GetConnectingCount();
+	i32 total = idle + leased_;
+	while (idle < min_idle_ && total < max_total_) {
+		if (!Connect(address_)) {
+			OnConnectFailed();
+			break;
+		}
+		++idle;
+		++total;
+	}
+}
+
+void ConnectionPool::Discard(SocketConnection * connection) {
+	if (ConnectState::kConnected == connection->GetConnectState()) {
+		connection->Shutdown(true);
+	}
+	connection->Release();
+}
+
+void ConnectionPool::EvictIdle() {
+	for (auto it = idle_.begin(); it != idle_.end();) {
+		SocketConnection * connection = *it;
+		if (ConnectState::kConnected == connection->GetConnectState() && CheckHealth(connection)) {
+			++it;
+		} else {
+			it = idle_.erase(it);
+			Discard(connection);
+		}
+	}
+}
+
+//*********************************************************************
+//Callback
+//*********************************************************************
+
+void ConnectionPool::health_cb(uv_timer_t * handle) {
+	ConnectionPool * pool = static_cast<ConnectionPool *>(handle->data);
+	pool->EvictIdle();
+	pool->Refill();
+}
+
+void ConnectionPool::retry_cb(uv_timer_t * handle) {
+	ConnectionPool * pool = static_cast<ConnectionPool *>(handle->data);
+	pool->Refill();
+}
+
+void ConnectionPool::timer_close_cb(uv_handle_t * handle) {
+	BufferPool::DeAllocate(handle);
+}
+
+}
\ No newline at end of file
@@ -33,4 +33,7 @@ EventHandler::EventHandler(EventReactor * reactor, Logger::Category * logger) :
 EventHandler::~EventHandler() {
 }
 
+void EventHandler::Flush() {
+}
+
 }
\ No newline at end of file
@@ -23,22 +23,107 @@
  */
 
 #include "Reactor/EventReactor.h"
+#include "Reactor/Resolver.h"
+#include "Reactor/SocketConnection.h"
+#include "Common/Probes.h"
+#include <algorithm>
+#include <thread>
+#ifndef _WIN32
+#include <poll.h>
+#include <pthread.h>
+#endif
 
 namespace Net {
 
-EventReactor::EventReactor() : loop_(static_cast<uv_loop_t *>(jc_malloc(sizeof(uv_loop_t)))) {
+const u64 EventReactor::kReapInterval;
+
+namespace {
+
+const i32 kPauseCount = 16;
+
+std::atomic<i32> kTraceId(0);
+
+#ifdef NET_WRITE_BATCHING
+const bool kWriteBatching = true;
+#else
+const bool kWriteBatching = false;
+#endif
+
+inline void CpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#elif defined(_WIN32)
+	YieldProcessor();
+#endif
+}
+
+}
+
+EventReactor::EventReactor()
+	: loop_(static_cast<uv_loop_t *>(jc_malloc(sizeof(uv_loop_t))))
+	, async_(static_cast<uv_async_t *>(jc_malloc(sizeof(uv_async_t))))
+	, check_(static_cast<uv_check_t *>(jc_malloc(sizeof(uv_check_t))))
+	, prepare_(static_cast<uv_prepare_t *>(jc_malloc(sizeof(uv_prepare_t)))), stop_(false)
+	, busy_poll_(false), spin_budget_(50), write_batching_(kWriteBatching), resolver_(nullptr), loop_stats_(true)
+	, write_sampling_(0), write_sample_count_(0), sample_timer_(nullptr), sample_interval_(0), sample_slice_(64), sample_cursor_(0)
+	, bytes_in_(0), bytes_out_(0), closed_connections_(0), reap_timer_(nullptr)
+	, trace_(nullptr), trace_id_(0), trace_dumps_(0), trace_signal_(nullptr) {
+	std::memset(&busy_poll_stats_, 0, sizeof(busy_poll_stats_));
 	Logger::Category::GetCategory("EventReactor")->Info("<libuv> %s", uv_version_string());
 	uv_loop_init(loop_);
 	loop_->data = this;
+	uv_async_init(loop_, async_, async_cb);
+	async_->data = this;
+	uv_unref(reinterpret_cast<uv_handle_t *>(async_));
+	uv_check_init(loop_, check_);
+	check_->data = this;
+	uv_check_start(check_, check_cb);
+	uv_unref(reinterpret_cast<uv_handle_t *>(check_));
+	uv_prepare_init(loop_, prepare_);
+	prepare_->data = this;
+	uv_prepare_start(prepare_, prepare_cb);
+	uv_unref(reinterpret_cast<uv_handle_t *>(prepare_));
 }
 
 EventReactor::~EventReactor() {
 	ClearEventHandlers();
+	FlushScheduled();
+	ReleaseDeferred();
+	// 取消进行中的解析请求, 回调在下面的循环中完成
+	delete resolver_;
+	resolver_ = nullptr;
+	uv_close(reinterpret_cast<uv_handle_t *>(async_), close_cb);
+	uv_close(reinterpret_cast<uv_handle_t *>(check_), close_cb);
+	uv_close(reinterpret_cast<uv_handle_t *>(prepare_), close_cb);
+	if (sample_timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(sample_timer_), close_cb);
+		sample_timer_ = nullptr;
+	}
+	if (trace_signal_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(trace_signal_), close_cb);
+		trace_signal_ = nullptr;
+	}
+	if (reap_timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(reap_timer_), close_cb);
+		reap_timer_ = nullptr;
+	}
+	// 事件循环即将结束, 不再等待完成通知
+	for (auto & it : parked_) {
+		it.socket.Close();
+	}
 	while (Poll()) {
 		Poll(UV_RUN_ONCE);
 	}
+	for (auto & it : parked_) {
+		delete it.buffer;
+	}
+	parked_.clear();
 	uv_loop_close(loop_);
 	jc_free(loop_);
+	stats_.SetTrace(nullptr);
+	delete trace_;
 }
 
 bool EventReactor::AddEventHandler(EventHandler * handler) {
@@ -67,4 +152,371 @@ void EventReactor::ClearEventHandlers() {
 	}
 }
 
+void EventReactor::Run() {
+	LoopStats::Scope scope(loop_stats_ ? &stats_ : nullptr);
+	uv_ref(reinterpret_cast<uv_handle_t *>(async_));
+	while (!stop_.exchange(false)) {
+		if (busy_poll_) {
+			RunBusyPoll();
+		} else {
+			uv_run(loop_, UV_RUN_DEFAULT);
+		}
+	}
+	uv_unref(reinterpret_cast<uv_handle_t *>(async_));
+}
+
+void EventReactor::Stop() {
+	stop_ = true;
+	uv_async_send(async_);
+}
+
+void EventReactor::DeferRelease(EventHandler * handler) {
+	deferred_.push_back(handler);
+}
+
+void EventReactor::SetBusyPoll(bool enable, i32 spin_budget) {
+	busy_poll_ = enable;
+	spin_budget_ = spin_budget > 0 ? spin_budget : 0;
+}
+
+bool EventReactor::SetCpuAffinity(i32 cpu) {
+	if (cpu < 0) {
+		return false;
+	}
+#if defined(_WIN32)
+	if (cpu >= static_cast<i32>(sizeof(DWORD_PTR) * 8) || 0 == SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu)) {
+		Logger::Category::GetCategory("EventReactor")->Error("SetThreadAffinityMask() - cpu %d error(%lu)", cpu, GetLastError());
+		return false;
+	}
+	return true;
+#elif defined(__linux__)
+	if (cpu >= CPU_SETSIZE) {
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	i32 err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (0 != err) {
+		Logger::Category::GetCategory("EventReactor")->Error("pthread_setaffinity_np() - cpu %d %s(%d)", cpu, std::strerror(err), err);
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void EventReactor::RunBusyPoll() {
+	const u64 budget = static_cast<u64>(spin_budget_) * 1000;
+	u64 last = uv_hrtime();
+	u64 idle_start = last;
+	while (!stop_) {
+		bool ready = HasPendingEvents();
+		uv_run(loop_, UV_RUN_NOWAIT);
+		u64 now = uv_hrtime();
+		busy_poll_stats_.spin_time += now - last;
+		last = now;
+		if (ready) {
+			++busy_poll_stats_.spin_wakeups;
+			idle_start = now;
+			continue;
+		}
+
+		// 退避: 自旋 -> pause -> yield -> 阻塞
+		u64 idle = now - idle_start;
+		if (idle < budget / 4) {
+			continue;
+		} else if (idle < budget * 3 / 4) {
+			for (i32 i = 0; i < kPauseCount; ++i) {
+				CpuRelax();
+			}
+		} else if (idle < budget) {
+			std::this_thread::yield();
+		} else if (!stop_) {
+			uv_run(loop_, UV_RUN_ONCE);
+			now = uv_hrtime();
+			busy_poll_stats_.blocked_time += now - last;
+			++busy_poll_stats_.blocked_wakeups;
+			last = now;
+			idle_start = now;
+		}
+	}
+}
+
+bool EventReactor::HasPendingEvents() const {
+	// 有待处理的定时器, idle或关闭中的句柄
+	if (0 == uv_backend_timeout(loop_)) {
+		return true;
+	}
+#ifndef _WIN32
+	// epoll/kqueue句柄可读表示有就绪事件, Windows下无法探测, 只按时间退避
+	struct pollfd pfd;
+	pfd.fd = uv_backend_fd(loop_);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (pfd.fd >= 0 && poll(&pfd, 1, 0) > 0) {
+		return true;
+	}
+#endif
+	return false;
+}
+
+void EventReactor::ScheduleFlush(EventHandler * handler) {
+	handler->Duplicate();
+	flushes_.push_back(handler);
+}
+
+void EventReactor::SetTcpInfoSampling(i32 interval, i32 slice) {
+	sample_interval_ = interval > 0 ? interval : 0;
+	sample_slice_ = slice > 0 ? slice : 1;
+	if (0 == sample_interval_) {
+		if (sample_timer_) {
+			uv_timer_stop(sample_timer_);
+		}
+		return;
+	}
+	if (!sample_timer_) {
+		sample_timer_ = static_cast<uv_timer_t *>(jc_malloc(sizeof(uv_timer_t)));
+		uv_timer_init(loop_, sample_timer_);
+		sample_timer_->data = this;
+		uv_unref(reinterpret_cast<uv_handle_t *>(sample_timer_));
+	}
+	uv_timer_start(sample_timer_, sample_cb, sample_interval_, sample_interval_);
+}
+
+void EventReactor::SetTrace(i32 capacity) {
+	stats_.SetTrace(nullptr);
+	delete trace_;
+	trace_ = nullptr;
+	if (capacity > 0) {
+		trace_ = new TraceRecorder(capacity);
+		if (0 == trace_id_) {
+			trace_id_ = ++kTraceId;
+		}
+		stats_.SetTrace(trace_);
+	}
+}
+
+i32 EventReactor::DumpTrace(const std::string & path) const {
+	if (!trace_) {
+		return UV_EINVAL;
+	}
+	return trace_->WriteChromeTrace(path, uv_os_getpid(), trace_id_);
+}
+
+void EventReactor::SetTraceSignal(i32 signum, const std::string & directory) {
+	trace_directory_ = directory;
+	if (signum <= 0) {
+		if (trace_signal_) {
+			uv_signal_stop(trace_signal_);
+		}
+		return;
+	}
+	if (!trace_signal_) {
+		trace_signal_ = static_cast<uv_signal_t *>(jc_malloc(sizeof(uv_signal_t)));
+		uv_signal_init(loop_, trace_signal_);
+		trace_signal_->data = this;
+	}
+	i32 status = uv_signal_start(trace_signal_, signal_cb, signum);
+	if (status < 0) {
+		Logger::Category::GetCategory("EventReactor")->Error("uv_signal_start() - %s(%d)", uv_strerror(status), status);
+		return;
+	}
+	uv_unref(reinterpret_cast<uv_handle_t *>(trace_signal_));
+}
+
+void EventReactor::AddConnection(SocketConnection * connection) {
+	connection->connection_index_ = static_cast<i32>(connections_.size());
+	connections_.push_back(connection);
+}
+
+void EventReactor::RemoveConnection(SocketConnection * connection) {
+	i32 index = connection->connection_index_;
+	if (index < 0) {
+		return;
+	}
+	++closed_connections_;
+	SocketConnection * last = connections_.back();
+	connections_[index] = last;
+	last->connection_index_ = index;
+	connections_.pop_back();
+	connection->connection_index_ = -1;
+}
+
+void EventReactor::SampleTcpInfo() {
+	// 每次只抽样一段, 连接很多时把getsockopt的开销分摊到多个周期
+	size_t count = std::min(connections_.size(), static_cast<size_t>(sample_slice_));
+	for (size_t i = 0; i < count; ++i) {
+		if (sample_cursor_ >= connections_.size()) {
+			sample_cursor_ = 0;
+		}
+		connections_[sample_cursor_++]->SampleTcpInfo();
+	}
+}
+
+void EventReactor::WatchZeroCopy(SocketConnection * connection) {
+	if (std::find(zerocopy_waiting_.begin(), zerocopy_waiting_.end(), connection) != zerocopy_waiting_.end()) {
+		return;
+	}
+	zerocopy_waiting_.push_back(connection);
+	StartReapTimer();
+}
+
+void EventReactor::UnwatchZeroCopy(SocketConnection * connection) {
+	auto it = std::find(zerocopy_waiting_.begin(), zerocopy_waiting_.end(), connection);
+	if (it != zerocopy_waiting_.end()) {
+		zerocopy_waiting_.erase(it);
+	}
+}
+
+void EventReactor::ParkZeroCopy(const StreamSocket & socket, Common::BipBuffer * buffer, i32 outstanding) {
+	ParkedZeroCopy parked;
+	parked.socket = socket;
+	parked.buffer = buffer;
+	parked.outstanding = outstanding;
+	// 已提交的数据照常发完, 对端看到的仍是关闭
+	parked.socket.SetUvData(nullptr);
+	parked.socket.ShutdownRead();
+	parked.socket.ShutdownWrite();
+	parked_.push_back(parked);
+	StartReapTimer();
+}
+
+void EventReactor::StartReapTimer() {
+	if (!reap_timer_) {
+		reap_timer_ = static_cast<uv_timer_t *>(jc_malloc(sizeof(uv_timer_t)));
+		uv_timer_init(loop_, reap_timer_);
+		reap_timer_->data = this;
+		uv_unref(reinterpret_cast<uv_handle_t *>(reap_timer_));
+	}
+	if (!uv_is_active(reinterpret_cast<uv_handle_t *>(reap_timer_))) {
+		uv_timer_start(reap_timer_, reap_cb, kReapInterval, kReapInterval);
+	}
+}
+
+void EventReactor::ReapZeroCopy() {
+	// 回收时可能回调OnSomeDataSent, 应用层会关闭连接
+	std::vector<SocketConnection *> waiting(zerocopy_waiting_);
+	for (auto & it : waiting) {
+		it->Duplicate();
+	}
+	for (auto & it : waiting) {
+		it->ReapZeroCopy();
+		it->Release();
+	}
+	for (size_t i = 0; i < parked_.size();) {
+		ParkedZeroCopy & parked = parked_[i];
+		parked.outstanding -= parked.socket.ReapZeroCopy();
+		if (parked.outstanding > 0) {
+			++i;
+			continue;
+		}
+		parked.socket.Close();
+		delete parked.buffer;
+		parked_[i] = parked_.back();
+		parked_.pop_back();
+	}
+	if (zerocopy_waiting_.empty() && parked_.empty()) {
+		uv_timer_stop(reap_timer_);
+	}
+}
+
+Resolver * EventReactor::GetResolver() {
+	if (!resolver_) {
+		resolver_ = new Resolver(this);
+	}
+	return resolver_;
+}
+
+void EventReactor::FlushScheduled() {
+	while (!flushes_.empty()) {
+		std::vector<EventHandler *> handlers;
+		handlers.swap(flushes_);
+		for (auto & it : handlers) {
+			it->Flush();
+			it->Release();
+		}
+	}
+}
+
+void EventReactor::ReleaseDeferred() {
+	while (!deferred_.empty()) {
+		std::vector<EventHandler *> handlers;
+		handlers.swap(deferred_);
+		for (auto & it : handlers) {
+			it->Release();
+		}
+	}
+}
+
+//*********************************************************************
+//Callback
+//*********************************************************************
+
+void EventReactor::async_cb(uv_async_t * handle) {
+	EventReactor * reactor = static_cast<EventReactor *>(handle->data);
+	if (reactor->stop_) {
+		uv_stop(reactor->loop_);
+	}
+}
+
+void EventReactor::prepare_cb(uv_prepare_t * handle) {
+	EventReactor * reactor = static_cast<EventReactor *>(handle->data);
+	NET_PROBE1(poll__begin, reactor);
+	if (reactor->loop_stats_) {
+		reactor->stats_.BeginPoll(uv_hrtime());
+	}
+}
+
+void EventReactor::check_cb(uv_check_t * handle) {
+	EventReactor * reactor = static_cast<EventReactor *>(handle->data);
+	NET_PROBE1(poll__end, reactor);
+	if (reactor->loop_stats_) {
+		reactor->stats_.EndPoll(uv_hrtime());
+	}
+	if (reactor->trace_ && !reactor->flushes_.empty()) {
+		reactor->trace_->Begin("flush", static_cast<i64>(reactor->flushes_.size()));
+		reactor->FlushScheduled();
+		reactor->trace_->End("flush");
+	} else {
+		reactor->FlushScheduled();
+	}
+	reactor->ReleaseDeferred();
+	if (reactor->loop_stats_) {
+		reactor->stats_.EndIteration(uv_hrtime());
+	}
+	NET_PROBE1(iteration__end, reactor);
+}
+
+void EventReactor::sample_cb(uv_timer_t * handle) {
+	EventReactor * reactor = static_cast<EventReactor *>(handle->data);
+	reactor->SampleTcpInfo();
+}
+
+void EventReactor::reap_cb(uv_timer_t * handle) {
+	EventReactor * reactor = static_cast<EventReactor *>(handle->data);
+	reactor->ReapZeroCopy();
+}
+
+void EventReactor::signal_cb(uv_signal_t * handle, int signum) {
+	EventReactor * reactor = static_cast<EventReactor *>(handle->data);
+	if (!reactor->trace_) {
+		return;
+	}
+	i8 name[64];
+	std::snprintf(name, sizeof(name), "/trace-%d-%d-%d.json", uv_os_getpid(), reactor->trace_id_, ++reactor->trace_dumps_);
+	std::string path = reactor->trace_directory_ + name;
+	i32 status = reactor->DumpTrace(path);
+	if (status < 0) {
+		Logger::Category::GetCategory("EventReactor")->Error("signal_cb() - dump %s %s(%d)", path.c_str(), uv_strerror(status), status);
+	} else {
+		Logger::Category::GetCategory("EventReactor")->Info("signal_cb() - dump %d events to %s", status, path.c_str());
+	}
+}
+
+void EventReactor::close_cb(uv_handle_t * handle) {
+	jc_free(handle);
+}
+
 }
\ No newline at end of file
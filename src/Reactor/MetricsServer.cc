@@ -0,0 +1,529 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Reactor/MetricsServer.h"
+#include "Reactor/EventReactor.h"
+#include "Reactor/SocketConnection.h"
+#include "Reactor/ConnectionPool.h"
+#include "Common/BufferPool.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace Net {
+
+const i32 MetricsServer::kDefaultSlice;
+const i32 MetricsServer::kDefaultRequestTimeout;
+
+namespace {
+
+const i32 kMaxOutBufferSize = 64 * 1024;
+const i32 kMaxInBufferSize = 4096;
+// 单次Write()的最大长度, 保证发送缓冲区有空间时总能写入
+const size_t kWriteChunk = 4096;
+
+const i8 kResponseOK[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nConnection: close\r\n\r\n";
+const i8 kResponseNotFound[] = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nnot found\n";
+const i8 kResponseBadMethod[] = "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const i8 kResponseTooLarge[] = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+std::string Escape(const std::string & value) {
+	std::string escaped;
+	escaped.reserve(value.size());
+	for (auto & it : value) {
+		if ('\\' == it || '"' == it) {
+			escaped += '\\';
+			escaped += it;
+		} else if ('\n' == it) {
+			escaped += "\\n";
+		} else {
+			escaped += it;
+		}
+	}
+	return escaped;
+}
+
+void AppendHelp(std::string & out, const i8 * name, const i8 * type, const i8 * help) {
+	out += "# HELP ";
+	out += name;
+	out += ' ';
+	out += help;
+	out += "\n# TYPE ";
+	out += name;
+	out += ' ';
+	out += type;
+	out += '\n';
+}
+
+// 标签长度不限, 只格式化数值部分, 避免整行截断后丢掉换行
+void AppendValue(std::string & out, const i8 * name, const std::string & labels, i64 value) {
+	i8 number[32];
+	std::snprintf(number, sizeof(number), " %lld\n", static_cast<long long>(value));
+	out += name;
+	out += labels;
+	out += number;
+}
+
+void AppendSeconds(std::string & out, const i8 * name, const i8 * labels, u64 nanoseconds) {
+	i8 number[64];
+	std::snprintf(number, sizeof(number), " %.9f\n", static_cast<double>(nanoseconds) / 1e9);
+	out += name;
+	out += labels;
+	out += number;
+}
+
+// 纳秒直方图输出为秒为单位的summary
+void AppendSummary(std::string & out, const i8 * name, const i8 * help, const Histogram & histogram) {
+	std::string sum = std::string(name) + "_sum";
+	std::string count = std::string(name) + "_count";
+	AppendHelp(out, name, "summary", help);
+	AppendSeconds(out, name, "{quantile=\"0.5\"}", histogram.Percentile(50));
+	AppendSeconds(out, name, "{quantile=\"0.99\"}", histogram.Percentile(99));
+	AppendSeconds(out, name, "{quantile=\"1\"}", histogram.Max());
+	AppendSeconds(out, sum.c_str(), "", histogram.Sum());
+	AppendValue(out, count.c_str(), "", histogram.Count());
+}
+
+}
+
+// 每个连接只处理一个请求, 响应写完后关闭
+class MetricsConnection : public SocketConnection {
+public:
+	explicit MetricsConnection(MetricsServer * server)
+		: SocketConnection(kMaxOutBufferSize, kMaxInBufferSize), server_(server), offset_(0), responding_(false), scheduled_(false)
+		, requested_(false), accepted_time_(uv_now(server->GetReactor()->GetUvLoop())) {
+		std::memset(&state_, 0, sizeof(state_));
+	}
+
+	void Detach() {
+		server_ = nullptr;
+	}
+
+	// 还没有收到完整请求
+	bool IsWaiting() const {
+		return !requested_;
+	}
+
+	u64 GetAcceptedTime() const {
+		return accepted_time_;
+	}
+
+	// 生成一步并写出
+	void Step() {
+		scheduled_ = false;
+		if (server_ && responding_) {
+			server_->Render(state_, pending_);
+			Continue();
+		}
+	}
+
+protected:
+	virtual void OnDisconnected(bool is_remote) override {
+		if (server_) {
+			server_->Closed(this);
+		}
+	}
+
+	virtual void OnNewDataReceived() override {
+		if (responding_) {
+			PopRecvData(GetRecvDataSize());
+			return;
+		}
+		std::string request(GetRecvData(), GetRecvDataSize());
+		std::string::size_type end = request.find("\r\n\r\n");
+		if (std::string::npos == end) {
+			if (GetRecvDataSize() >= kMaxInBufferSize) {
+				Respond(kResponseTooLarge);
+			}
+			return;
+		}
+		PopRecvData(GetRecvDataSize());
+		std::string::size_type method_end = request.find(' ');
+		std::string::size_type path_end = std::string::npos == method_end ? std::string::npos : request.find_first_of(" ?\r", method_end + 1);
+		if (std::string::npos == path_end || "GET" != request.substr(0, method_end)) {
+			Respond(kResponseBadMethod);
+			return;
+		}
+		std::string path = request.substr(method_end + 1, path_end - method_end - 1);
+		if (!server_ || ("/metrics" != path && "/" != path)) {
+			Respond(kResponseNotFound);
+			return;
+		}
+		++server_->scrapes_;
+		state_.stage = MetricsServer::kLoop;
+		requested_ = true;
+		responding_ = true;
+		pending_ = kResponseOK;
+		Continue();
+	}
+
+	virtual void OnSomeDataSent() override {
+		if (responding_ && !scheduled_) {
+			Continue();
+		}
+	}
+
+private:
+	void Respond(const i8 * response) {
+		state_.stage = MetricsServer::kDone;
+		requested_ = true;
+		responding_ = true;
+		pending_ = response;
+		Continue();
+	}
+
+	void Continue() {
+		while (offset_ < pending_.size()) {
+			i32 len = static_cast<i32>(std::min(kWriteChunk, pending_.size() - offset_));
+			if (Write(pending_.data() + offset_, len) != len) {
+				// 发送缓冲区满, 等OnSomeDataSent()
+				return;
+			}
+			offset_ += len;
+		}
+		pending_.clear();
+		offset_ = 0;
+		if (MetricsServer::kDone == state_.stage || !server_) {
+			responding_ = false;
+			Shutdown(false);
+		} else if (!scheduled_) {
+			scheduled_ = true;
+			server_->Schedule(this);
+		}
+	}
+
+private:
+	MetricsServer * server_;
+	MetricsServer::RenderState state_;
+	std::string pending_;
+	size_t offset_;
+	bool responding_;
+	bool scheduled_;
+	bool requested_;
+	u64 accepted_time_;
+};
+
+MetricsServer::MetricsServer(EventReactor * reactor) : SocketAcceptor(reactor), slice_(kDefaultSlice), request_timeout_(kDefaultRequestTimeout)
+	, scrapes_(0), timeouts_(0), idle_(nullptr), timeout_timer_(nullptr) {
+}
+
+MetricsServer::~MetricsServer() {
+	rendering_.clear();
+	if (idle_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(idle_), idle_close_cb);
+		idle_ = nullptr;
+	}
+	if (timeout_timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(timeout_timer_), timeout_close_cb);
+		timeout_timer_ = nullptr;
+	}
+	for (auto & it : connections_) {
+		it->Detach();
+		it->Shutdown(true);
+		it->Release();
+	}
+	connections_.clear();
+	for (auto & it : acceptors_) {
+		it.first->Release();
+	}
+	for (auto & it : pools_) {
+		it.first->Release();
+	}
+}
+
+bool MetricsServer::AddAcceptor(SocketAcceptor * acceptor, const std::string & label) {
+	for (auto & it : acceptors_) {
+		if (it.first == acceptor) {
+			return false;
+		}
+	}
+	acceptor->Duplicate();
+	acceptors_.push_back(std::make_pair(acceptor, Escape(label)));
+	return true;
+}
+
+void MetricsServer::RemoveAcceptor(SocketAcceptor * acceptor) {
+	for (auto it = acceptors_.begin(); it != acceptors_.end(); ++it) {
+		if (it->first == acceptor) {
+			acceptors_.erase(it);
+			acceptor->Release();
+			return;
+		}
+	}
+}
+
+bool MetricsServer::AddPool(ConnectionPool * pool, const std::string & label) {
+	for (auto & it : pools_) {
+		if (it.first == pool) {
+			return false;
+		}
+	}
+	pool->Duplicate();
+	pools_.push_back(std::make_pair(pool, Escape(label)));
+	return true;
+}
+
+void MetricsServer::RemovePool(ConnectionPool * pool) {
+	for (auto it = pools_.begin(); it != pools_.end(); ++it) {
+		if (it->first == pool) {
+			pools_.erase(it);
+			pool->Release();
+			return;
+		}
+	}
+}
+
+void MetricsServer::SetRequestTimeout(i32 msec) {
+	request_timeout_ = msec > 0 ? msec : kDefaultRequestTimeout;
+	// 按新的超时时间重新计算检查间隔
+	if (timeout_timer_ && uv_is_active(reinterpret_cast<uv_handle_t *>(timeout_timer_))) {
+		uv_timer_stop(timeout_timer_);
+		StartTimeout();
+	}
+}
+
+SocketConnection * MetricsServer::CreateConnection() {
+	MetricsConnection * connection = new MetricsConnection(this);
+	connections_.push_back(connection);
+	StartTimeout();
+	return connection;
+}
+
+void MetricsServer::DestroyConnection(SocketConnection * connection) {
+	connections_.remove(static_cast<MetricsConnection *>(connection));
+	connection->Release();
+}
+
+void MetricsServer::Schedule(MetricsConnection * connection) {
+	if (!idle_) {
+		idle_ = static_cast<uv_idle_t *>(BufferPool::Allocate(sizeof(uv_idle_t)));
+		uv_idle_init(GetReactor()->GetUvLoop(), idle_);
+		idle_->data = this;
+	}
+	if (rendering_.empty()) {
+		uv_idle_start(idle_, idle_cb);
+	}
+	rendering_.push_back(connection);
+}
+
+void MetricsServer::StartTimeout() {
+	if (!timeout_timer_) {
+		timeout_timer_ = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+		uv_timer_init(GetReactor()->GetUvLoop(), timeout_timer_);
+		timeout_timer_->data = this;
+	}
+	if (!uv_is_active(reinterpret_cast<uv_handle_t *>(timeout_timer_))) {
+		// 每半个超时时间检查一次, 连接最迟在1.5倍超时时间后关闭
+		u64 interval = static_cast<u64>(request_timeout_ + 1) / 2;
+		uv_timer_start(timeout_timer_, timeout_cb, interval, interval);
+	}
+}
+
+void MetricsServer::CheckTimeout() {
+	u64 now = uv_now(GetReactor()->GetUvLoop());
+	u64 deadline = now > static_cast<u64>(request_timeout_) ? now - request_timeout_ : 0;
+	std::vector<MetricsConnection *> expired;
+	bool waiting = false;
+	for (auto & it : connections_) {
+		if (!it->IsWaiting()) {
+			continue;
+		}
+		if (it->GetAcceptedTime() <= deadline) {
+			expired.push_back(it);
+		} else {
+			waiting = true;
+		}
+	}
+	// 关闭时会回调Closed()修改连接列表
+	for (auto & it : expired) {
+		++timeouts_;
+		it->Shutdown(true);
+	}
+	if (!waiting) {
+		uv_timer_stop(timeout_timer_);
+	}
+}
+
+void MetricsServer::Closed(MetricsConnection * connection) {
+	// 在连接自己的回调中, 延迟到check阶段释放
+	connection->Detach();
+	connections_.remove(connection);
+	rendering_.erase(std::remove(rendering_.begin(), rendering_.end(), connection), rendering_.end());
+	GetReactor()->DeferRelease(connection);
+}
+
+void MetricsServer::Render(RenderState & state, std::string & out) {
+	switch (state.stage) {
+	case kLoop: {
+		LoopStats::Snapshot loop = GetReactor()->GetStats();
+		AppendHelp(out, "net_loop_iterations_total", "counter", "Event loop iterations.");
+		AppendValue(out, "net_loop_iterations_total", "", loop.iterations);
+		AppendSummary(out, "net_loop_iteration_seconds", "Wall time of one event loop iteration.", loop.iteration);
+		AppendSummary(out, "net_loop_blocked_seconds", "Time of one iteration spent waiting for events.", loop.blocked);
+		AppendSummary(out, "net_loop_busy_seconds", "Time of one iteration spent running callbacks.", loop.busy);
+		AppendSummary(out, "net_write_latency_seconds", "Sampled latency from Write() to write completion.", loop.write_latency);
+		state.stage = kConnections;
+		state.index = 0;
+		break;
+	}
+	case kConnections:
+		RenderConnections(state, out);
+		break;
+	case kAcceptors:
+		if (!acceptors_.empty()) {
+			AppendHelp(out, "net_accepted_total", "counter", "Connections accepted.");
+			for (auto & it : acceptors_) {
+				AppendValue(out, "net_accepted_total", "{listener=\"" + it.second + "\"}", it.first->GetAcceptStats().accepted);
+			}
+			AppendHelp(out, "net_accept_dropped_total", "counter", "Connections dropped or failed at accept, by reason.");
+			for (auto & it : acceptors_) {
+				SocketAcceptor::AcceptStats stats = it.first->GetAcceptStats();
+				std::string prefix = "{listener=\"" + it.second + "\",reason=\"";
+				AppendValue(out, "net_accept_dropped_total", prefix + "filter\"}", stats.rejected);
+				AppendValue(out, "net_accept_dropped_total", prefix + "rate\"}", stats.rate_limited);
+				AppendValue(out, "net_accept_dropped_total", prefix + "limit\"}", stats.over_limit);
+				AppendValue(out, "net_accept_dropped_total", prefix + "error\"}", stats.errors);
+				AppendValue(out, "net_accept_dropped_total", prefix + "shed\"}", stats.shed);
+			}
+			AppendHelp(out, "net_accept_exhausted_total", "counter", "Descriptor or memory exhaustion events at accept.");
+			for (auto & it : acceptors_) {
+				AppendValue(out, "net_accept_exhausted_total", "{listener=\"" + it.second + "\"}", it.first->GetAcceptStats().exhausted);
+			}
+			AppendHelp(out, "net_accept_paused", "gauge", "Whether accepting is paused.");
+			for (auto & it : acceptors_) {
+				AppendValue(out, "net_accept_paused", "{listener=\"" + it.second + "\"}", it.first->IsPaused() ? 1 : 0);
+			}
+		}
+		state.stage = kPools;
+		break;
+	case kPools:
+		if (!pools_.empty()) {
+			AppendHelp(out, "net_pool_connections", "gauge", "Connection pool connections, by state.");
+			for (auto & it : pools_) {
+				std::string prefix = "{pool=\"" + it.second + "\",state=\"";
+				AppendValue(out, "net_pool_connections", prefix + "idle\"}", it.first->GetIdleCount());
+				AppendValue(out, "net_pool_connections", prefix + "leased\"}", it.first->GetLeasedCount());
+				AppendValue(out, "net_pool_connections", prefix + "connecting\"}", it.first->GetConnectingCount());
+			}
+			AppendHelp(out, "net_pool_failures", "gauge", "Consecutive connect failures of the pool.");
+			for (auto & it : pools_) {
+				AppendValue(out, "net_pool_failures", "{pool=\"" + it.second + "\"}", it.first->GetFailures());
+			}
+		}
+		state.stage = kBuffers;
+		break;
+	case kBuffers: {
+		const i8 * names[] = { "net_buffer_allocs_total", "net_buffer_frees_total", "net_buffer_heap_allocs_total", "net_buffer_in_use" };
+		const i8 * types[] = { "counter", "counter", "counter", "gauge" };
+		const i8 * helps[] = { "BufferPool allocations, by block size.", "BufferPool frees, by block size.",
+			"BufferPool allocations served by the heap, by block size.", "BufferPool blocks in use, by block size." };
+		BufferPool::ClassStats stats;
+		for (i32 metric = 0; metric < 4; ++metric) {
+			AppendHelp(out, names[metric], types[metric], helps[metric]);
+			for (i32 i = 0; i < BufferPool::GetClassCount(); ++i) {
+				if (!BufferPool::GetClassStats(i, stats)) {
+					continue;
+				}
+				i64 values[] = { stats.allocs, stats.frees, stats.heap_allocs, stats.in_use };
+				AppendValue(out, names[metric], "{size=\"" + std::to_string(stats.block_size) + "\"}", values[metric]);
+			}
+		}
+		state.stage = kDone;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void MetricsServer::RenderConnections(RenderState & state, std::string & out) {
+	// 连接可能在两步之间变化, 分段汇总的瞬时值是近似值
+	const std::vector<SocketConnection *> & connections = GetReactor()->GetConnections();
+	size_t end = std::min(connections.size(), state.index + static_cast<size_t>(slice_));
+	for (; state.index < end; ++state.index) {
+		SocketConnection * connection = connections[state.index];
+		i32 out_buffered = connection->GetOutBufferSize();
+		i64 queued = connection->GetSocket()->GetWriteQueueSize();
+		++state.connections;
+		state.out_buffered += out_buffered;
+		state.write_queue += queued;
+		if (queued > state.write_queue_max) {
+			state.write_queue_max = queued;
+		}
+		if (static_cast<i64>(out_buffered) * 4 > static_cast<i64>(connection->GetMaxOutBufferSize()) * 3) {
+			++state.saturated;
+		}
+	}
+	if (state.index < connections.size()) {
+		return;
+	}
+
+	EventReactor * reactor = GetReactor();
+	AppendHelp(out, "net_connections", "gauge", "Established connections on the event loop.");
+	AppendValue(out, "net_connections", "", state.connections);
+	AppendHelp(out, "net_connections_closed_total", "counter", "Connections closed on the event loop.");
+	AppendValue(out, "net_connections_closed_total", "", reactor->GetClosedConnections());
+	AppendHelp(out, "net_received_bytes_total", "counter", "Bytes received by all connections.");
+	AppendValue(out, "net_received_bytes_total", "", reactor->GetBytesIn());
+	AppendHelp(out, "net_sent_bytes_total", "counter", "Bytes written by all connections.");
+	AppendValue(out, "net_sent_bytes_total", "", reactor->GetBytesOut());
+	AppendHelp(out, "net_out_buffer_bytes", "gauge", "Bytes waiting in connection send buffers.");
+	AppendValue(out, "net_out_buffer_bytes", "", state.out_buffered);
+	AppendHelp(out, "net_out_buffer_saturated", "gauge", "Connections whose send buffer is over 3/4 full.");
+	AppendValue(out, "net_out_buffer_saturated", "", state.saturated);
+	AppendHelp(out, "net_write_queue_bytes", "gauge", "Bytes queued in libuv write requests.");
+	AppendValue(out, "net_write_queue_bytes", "", state.write_queue);
+	AppendHelp(out, "net_write_queue_max_bytes", "gauge", "Largest libuv write queue of a single connection.");
+	AppendValue(out, "net_write_queue_max_bytes", "", state.write_queue_max);
+	state.stage = kAcceptors;
+}
+
+//*********************************************************************
+//Callback
+//*********************************************************************
+
+void MetricsServer::idle_cb(uv_idle_t * handle) {
+	MetricsServer * server = static_cast<MetricsServer *>(handle->data);
+	std::vector<MetricsConnection *> connections;
+	connections.swap(server->rendering_);
+	for (auto & it : connections) {
+		it->Step();
+	}
+	if (server->rendering_.empty()) {
+		uv_idle_stop(handle);
+	}
+}
+
+void MetricsServer::idle_close_cb(uv_handle_t * handle) {
+	BufferPool::DeAllocate(handle);
+}
+
+void MetricsServer::timeout_cb(uv_timer_t * handle) {
+	static_cast<MetricsServer *>(handle->data)->CheckTimeout();
+}
+
+void MetricsServer::timeout_close_cb(uv_handle_t * handle) {
+	BufferPool::DeAllocate(handle);
+}
+
+}
\ No newline at end of file
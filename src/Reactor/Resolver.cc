@@ -0,0 +1,272 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Reactor/Resolver.h"
+#include "Reactor/EventReactor.h"
+#include "Reactor/EventHandler.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace Net {
+
+const i32 Resolver::kMaxCacheSize;
+
+struct Resolver::Lookup {
+	struct Waiter {
+		Common::WeakReference * reference;
+		u16 port;
+		void * arg;
+	};
+
+	uv_getaddrinfo_t req;
+	Resolver * resolver;
+	std::string host;
+	std::vector<Waiter> waiters;
+};
+
+Resolver::Resolver(EventReactor * reactor)
+	: reactor_(reactor), logger_(Logger::Category::GetCategory("Resolver")), ttl_(60000), negative_ttl_(5000), lookups_(0) {
+}
+
+Resolver::~Resolver() {
+	// 已提交的请求在事件循环关闭前回调, 只释放资源
+	for (auto & it : pending_) {
+		it.second->resolver = nullptr;
+		uv_cancel(reinterpret_cast<uv_req_t *>(&it.second->req));
+	}
+}
+
+void Resolver::Resolve(const std::string & host, u16 port, EventHandler * handler, void * arg) {
+	std::string key = Normalize(host);
+	if (key.empty()) {
+		Deliver(handler, UV_EINVAL, std::vector<IPAddress>(), port, arg);
+		return;
+	}
+
+	IPAddress ip;
+	if (IPAddress::TryParse(key.c_str(), ip)) {
+		Deliver(handler, 0, std::vector<IPAddress>(1, ip), port, arg);
+		return;
+	}
+
+	auto host_it = hosts_.find(key);
+	if (host_it != hosts_.end()) {
+		Deliver(handler, 0, host_it->second, port, arg);
+		return;
+	}
+
+	Lookup::Waiter waiter;
+	waiter.reference = handler->IncWeakRef();
+	waiter.port = port;
+	waiter.arg = arg;
+
+	auto pending_it = pending_.find(key);
+	if (pending_it != pending_.end()) {
+		pending_it->second->waiters.push_back(waiter);
+		return;
+	}
+
+	auto cache_it = cache_.find(key);
+	if (cache_it != cache_.end()) {
+		if (cache_it->second.expire > uv_now(reactor_->GetUvLoop())) {
+			waiter.reference->Release();
+			Deliver(handler, cache_it->second.status, cache_it->second.hosts, port, arg);
+			return;
+		}
+		cache_.erase(cache_it);
+	}
+
+	Lookup * lookup = new Lookup();
+	lookup->req.data = lookup;
+	lookup->resolver = this;
+	lookup->host = key;
+	lookup->waiters.push_back(waiter);
+
+	struct addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	i32 status = uv_getaddrinfo(reactor_->GetUvLoop(), &lookup->req, getaddrinfo_cb, key.c_str(), nullptr, &hints);
+	if (status < 0) {
+		logger_->Error("uv_getaddrinfo() - %s %s(%d)", key.c_str(), uv_strerror(status), status);
+		waiter.reference->Release();
+		delete lookup;
+		Deliver(handler, status, std::vector<IPAddress>(), port, arg);
+		return;
+	}
+	++lookups_;
+	pending_[key] = lookup;
+}
+
+void Resolver::SetTTL(i32 ttl, i32 negative_ttl) {
+	ttl_ = ttl > 0 ? ttl : 0;
+	negative_ttl_ = negative_ttl > 0 ? negative_ttl : 0;
+	cache_.clear();
+}
+
+bool Resolver::AddHost(const std::string & host, const i8 * ip) {
+	std::string key = Normalize(host);
+	IPAddress address;
+	if (key.empty() || !IPAddress::TryParse(ip, address)) {
+		return false;
+	}
+	std::vector<IPAddress> & hosts = hosts_[key];
+	if (std::find(hosts.begin(), hosts.end(), address) == hosts.end()) {
+		hosts.push_back(address);
+	}
+	return true;
+}
+
+void Resolver::RemoveHost(const std::string & host) {
+	hosts_.erase(Normalize(host));
+}
+
+i32 Resolver::LoadHosts(const std::string & path) {
+	std::ifstream file(path.c_str());
+	if (!file) {
+		return UV_ENOENT;
+	}
+
+	i32 count = 0;
+	std::string line;
+	while (std::getline(file, line)) {
+		std::string::size_type comment = line.find('#');
+		if (comment != std::string::npos) {
+			line.erase(comment);
+		}
+		std::istringstream fields(line);
+		std::string ip, name;
+		if (!(fields >> ip)) {
+			continue;
+		}
+		while (fields >> name) {
+			if (AddHost(name, ip.c_str())) {
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+void Resolver::ClearCache() {
+	cache_.clear();
+}
+
+void Resolver::Complete(Lookup * lookup, i32 status, const std::vector<IPAddress> & hosts) {
+	pending_.erase(lookup->host);
+	Store(lookup->host, status, hosts);
+	// 回调中可能再次调用Resolve(), 先从pending_中移除
+	for (auto & it : lookup->waiters) {
+		EventHandler * handler = dynamic_cast<EventHandler *>(it.reference->Lock());
+		if (handler) {
+			Deliver(handler, status, hosts, it.port, it.arg);
+			handler->Release();
+		}
+		it.reference->Release();
+	}
+	delete lookup;
+}
+
+void Resolver::Store(const std::string & host, i32 status, const std::vector<IPAddress> & hosts) {
+	// 请求被取消时不缓存
+	i32 ttl = 0 == status ? ttl_ : (UV_EAI_CANCELED == status ? 0 : negative_ttl_);
+	if (ttl <= 0) {
+		return;
+	}
+
+	u64 now = uv_now(reactor_->GetUvLoop());
+	if (static_cast<i32>(cache_.size()) >= kMaxCacheSize) {
+		for (auto it = cache_.begin(); it != cache_.end();) {
+			if (it->second.expire <= now) {
+				it = cache_.erase(it);
+			} else {
+				++it;
+			}
+		}
+		if (static_cast<i32>(cache_.size()) >= kMaxCacheSize) {
+			cache_.clear();
+		}
+	}
+
+	Entry & entry = cache_[host];
+	entry.status = status;
+	entry.expire = now + ttl;
+	entry.hosts = hosts;
+}
+
+void Resolver::Deliver(EventHandler * handler, i32 status, const std::vector<IPAddress> & hosts, u16 port, void * arg) {
+	std::vector<SocketAddress> addresses;
+	addresses.reserve(hosts.size());
+	for (auto & it : hosts) {
+		addresses.push_back(SocketAddress(it, port));
+	}
+	handler->ResolveCallback(status, addresses, arg);
+}
+
+std::string Resolver::Normalize(const std::string & host) {
+	std::string key(host);
+	std::transform(key.begin(), key.end(), key.begin(), [](i8 c) { return static_cast<i8>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c); });
+	// 去掉完全限定名末尾的点
+	if (key.size() > 1 && '.' == key.back()) {
+		key.pop_back();
+	}
+	return key;
+}
+
+//*********************************************************************
+//Callback
+//*********************************************************************
+
+void Resolver::getaddrinfo_cb(uv_getaddrinfo_t * req, int status, struct addrinfo * res) {
+	Lookup * lookup = static_cast<Lookup *>(req->data);
+	std::vector<IPAddress> hosts;
+	for (struct addrinfo * ai = res; ai; ai = ai->ai_next) {
+		if (AF_INET != ai->ai_family && AF_INET6 != ai->ai_family) {
+			continue;
+		}
+		IPAddress host = SocketAddress(ai->ai_addr, static_cast<socklen_t>(ai->ai_addrlen)).Host();
+		if (std::find(hosts.begin(), hosts.end(), host) == hosts.end()) {
+			hosts.push_back(host);
+		}
+	}
+	if (res) {
+		uv_freeaddrinfo(res);
+	}
+	if (0 == status && hosts.empty()) {
+		status = UV_EAI_NONAME;
+	}
+
+	if (lookup->resolver) {
+		lookup->resolver->Complete(lookup, status, hosts);
+	} else {
+		for (auto & it : lookup->waiters) {
+			it.reference->Release();
+		}
+		delete lookup;
+	}
+}
+
+}
\ No newline at end of file
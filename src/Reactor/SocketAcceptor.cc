@@ -26,15 +26,23 @@
 #include "Reactor/EventReactor.h"
 #include "Reactor/SocketConnection.h"
 #include "Sockets/StreamSocket.h"
+#include "Common/BufferPool.h"
+#include "Common/Probes.h"
 #include "Category.h"
 
 namespace Net {
 
-SocketAcceptor::SocketAcceptor(EventReactor * reactor) : EventHandler(reactor, Logger::Category::GetCategory("SocketAcceptor")), opened_(false) {
+SocketAcceptor::SocketAcceptor(EventReactor * reactor) : EventHandler(reactor, Logger::Category::GetCategory("SocketAcceptor")), opened_(false), rejected_(0), rate_limited_(0), over_limit_(0)
+	, accepted_(0), errors_(0), exhausted_(0), shed_(0), pauses_(0), pause_time_(100), paused_(false), held_(false), held_time_(0), timer_(nullptr)
+	, lifecycle_(std::make_shared<LifecycleStats>()) {
 }
 
 SocketAcceptor::~SocketAcceptor() {
 	Close();
+	if (timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(timer_), timer_close_cb);
+		timer_ = nullptr;
+	}
 }
 
 bool SocketAcceptor::Open(const SocketAddress & address, i32 backlog, bool ipv6_only) {
@@ -45,9 +53,16 @@ bool SocketAcceptor::Open(const SocketAddress & address, i32 backlog, bool ipv6_
 	if (socket_.Bind(address, ipv6_only) < 0) {
 		return false;
 	}
+	if (options_.fast_open > 0) {
+		// 不支持时仍可正常监听
+		socket_.SetFastOpen(options_.fast_open);
+	}
 	if (socket_.Listen(backlog) < 0) {
 		return false;
 	}
+	if (socket_.ReserveDescriptor() < 0) {
+		logger_->Warn("Open - %s:reserve descriptor error", *address.ToString());
+	}
 	return GetReactor()->AddEventHandler(this);
 }
 
@@ -66,6 +81,11 @@ bool SocketAcceptor::RegisterToReactor() {
 
 bool SocketAcceptor::UnRegisterFromReactor() {
 	opened_ = false;
+	paused_ = false;
+	held_ = false;
+	if (timer_) {
+		uv_timer_stop(timer_);
+	}
 	socket_.Close();
 	return true;
 }
@@ -75,31 +95,153 @@ bool SocketAcceptor::ActivateConnection(SocketConnection * connection) {
 	return connection->Establish();
 }
 
+SocketAcceptor::AcceptStats SocketAcceptor::GetAcceptStats() const {
+	AcceptStats stats;
+	stats.accepted = accepted_;
+	stats.rejected = rejected_;
+	stats.rate_limited = rate_limited_;
+	stats.over_limit = over_limit_;
+	stats.errors = errors_;
+	stats.exhausted = exhausted_;
+	stats.shed = shed_;
+	stats.pauses = pauses_;
+	stats.paused = paused_;
+	return stats;
+}
+
 void SocketAcceptor::AcceptCallback(i32 status) {
+	NET_PROBE2(accept, this, status);
+	if (UV_EMFILE == status || UV_ENFILE == status || UV_ENOBUFS == status || UV_ENOMEM == status) {
+		HandleExhausted(status);
+		return;
+	}
 	if (status < 0) {
+		++errors_;
 		logger_->Error("AcceptCallback - %s:%s(%d)", *GetListenAddress().ToString(), uv_strerror(status), status);
 		return;
 	}
+	// 从本轮epoll返回算起, 包含排在前面的回调耗时; 未开启SetLoopStats时只能从本回调开始
+	LoopStats * stats = LoopStats::Current();
+	u64 ready = stats && stats->GetPollReady() > 0 ? stats->GetPollReady() : uv_hrtime();
+	if (paused_) {
+		// 不调用uv_accept, libuv保留这个连接并停止监听可读, 恢复时再接入
+		held_ = true;
+		held_time_ = ready;
+		return;
+	}
+	Accept(ready);
+}
+
+void SocketAcceptor::HandleExhausted(i32 status) {
+	++exhausted_;
+	if (!paused_) {
+		logger_->Warn("AcceptCallback - %s:%s(%d), pause %dms", *GetListenAddress().ToString(), uv_strerror(status), status, pause_time_);
+	}
+	// EMFILE/ENFILE能到这里说明libuv自己的预留描述符已用掉; 它在回调后立即重试accept,
+	// 必须用我们的预留描述符清空等待队列, 否则线程一直空转
+	i32 count = socket_.ShedPending();
+	if (count > 0) {
+		shed_ += count;
+	}
+	Pause();
+}
 
+void SocketAcceptor::Pause() {
+	if (paused_ || !opened_) {
+		return;
+	}
+	if (!timer_) {
+		timer_ = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+		uv_timer_init(GetReactor()->GetUvLoop(), timer_);
+		timer_->data = this;
+	}
+	paused_ = true;
+	++pauses_;
+	uv_timer_start(timer_, resume_cb, pause_time_, 0);
+}
+
+void SocketAcceptor::Resume() {
+	paused_ = false;
+	if (held_) {
+		held_ = false;
+		Accept(held_time_);
+	}
+}
+
+void SocketAcceptor::Accept(u64 ready) {
 	StreamSocket client;
 	if (!socket_.AcceptSocket(client)) {
+		++errors_;
 		logger_->Error("AcceptCallback - %s:accept socket error", *GetListenAddress().ToString());
 		return;
 	}
+	lifecycle_->setup.Record(uv_hrtime() - ready);
+
+	SocketAddress remote = client.RemoteAddress();
+	IPAddress host = remote.Host();
+	std::shared_ptr<const AddressFilter> filter = std::atomic_load(&filter_);
+	if (filter && !filter->IsAllowed(host)) {
+		++rejected_;
+		client.Close();
+		return;
+	}
+
+	// 在创建连接对象前限流, 超限的连接只付出一次accept和close
+	std::shared_ptr<ConnectionLimiter> limiter = limiter_;
+	if (limiter) {
+		ConnectionLimiter::eResult result = limiter->Acquire(host, uv_now(GetReactor()->GetUvLoop()));
+		if (ConnectionLimiter::kAccepted != result) {
+			if (ConnectionLimiter::kRateLimited == result) {
+				++rate_limited_;
+			} else {
+				++over_limit_;
+			}
+			client.Close();
+			return;
+		}
+	}
 
 	SocketConnection * connection = CreateConnection();
 	if (!connection) {
-		logger_->Error("AcceptCallback - %s:create connecton error", *client.RemoteAddress().ToString());
+		logger_->Error("AcceptCallback - %s:create connecton error", *remote.ToString());
+		if (limiter) {
+			limiter->Release(host);
+		}
 		return;
 	}
 
 	connection->SetSocket(client);
+	connection->SetSocketOptions(options_);
+	// 限流名额按这个地址占用, 连接沿用它, 避免对端重置后再次getpeername得到空地址
+	connection->address_ = remote;
 	if (ActivateConnection(connection)) {
+		++accepted_;
+		NET_PROBE2(accept__established, this, connection);
+		connection->limiter_ = limiter;
+		connection->limiter_host_ = host;
+		u64 now = uv_hrtime();
+		lifecycle_->handshake.Record(now - ready);
+		connection->TraceLifecycle(lifecycle_, now);
 		connection->CallOnConnected();
 	} else {
-		logger_->Error("AcceptCallback - %s:activate connecton error", *client.RemoteAddress().ToString());
+		logger_->Error("AcceptCallback - %s:activate connecton error", *remote.ToString());
+		if (limiter) {
+			limiter->Release(host);
+		}
 		DestroyConnection(connection);
 	}
 }
 
+//*********************************************************************
+//Callback
+//*********************************************************************
+
+void SocketAcceptor::resume_cb(uv_timer_t * handle) {
+	static_cast<SocketAcceptor *>(handle->data)->Resume();
+}
+
+void SocketAcceptor::timer_close_cb(uv_handle_t * handle) {
+	BufferPool::DeAllocate(handle);
+}
+
 }
\ No newline at end of file
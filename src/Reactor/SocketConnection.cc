@@ -24,18 +24,29 @@
 
 #include "Reactor/SocketConnection.h"
 #include "Reactor/EventReactor.h"
+#include "Common/Probes.h"
 #include "Category.h"
+#include <algorithm>
 
 namespace Net {
 
 SocketConnection::SocketConnection(i32 max_out_buffer_size, i32 max_in_buffer_size)
-	: EventHandler(nullptr, Logger::Category::GetCategory("SocketConnection")), connect_state_(ConnectState::kDisconnected)
-	, max_out_buffer_size_(max_out_buffer_size), max_in_buffer_size_(max_in_buffer_size), shutdown_(false)
-	, called_on_connected_(false), called_on_disconnected_(false) {
+	: EventHandler(nullptr, Logger::Category::GetCategory("SocketConnection")), out_buffer_(new Common::BipBuffer()), connect_state_(ConnectState::kDisconnected)
+	, max_out_buffer_size_(max_out_buffer_size), max_in_buffer_size_(max_in_buffer_size)
+	, pending_block_(nullptr), pending_size_(0), flush_scheduled_(false), uv_outstanding_(0)
+	, zerocopy_threshold_(0), zerocopy_outstanding_(0), zerocopy_sends_(0), zerocopy_copied_(0)
+	, zerocopy_(false), file_(-1), file_offset_(0), file_length_(0), file_queued_(false), file_sending_(false)
+	, file_received_(0), file_receiving_(false)
+	, corked_(false), shutdown_write_pending_(false), shutdown_(false)
+	, called_on_connected_(false), called_on_disconnected_(false), buffered_bytes_(0), released_bytes_(0)
+	, connected_time_(0), first_read_(false), first_write_(false), connection_index_(-1), tcp_info_time_(0) {
+	std::memset(&traffic_, 0, sizeof(traffic_));
+	std::memset(&tcp_info_, 0, sizeof(tcp_info_));
 }
 
 SocketConnection::~SocketConnection() {
 	ShutdownImmediately();
+	delete out_buffer_;
 }
 
 bool SocketConnection::RegisterToReactor() {
@@ -45,26 +56,118 @@ bool SocketConnection::RegisterToReactor() {
 	if (socket_.Established() < 0) {
 		return false;
 	}
-	out_buffer_.Allocate(max_out_buffer_size_);
+	// SocketAcceptor已经取过对端地址, 不再重复getpeername
+	if (0 == address_.Port()) {
+		address_ = socket_.RemoteAddress();
+	}
+	out_buffer_->Allocate(max_out_buffer_size_);
 	in_buffer_.Allocate(max_in_buffer_size_);
 	socket_.SetNoDelay();
 	socket_.SetKeepAlive(60);
+	socket_.SetOptions(options_);
+	if (GetReactor()->IsBusyPoll()) {
+		i32 status = socket_.SetBusyPoll(GetReactor()->GetSpinBudget());
+		if (status < 0) {
+			logger_->Warn("RegisterToReactor %s:busy poll not applied, %s(%d)", *address_.ToString(), uv_strerror(status), status);
+		}
+	}
+	zerocopy_ = zerocopy_threshold_ > 0 && 0 == socket_.SetZeroCopy(true);
 	socket_.SetUvData(this);
-	address_ = socket_.RemoteAddress();
+	std::memset(&traffic_, 0, sizeof(traffic_));
+	traffic_.last_read = traffic_.last_write = uv_now(GetReactor()->GetUvLoop());
+	std::memset(&tcp_info_, 0, sizeof(tcp_info_));
+	tcp_info_time_ = 0;
+	GetReactor()->AddConnection(this);
 	connect_state_ = ConnectState::kConnected;
 	return true;
 }
 
+void SocketConnection::TrafficStats::Add(const TrafficStats & other) {
+	bytes_in += other.bytes_in;
+	bytes_out += other.bytes_out;
+	messages_in += other.messages_in;
+	messages_out += other.messages_out;
+	reads += other.reads;
+	writes += other.writes;
+	peak_out_buffer = std::max(peak_out_buffer, other.peak_out_buffer);
+	peak_in_buffer = std::max(peak_in_buffer, other.peak_in_buffer);
+	peak_write_queue = std::max(peak_write_queue, other.peak_write_queue);
+	last_read = std::max(last_read, other.last_read);
+	last_write = std::max(last_write, other.last_write);
+}
+
+i32 SocketConnection::SampleTcpInfo() {
+	if (ConnectState::kConnected != connect_state_ && ConnectState::kDisconnecting != connect_state_) {
+		return UV_ENOTCONN;
+	}
+	TcpInfo info;
+	i32 status = socket_.GetTcpInfo(info);
+	if (status < 0) {
+		return status;
+	}
+	// 重传数是累计值, 分布中记录两次抽样之间的增量
+	u32 retransmits = info.retransmits >= tcp_info_.retransmits ? info.retransmits - tcp_info_.retransmits : 0;
+	tcp_info_ = info;
+	tcp_info_time_ = uv_now(GetReactor()->GetUvLoop());
+	GetReactor()->RecordTcpInfo(info, retransmits);
+	return 0;
+}
+
+u64 SocketConnection::GetReadIdleTime() const {
+	if (ConnectState::kDisconnected == connect_state_) {
+		return 0;
+	}
+	return uv_now(GetReactor()->GetUvLoop()) - traffic_.last_read;
+}
+
+u64 SocketConnection::GetWriteIdleTime() const {
+	if (ConnectState::kDisconnected == connect_state_) {
+		return 0;
+	}
+	return uv_now(GetReactor()->GetUvLoop()) - traffic_.last_write;
+}
+
 bool SocketConnection::UnRegisterFromReactor() {
 	if (ConnectState::kConnected != connect_state_ && ConnectState::kDisconnecting != connect_state_) {
 		return false;
 	}
 	connect_state_ = ConnectState::kDisconnected;
-	out_buffer_.DeAllocate();
+	pending_block_ = nullptr;
+	pending_size_ = 0;
+	uv_outstanding_ = 0;
+	zerocopy_held_.clear();
+	zerocopy_ = false;
+	file_held_.clear();
+	file_queued_ = false;
+	file_sending_ = false;
+	file_received_ = 0;
+	file_receiving_ = false;
+	corked_ = false;
+	shutdown_write_pending_ = false;
 	in_buffer_.DeAllocate();
+	write_samples_.clear();
+	buffered_bytes_ = 0;
+	released_bytes_ = 0;
+	lifecycle_.reset();
+	GetReactor()->RemoveConnection(this);
+	if (limiter_) {
+		limiter_->Release(limiter_host_);
+		limiter_.reset();
+		limiter_host_ = IPAddress();
+	}
 	address_ = SocketAddress();
-	socket_.ShutdownRead();
-	socket_.Close();
+	GetReactor()->UnwatchZeroCopy(this);
+	if (zerocopy_outstanding_ > 0) {
+		// 关闭后内核仍会发送或重传引用发送缓冲区页面的数据, 收齐完成通知前不能回收
+		GetReactor()->ParkZeroCopy(socket_, out_buffer_, zerocopy_outstanding_);
+		zerocopy_outstanding_ = 0;
+		out_buffer_ = new Common::BipBuffer();
+		socket_ = StreamSocket();
+	} else {
+		out_buffer_->DeAllocate();
+		socket_.ShutdownRead();
+		socket_.Close();
+	}
 	return true;
 }
 
@@ -72,12 +175,246 @@ bool SocketConnection::Establish() {
 	return GetReactor()->AddEventHandler(this);
 }
 
+void SocketConnection::Flush() {
+	flush_scheduled_ = false;
+	if (ConnectState::kConnected == connect_state_ || ConnectState::kDisconnecting == connect_state_) {
+		i32 status = FlushPending();
+		if (corked_) {
+			// 拔塞, 本轮写入的数据一次发出
+			corked_ = false;
+			socket_.SetCork(false);
+		}
+		if (status < 0) {
+			InternalError(status);
+		}
+	}
+}
+
+i32 SocketConnection::FlushPending() {
+	if (pending_size_ <= 0) {
+		return 0;
+	}
+	i8 * block = pending_block_;
+	i32 size = pending_size_;
+	pending_block_ = nullptr;
+	pending_size_ = 0;
+	return SubmitWrite(block, size);
+}
+
+i32 SocketConnection::SubmitWrite(i8 * block, i32 len) {
+	if (file_queued_ || file_sending_) {
+		// 文件发送期间暂存, 完成后再提交
+		if (!file_held_.empty() && block == file_held_.back().first + file_held_.back().second) {
+			file_held_.back().second += len;
+		} else {
+			file_held_.push_back(std::make_pair(block, len));
+		}
+		return len;
+	}
+	i32 status = socket_.Write(block, len, reinterpret_cast<void *>(static_cast<i64>(len)));
+	if (status > 0) {
+		++uv_outstanding_;
+		++traffic_.writes;
+		i32 queued = socket_.GetWriteQueueSize();
+		if (queued > traffic_.peak_write_queue) {
+			traffic_.peak_write_queue = queued;
+		}
+	}
+	return status;
+}
+
+i32 SocketConnection::SendFile(uv_file file, i64 offset, i64 length) {
+	if (ConnectState::kConnected != connect_state_) {
+		return UV_ENOTCONN;
+	}
+	if (file < 0 || offset < 0 || length <= 0) {
+		return UV_EINVAL;
+	}
+	if (file_queued_ || file_sending_) {
+		return UV_EBUSY;
+	}
+	i32 status = FlushPending();
+	if (status < 0) {
+		return status;
+	}
+	file_ = file;
+	file_offset_ = offset;
+	file_length_ = length;
+	file_queued_ = true;
+	++traffic_.messages_out;
+	// 等已提交的写请求完成后再开始, 保证字节顺序
+	if (0 == uv_outstanding_) {
+		file_queued_ = false;
+		status = socket_.SendFile(file_, file_offset_, file_length_);
+		if (status < 0) {
+			return status;
+		}
+		file_sending_ = true;
+	}
+	return 0;
+}
+
+void SocketConnection::StartSendFile() {
+	file_queued_ = false;
+	i32 status = socket_.SendFile(file_, file_offset_, file_length_);
+	if (status < 0) {
+		FinishSendFile(status, 0);
+		InternalError(status);
+	} else {
+		file_sending_ = true;
+	}
+}
+
+void SocketConnection::FinishSendFile(i32 status, i64 sent) {
+	file_queued_ = false;
+	file_sending_ = false;
+	if (sent > 0) {
+		traffic_.bytes_out += sent;
+		GetReactor()->AddBytesOut(sent);
+		++traffic_.writes;
+		traffic_.last_write = uv_now(GetReactor()->GetUvLoop());
+	}
+	std::vector<std::pair<i8 *, i32>> held;
+	held.swap(file_held_);
+	for (auto & it : held) {
+		if (SubmitWrite(it.first, it.second) < 0) {
+			break;
+		}
+	}
+	if (shutdown_write_pending_ && 0 == zerocopy_outstanding_) {
+		shutdown_write_pending_ = false;
+		socket_.ShutdownWrite();
+	}
+	OnFileSent(status, sent);
+}
+
+i32 SocketConnection::ReceiveToFile(uv_file file, i64 offset, i64 length) {
+	if (file < 0) {
+		return UV_EINVAL;
+	}
+	return StartReceive(file, nullptr, offset, length);
+}
+
+i32 SocketConnection::ReceiveToMemory(i8 * data, i64 length) {
+	if (!data) {
+		return UV_EINVAL;
+	}
+	return StartReceive(-1, data, -1, length);
+}
+
+i32 SocketConnection::StartReceive(uv_file file, i8 * memory, i64 offset, i64 length) {
+	if (ConnectState::kConnected != connect_state_) {
+		return UV_ENOTCONN;
+	}
+	if (length <= 0) {
+		return UV_EINVAL;
+	}
+	if (file_receiving_) {
+		return UV_EBUSY;
+	}
+
+	// 先消费接收缓冲区中已有的数据
+	i32 readable_size = 0;
+	i8 * data = in_buffer_.ReadableBlock(readable_size);
+	i64 received = readable_size < length ? readable_size : length;
+	if (received > 0) {
+		if (memory) {
+			std::memcpy(memory, data, static_cast<size_t>(received));
+		} else {
+			i64 written = 0;
+			while (written < received) {
+				uv_fs_t req;
+				uv_buf_t buf = uv_buf_init(data + written, static_cast<u32>(received - written));
+				i32 status = uv_fs_write(GetReactor()->GetUvLoop(), &req, file, &buf, 1, offset >= 0 ? offset + written : -1, nullptr);
+				uv_fs_req_cleanup(&req);
+				if (status <= 0) {
+					return status < 0 ? status : UV_EIO;
+				}
+				written += status;
+			}
+		}
+		in_buffer_.IncReaderIndex(static_cast<i32>(received));
+	}
+	if (received == length) {
+		OnFileReceived(0, received);
+		return 0;
+	}
+
+	i32 status = memory ? socket_.ReceiveMemory(memory + received, length - received) : socket_.ReceiveFile(file, offset >= 0 ? offset + received : offset, length - received);
+	if (status < 0) {
+		return status;
+	}
+	file_received_ = received;
+	file_receiving_ = true;
+	return 0;
+}
+
+void SocketConnection::SetZeroCopyThreshold(i32 threshold) {
+	zerocopy_threshold_ = threshold > 0 ? threshold : 0;
+	if (ConnectState::kConnected == connect_state_) {
+		zerocopy_ = zerocopy_threshold_ > 0 && 0 == socket_.SetZeroCopy(true);
+	}
+}
+
+i32 SocketConnection::WriteZeroCopy(i8 * block, i32 len) {
+	// 之前的写请求都完成后才走零拷贝, 保证缓冲区按顺序回收
+	if (!zerocopy_ || len < zerocopy_threshold_ || pending_size_ > 0 || uv_outstanding_ > 0 || file_queued_ || file_sending_) {
+		return 0;
+	}
+	i32 sent = socket_.WriteZeroCopy(block, len);
+	if (sent <= 0) {
+		return 0;
+	}
+	++zerocopy_outstanding_;
+	++zerocopy_sends_;
+	++traffic_.writes;
+	zerocopy_held_.push_back(sent);
+	out_buffer_->IncWriterIndex(sent);
+	return sent;
+}
+
+void SocketConnection::ReapZeroCopy() {
+	if (zerocopy_outstanding_ <= 0) {
+		return;
+	}
+	i32 copied = 0;
+	i32 done = socket_.ReapZeroCopy(&copied);
+	if (done <= 0) {
+		return;
+	}
+	zerocopy_copied_ += copied;
+	zerocopy_outstanding_ -= done;
+	if (zerocopy_outstanding_ > 0) {
+		return;
+	}
+	zerocopy_outstanding_ = 0;
+	GetReactor()->UnwatchZeroCopy(this);
+	for (auto & it : zerocopy_held_) {
+		ReleaseOutBuffer(it);
+	}
+	zerocopy_held_.clear();
+	if (shutdown_write_pending_ && !file_queued_ && !file_sending_) {
+		shutdown_write_pending_ = false;
+		socket_.ShutdownWrite();
+	}
+	if (ConnectState::kConnected == connect_state_ || ConnectState::kDisconnecting == connect_state_) {
+		OnSomeDataSent();
+	}
+}
+
 void SocketConnection::Shutdown(bool now) {
 	if (ConnectState::kConnected == connect_state_) {
 		shutdown_ = true;
 		connect_state_ = ConnectState::kDisconnecting;
-		if (out_buffer_.ReadableBytes() > 0 && !now) {
-			socket_.ShutdownWrite();
+		bool file_active = file_queued_ || file_sending_;
+		if ((out_buffer_->ReadableBytes() > 0 || file_active) && !now) {
+			FlushPending();
+			if (zerocopy_outstanding_ > 0 || file_active) {
+				// 关闭写端后连接会被回收, 需等内核释放零拷贝的页面, 文件也需发送完
+				shutdown_write_pending_ = true;
+			} else {
+				socket_.ShutdownWrite();
+			}
 		} else {
 			ShutdownImmediately();
 			CallOnDisconnected(false);
@@ -103,6 +440,12 @@ void SocketConnection::OnNewDataReceived() {
 void SocketConnection::OnSomeDataSent() {
 }
 
+void SocketConnection::OnFileSent(i32 status, i64 sent) {
+}
+
+void SocketConnection::OnFileReceived(i32 status, i64 received) {
+}
+
 void SocketConnection::OnError(i32 reason) {
 }
 
@@ -119,15 +462,27 @@ void SocketConnection::InternalError(i32 reason) {
 void SocketConnection::HandleClose4EOF(i32 reason) {
 	if (ConnectState::kConnected == connect_state_ || ConnectState::kDisconnecting == connect_state_) {
 		connect_state_ = ConnectState::kDisconnecting;
+		bool file_active = file_queued_ || file_sending_;
 		if (shutdown_) {
 			socket_.ShutdownRead();
-		} else if (out_buffer_.ReadableBytes() > 0) {
+		} else if (out_buffer_->ReadableBytes() > 0 || file_active) {
 			shutdown_ = true;
-			socket_.Shutdown();
+			FlushPending();
+			socket_.ShutdownRead();
+			if (zerocopy_outstanding_ > 0 || file_active) {
+				// 同Shutdown(false), 等内核释放零拷贝的页面, 文件也发送完后再关闭写端
+				shutdown_write_pending_ = true;
+			} else {
+				socket_.ShutdownWrite();
+			}
 		} else {
 			ShutdownImmediately();
 			CallOnDisconnected(true);
 		}
+		if (zerocopy_outstanding_ > 0 && ConnectState::kDisconnecting == connect_state_) {
+			// 不再有读事件, 由EventReactor定期回收完成通知
+			GetReactor()->WatchZeroCopy(this);
+		}
 	}
 }
 
@@ -140,21 +495,105 @@ void SocketConnection::HandleClose4Error(i32 reason) {
 }
 
 i32 SocketConnection::Write(const i8 * data, i32 len) {
+	i32 status = WriteData(data, len);
+	NET_PROBE3(write, this, len, status);
+	if (status > 0) {
+		traffic_.bytes_out += status;
+		GetReactor()->AddBytesOut(status);
+		++traffic_.messages_out;
+		i32 buffered = out_buffer_->ReadableBytes();
+		if (buffered > traffic_.peak_out_buffer) {
+			traffic_.peak_out_buffer = buffered;
+		}
+		buffered_bytes_ += status;
+		if (GetReactor()->SampleWrite() && write_samples_.size() < kMaxWriteSamples) {
+			write_samples_.push_back(std::make_pair(buffered_bytes_, uv_hrtime()));
+		}
+	}
+	return status;
+}
+
+void SocketConnection::TraceLifecycle(const std::shared_ptr<LifecycleStats> & lifecycle, u64 now) {
+	lifecycle_ = lifecycle;
+	connected_time_ = now;
+	first_read_ = false;
+	first_write_ = false;
+}
+
+void SocketConnection::ReleaseOutBuffer(i32 len) {
+	out_buffer_->IncReaderIndex(len);
+	released_bytes_ += len;
+	if (lifecycle_ && !first_write_) {
+		first_write_ = true;
+		lifecycle_->first_write.Record(uv_hrtime() - connected_time_);
+	}
+	// 数据按写入顺序确认, 抽样写入的最后一个字节确认时该次写入完成
+	if (!write_samples_.empty() && write_samples_.front().first <= released_bytes_) {
+		u64 now = uv_hrtime();
+		do {
+			GetReactor()->RecordWriteLatency(now - write_samples_.front().second);
+			write_samples_.pop_front();
+		} while (!write_samples_.empty() && write_samples_.front().first <= released_bytes_);
+	}
+}
+
+i32 SocketConnection::WriteData(const i8 * data, i32 len) {
 	if (ConnectState::kConnected != connect_state_) {
 		return UV_ENOTCONN;
 	}
 
 	i32 writable_size = 0;
-	i8 * block = out_buffer_.WritableBlock(len, writable_size);
+	i8 * block = out_buffer_->WritableBlock(len, writable_size);
 	if (!block || writable_size < len) {
-		logger_->Warn("Write %s:buffer not enough, writable / len / total / max : %d / %d / %d / %d", *address_.ToString(), writable_size, len, out_buffer_.ReadableBytes(), max_out_buffer_size_);
+		NET_PROBE4(write__nobufs, this, len, writable_size, out_buffer_->ReadableBytes());
+		logger_->Warn("Write %s:buffer not enough, writable / len / total / max : %d / %d / %d / %d", *address_.ToString(), writable_size, len, out_buffer_->ReadableBytes(), max_out_buffer_size_);
 		return UV_ENOBUFS;
 	}
 
 	std::memcpy(block, data, writable_size);
-	i32 status = socket_.Write(block, writable_size, reinterpret_cast<void *>(static_cast<i64>(writable_size)));
+	if (options_.cork && !corked_) {
+		// 本轮事件循环的写入先塞住, 在检查阶段的Flush()中发出
+		corked_ = 0 == socket_.SetCork(true);
+		if (corked_ && !flush_scheduled_) {
+			flush_scheduled_ = true;
+			GetReactor()->ScheduleFlush(this);
+		}
+	}
+	i32 sent = WriteZeroCopy(block, writable_size);
+	if (sent == writable_size) {
+		return writable_size;
+	}
+	block += sent;
+	writable_size -= sent;
+
+	if (GetReactor()->IsWriteBatching()) {
+		// 与未提交的数据不连续时先提交之前的
+		if (pending_size_ > 0 && block != pending_block_ + pending_size_) {
+			i32 status = FlushPending();
+			if (status < 0) {
+				return status;
+			}
+		}
+		if (0 == pending_size_) {
+			pending_block_ = block;
+		}
+		pending_size_ += writable_size;
+		out_buffer_->IncWriterIndex(writable_size);
+		if (!flush_scheduled_) {
+			flush_scheduled_ = true;
+			GetReactor()->ScheduleFlush(this);
+		}
+		return sent + writable_size;
+	}
+
+	i32 status = FlushPending();
+	if (status < 0) {
+		return status;
+	}
+	status = SubmitWrite(block, writable_size);
 	if (status > 0) {
-		out_buffer_.IncWriterIndex(writable_size);
+		out_buffer_->IncWriterIndex(writable_size);
+		status += sent;
 	}
 	return status;
 }
@@ -190,25 +629,87 @@ void SocketConnection::AllocCallback(uv_buf_t * buf) {
 }
 
 void SocketConnection::ReadCallback(i32 status) {
+	// 零拷贝完成通知会以EPOLLERR唤醒读事件, 此时status为0
+	ReapZeroCopy();
 	if (status < 0) {
 		InternalError(status);
-	} else {
+	} else if (status > 0) {
+		++traffic_.reads;
 		in_buffer_.IncWriterIndex(status);
+		if (lifecycle_ && !first_read_) {
+			first_read_ = true;
+			lifecycle_->first_read.Record(uv_hrtime() - connected_time_);
+		}
+		traffic_.bytes_in += status;
+		GetReactor()->AddBytesIn(status);
+		traffic_.last_read = uv_now(GetReactor()->GetUvLoop());
+		i32 buffered = in_buffer_.ReadableBytes();
+		if (buffered > traffic_.peak_in_buffer) {
+			traffic_.peak_in_buffer = buffered;
+		}
+		if (options_.quick_ack) {
+			socket_.SetQuickAck(true);
+		}
 		if (ConnectState::kConnected == connect_state_ || ConnectState::kDisconnecting == connect_state_) {
+			++traffic_.messages_in;
 			OnNewDataReceived();
 		}
 	}
 }
 
 void SocketConnection::WrittenCallback(i32 status, void * arg) {
+	if (uv_outstanding_ > 0) {
+		--uv_outstanding_;
+	}
 	if (status < 0) {
 		InternalError(status);
+	} else if (zerocopy_outstanding_ > 0) {
+		traffic_.last_write = uv_now(GetReactor()->GetUvLoop());
+		zerocopy_held_.push_back(static_cast<i32>(reinterpret_cast<i64>(arg)));
+		ReapZeroCopy();
 	} else {
-		out_buffer_.IncReaderIndex(static_cast<i32>(reinterpret_cast<i64>(arg)));
+		traffic_.last_write = uv_now(GetReactor()->GetUvLoop());
+		ReleaseOutBuffer(static_cast<i32>(reinterpret_cast<i64>(arg)));
 		if (ConnectState::kConnected == connect_state_ || ConnectState::kDisconnecting == connect_state_) {
 			OnSomeDataSent();
 		}
 	}
+	if (file_queued_ && 0 == uv_outstanding_ && (ConnectState::kConnected == connect_state_ || ConnectState::kDisconnecting == connect_state_)) {
+		StartSendFile();
+	}
+}
+
+void SocketConnection::SendFileCallback(i32 status, i64 sent, void * arg) {
+	if (!file_sending_) {
+		// 连接已关闭
+		return;
+	}
+	FinishSendFile(status, sent);
+	if (status < 0) {
+		InternalError(status);
+	}
+}
+
+void SocketConnection::ReceiveFileCallback(i32 status, i64 received, void * arg) {
+	if (!file_receiving_) {
+		// 连接已关闭
+		return;
+	}
+	file_receiving_ = false;
+	traffic_.bytes_in += received;
+	GetReactor()->AddBytesIn(received);
+	if (received > 0) {
+		traffic_.last_read = uv_now(GetReactor()->GetUvLoop());
+	}
+	received += file_received_;
+	file_received_ = 0;
+	if (status >= 0) {
+		status = socket_.Established();
+	}
+	OnFileReceived(status, received);
+	if (status < 0) {
+		InternalError(status);
+	}
 }
 
 }
\ No newline at end of file
@@ -25,43 +25,118 @@
 #include "Reactor/SocketConnector.h"
 #include "Reactor/EventReactor.h"
 #include "Reactor/SocketConnection.h"
+#include "Reactor/Resolver.h"
+#include "Common/BufferPool.h"
 #include "Category.h"
+#include <algorithm>
+#include <set>
 
 namespace Net {
 
-SocketConnector::SocketConnector(EventReactor * reactor) : EventHandler(reactor, Logger::Category::GetCategory("SocketConnector")), connect_(false) {
+struct SocketConnector::ConnectAttempt {
+	StreamSocket socket;
+	uv_timer_t * timer;
+	std::list<ConnectAttempt *>::iterator position;
+	ConnectRace * race;
+	bool timed_out;
+};
+
+// 同一目标的多个候选地址, 先建立的连接胜出, host不为空时先解析
+struct SocketConnector::ConnectRace {
+	SocketConnector * connector;
+	std::string host;
+	u16 port;
+	std::vector<SocketAddress> addresses;
+	size_t next;
+	std::vector<ConnectAttempt *> attempts;
+	uv_timer_t * timer;
+	u64 start;
+	bool done;
+};
+
+SocketConnector::SocketConnector(EventReactor * reactor)
+	: EventHandler(reactor, Logger::Category::GetCategory("SocketConnector")), connect_(false)
+	, max_connecting_(1), max_queued_(0), connect_timeout_(0), fallback_delay_(250)
+	, connecting_(0), resolving_(0), generation_(0)
+	, lifecycle_(std::make_shared<LifecycleStats>()) {
 }
 
 SocketConnector::~SocketConnector() {
 	Close();
+	// 已无法收到回调的连接
+	std::set<ConnectRace *> races;
+	for (auto & it : attempts_) {
+		if (it->timer) {
+			uv_close(reinterpret_cast<uv_handle_t *>(it->timer), timer_close_cb);
+		}
+		races.insert(it->race);
+		delete it;
+	}
+	for (auto & it : races) {
+		it->attempts.clear();
+		DeleteRace(it);
+	}
 }
 
 bool SocketConnector::Connect(const SocketAddress & address) {
-	if (connect_) {
-		return false;
-	}
-	socket_.Open(GetReactor()->GetUvLoop());
-	if (socket_.Connect(address) < 0) {
-		return false;
-	}
-	return GetReactor()->AddEventHandler(this);
+	ConnectRace * race = new ConnectRace();
+	race->connector = this;
+	race->port = 0;
+	race->addresses.push_back(address);
+	race->next = 0;
+	race->timer = nullptr;
+	race->start = uv_hrtime();
+	race->done = false;
+	return Enqueue(race);
+}
+
+bool SocketConnector::Connect(const std::string & host, u16 port) {
+	ConnectRace * race = new ConnectRace();
+	race->connector = this;
+	race->host = host;
+	race->port = port;
+	race->next = 0;
+	race->timer = nullptr;
+	race->start = uv_hrtime();
+	race->done = false;
+	return Enqueue(race);
 }
 
 void SocketConnector::Close() {
-	if (connect_) {
-		GetReactor()->RemoveEventHandler(this);
+	for (auto & it : queued_) {
+		DeleteRace(it);
 	}
+	queued_.clear();
+	// 进行中的解析结果到达时按UV_ECANCELED失败
+	++generation_;
+	for (auto & it : attempts_) {
+		// 不再尝试剩余地址, 关闭后以UV_ECANCELED回调ConnectCallback
+		it->race->next = it->race->addresses.size();
+		it->socket.Close();
+	}
+	CheckIdle();
+}
+
+void SocketConnector::SetConcurrency(i32 max_connecting, i32 max_queued) {
+	max_connecting_ = max_connecting > 0 ? max_connecting : 1;
+	max_queued_ = max_queued > 0 ? max_queued : 0;
+}
+
+void SocketConnector::SetConnectTimeout(i32 msec) {
+	connect_timeout_ = msec > 0 ? msec : 0;
+}
+
+void SocketConnector::SetFallbackDelay(i32 msec) {
+	fallback_delay_ = msec > 0 ? msec : 0;
 }
 
 bool SocketConnector::RegisterToReactor() {
-	socket_.SetUvData(this);
 	connect_ = true;
 	return true;
 }
 
 bool SocketConnector::UnRegisterFromReactor() {
 	connect_ = false;
-	socket_.Close();
 	return true;
 }
 
@@ -70,25 +145,199 @@ bool SocketConnector::ActivateConnection(SocketConnection * connection) {
 	return connection->Establish();
 }
 
+bool SocketConnector::Enqueue(ConnectRace * race) {
+	if (GetConnectingCount() < max_connecting_) {
+		return StartRace(race);
+	}
+	if (static_cast<i32>(queued_.size()) < max_queued_) {
+		queued_.push_back(race);
+		return true;
+	}
+	DeleteRace(race);
+	return false;
+}
+
+bool SocketConnector::StartRace(ConnectRace * race) {
+	if (!race->host.empty()) {
+		// 解析期间占用并发数, 完成后由解析出的地址接替, 缓存命中时在Resolve()内回调
+		std::string host;
+		host.swap(race->host);
+		u16 port = race->port;
+		DeleteRace(race);
+		++resolving_;
+		if (!connect_) {
+			GetReactor()->AddEventHandler(this);
+		}
+		GetReactor()->GetResolver()->Resolve(host, port, this, reinterpret_cast<void *>(static_cast<uintptr_t>(generation_)));
+		return true;
+	}
+	if (!StartNext(race)) {
+		DeleteRace(race);
+		return false;
+	}
+	++connecting_;
+	return true;
+}
+
+bool SocketConnector::StartNext(ConnectRace * race) {
+	while (race->next < race->addresses.size()) {
+		const SocketAddress & address = race->addresses[race->next++];
+		if (!StartAttempt(address, race)) {
+			logger_->Error("StartNext - %s:connect error", *address.ToString());
+			continue;
+		}
+		// 还有候选地址时, 超过fallback delay仍未完成就并行发起下一个
+		if (race->next < race->addresses.size()) {
+			if (!race->timer) {
+				race->timer = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+				uv_timer_init(GetReactor()->GetUvLoop(), race->timer);
+				race->timer->data = race;
+			}
+			uv_timer_start(race->timer, fallback_cb, fallback_delay_, 0);
+		}
+		return true;
+	}
+	return false;
+}
+
+void SocketConnector::CompleteRace(ConnectRace * race) {
+	race->done = true;
+	--connecting_;
+	if (race->timer) {
+		uv_timer_stop(race->timer);
+	}
+	// 落败的连接关闭后以UV_ECANCELED回调, 全部回调后释放
+	for (auto & it : race->attempts) {
+		it->socket.Close();
+	}
+	if (race->attempts.empty()) {
+		DeleteRace(race);
+	}
+}
+
+void SocketConnector::DeleteRace(ConnectRace * race) {
+	if (race->timer) {
+		uv_close(reinterpret_cast<uv_handle_t *>(race->timer), timer_close_cb);
+	}
+	delete race;
+}
+
+bool SocketConnector::StartAttempt(const SocketAddress & address, ConnectRace * race) {
+	ConnectAttempt * attempt = new ConnectAttempt();
+	attempt->timer = nullptr;
+	attempt->race = race;
+	attempt->timed_out = false;
+	if (options_.fast_open > 0) {
+		attempt->socket.Open(GetReactor()->GetUvLoop(), address.Addr()->sa_family);
+		attempt->socket.SetFastOpenConnect(true);
+	} else {
+		attempt->socket.Open(GetReactor()->GetUvLoop());
+	}
+	attempt->socket.SetUvData(this);
+	if (attempt->socket.Connect(address, attempt) < 0) {
+		delete attempt;
+		return false;
+	}
+
+	if (connect_timeout_ > 0) {
+		attempt->timer = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+		uv_timer_init(GetReactor()->GetUvLoop(), attempt->timer);
+		attempt->timer->data = attempt;
+		uv_timer_start(attempt->timer, timeout_cb, connect_timeout_, 0);
+	}
+	attempt->position = attempts_.insert(attempts_.end(), attempt);
+	race->attempts.push_back(attempt);
+	// 有连接进行中时由reactor持有引用
+	if (!connect_) {
+		GetReactor()->AddEventHandler(this);
+	}
+	return true;
+}
+
+void SocketConnector::FinishAttempt(ConnectAttempt * attempt) {
+	std::vector<ConnectAttempt *> & attempts = attempt->race->attempts;
+	attempts.erase(std::find(attempts.begin(), attempts.end(), attempt));
+	attempts_.erase(attempt->position);
+	if (attempt->timer) {
+		uv_timer_stop(attempt->timer);
+		uv_close(reinterpret_cast<uv_handle_t *>(attempt->timer), timer_close_cb);
+	}
+	delete attempt;
+}
+
+void SocketConnector::StartQueued() {
+	while (!queued_.empty() && GetConnectingCount() < max_connecting_) {
+		ConnectRace * race = queued_.front();
+		queued_.pop_front();
+		if (!StartRace(race)) {
+			OnConnectFailed();
+		}
+	}
+}
+
+void SocketConnector::CheckIdle() {
+	if (connect_ && attempts_.empty() && 0 == resolving_) {
+		GetReactor()->RemoveEventHandler(this);
+	}
+}
+
+//*********************************************************************
+//Callback
+//*********************************************************************
+
 void SocketConnector::ConnectCallback(i32 status, void * arg) {
-	StreamSocket client(socket_);
-	socket_ = StreamSocket();
-	Close();
+	ConnectAttempt * attempt = static_cast<ConnectAttempt *>(arg);
+	ConnectRace * race = attempt->race;
+	StreamSocket client(attempt->socket);
+	if (attempt->timed_out && UV_ECANCELED == status) {
+		status = UV_ETIMEDOUT;
+	}
+	FinishAttempt(attempt);
+
+	// 已有其他地址胜出
+	if (race->done) {
+		client.Close();
+		if (race->attempts.empty()) {
+			DeleteRace(race);
+		}
+		CheckIdle();
+		return;
+	}
+
 	if (status < 0) {
 		logger_->Error("ConnectCallback - %s:%s(%d)", *client.LocalAddress().ToString(), uv_strerror(status), status);
+		client.Close();
+		// 立即尝试下一个地址, 或等待其他进行中的地址
+		if (StartNext(race) || !race->attempts.empty()) {
+			return;
+		}
+		CompleteRace(race);
+		StartQueued();
+		CheckIdle();
 		OnConnectFailed();
 		return;
 	}
 
+	u64 start = race->start;
+	lifecycle_->setup.Record(uv_hrtime() - start);
+	CompleteRace(race);
+	StartQueued();
+	CheckIdle();
+
 	SocketConnection * connection = CreateConnection();
 	if (!connection) {
 		logger_->Error("ConnectCallback - %s:create connecton error", *client.RemoteAddress().ToString());
+		client.Close();
 		OnConnectFailed();
 		return;
 	}
 
 	connection->SetSocket(client);
+	connection->SetSocketOptions(options_);
 	if (ActivateConnection(connection)) {
+		u64 now = uv_hrtime();
+		lifecycle_->handshake.Record(now - start);
+		connection->TraceLifecycle(lifecycle_, now);
 		connection->CallOnConnected();
 	} else {
 		logger_->Error("ConnectCallback - %s:activate connecton error", *client.RemoteAddress().ToString());
@@ -97,4 +346,63 @@ void SocketConnector::ConnectCallback(i32 status, void * arg) {
 	}
 }
 
+void SocketConnector::ResolveCallback(i32 status, const std::vector<SocketAddress> & addresses, void * arg) {
+	--resolving_;
+	// Close()之前发起的解析
+	if (static_cast<u32>(reinterpret_cast<uintptr_t>(arg)) != generation_) {
+		status = UV_ECANCELED;
+	}
+
+	if (status < 0 || addresses.empty()) {
+		logger_->Error("ResolveCallback - %s(%d)", uv_strerror(status), status);
+		StartQueued();
+		CheckIdle();
+		OnConnectFailed();
+		return;
+	}
+
+	// 按解析顺序交替两个地址族
+	ConnectRace * race = new ConnectRace();
+	race->connector = this;
+	race->port = 0;
+	race->next = 0;
+	race->timer = nullptr;
+	race->start = uv_hrtime();
+	race->done = false;
+	std::vector<SocketAddress> primary, secondary;
+	for (auto & it : addresses) {
+		(it.AF() == addresses.front().AF() ? primary : secondary).push_back(it);
+	}
+	for (size_t i = 0; i < primary.size() || i < secondary.size(); ++i) {
+		if (i < primary.size()) {
+			race->addresses.push_back(primary[i]);
+		}
+		if (i < secondary.size()) {
+			race->addresses.push_back(secondary[i]);
+		}
+	}
+
+	if (!Enqueue(race)) {
+		CheckIdle();
+		OnConnectFailed();
+	}
+}
+
+void SocketConnector::timeout_cb(uv_timer_t * handle) {
+	ConnectAttempt * attempt = static_cast<ConnectAttempt *>(handle->data);
+	attempt->timed_out = true;
+	attempt->socket.Close();
+}
+
+void SocketConnector::fallback_cb(uv_timer_t * handle) {
+	ConnectRace * race = static_cast<ConnectRace *>(handle->data);
+	if (!race->done) {
+		race->connector->StartNext(race);
+	}
+}
+
+void SocketConnector::timer_close_cb(uv_handle_t * handle) {
+	BufferPool::DeAllocate(handle);
+}
+
 }
\ No newline at end of file
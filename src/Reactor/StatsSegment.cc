@@ -0,0 +1,367 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 jewmin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Reactor/StatsSegment.h"
+#include "Reactor/EventReactor.h"
+#include "Reactor/SocketAcceptor.h"
+#include "Reactor/SocketConnection.h"
+#include "Reactor/ConnectionPool.h"
+#include "Common/BufferPool.h"
+#include "Category.h"
+#include <algorithm>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Net {
+
+const u32 StatsSegment::kMagic;
+const u32 StatsSegment::kVersion;
+const i32 StatsSegment::kMaxAcceptors;
+const i32 StatsSegment::kMaxPools;
+const i32 StatsSegment::kMaxConnections;
+
+namespace {
+
+const i32 kReadRetries = 64;
+
+inline std::string ShmName(const std::string & name) {
+	return !name.empty() && '/' == name[0] ? name : "/" + name;
+}
+
+inline void CopyString(i8 * dest, size_t size, const std::string & src) {
+	size_t len = std::min(src.size(), size - 1);
+	std::memcpy(dest, src.c_str(), len);
+	dest[len] = 0;
+}
+
+}
+
+StatsSegment::StatsSegment(EventReactor * reactor) : reactor_(reactor), layout_(nullptr), interval_(1000), timer_(nullptr) {
+}
+
+StatsSegment::~StatsSegment() {
+	Close();
+	for (auto & it : acceptors_) {
+		it.first->Release();
+	}
+	for (auto & it : pools_) {
+		it.first->Release();
+	}
+	if (timer_) {
+		uv_close(reinterpret_cast<uv_handle_t *>(timer_), timer_close_cb);
+		timer_ = nullptr;
+	}
+}
+
+i32 StatsSegment::Open(const std::string & name, i32 interval) {
+#ifdef __linux__
+	if (layout_) {
+		return UV_EBUSY;
+	}
+	std::string path = ShmName(name);
+	i32 fd = shm_open(path.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		i32 status = uv_translate_sys_error(errno);
+		Logger::Category::GetCategory("StatsSegment")->Error("shm_open() - %s %s(%d)", path.c_str(), uv_strerror(status), status);
+		return status;
+	}
+	void * addr = MAP_FAILED;
+	if (0 == ftruncate(fd, sizeof(Layout))) {
+		addr = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	i32 status = MAP_FAILED == addr ? uv_translate_sys_error(errno) : 0;
+	close(fd);
+	if (status < 0) {
+		Logger::Category::GetCategory("StatsSegment")->Error("mmap() - %s %s(%d)", path.c_str(), uv_strerror(status), status);
+		shm_unlink(path.c_str());
+		return status;
+	}
+
+	layout_ = static_cast<Layout *>(addr);
+	std::memset(&layout_->data, 0, sizeof(layout_->data));
+	layout_->seq.store(0, std::memory_order_relaxed);
+	name_ = path;
+	interval_ = interval > 0 ? interval : 1000;
+	last_bytes_.clear();
+	Publish();
+
+	if (!timer_) {
+		timer_ = static_cast<uv_timer_t *>(BufferPool::Allocate(sizeof(uv_timer_t)));
+		uv_timer_init(reactor_->GetUvLoop(), timer_);
+		timer_->data = this;
+		uv_unref(reinterpret_cast<uv_handle_t *>(timer_));
+	}
+	uv_timer_start(timer_, timer_cb, interval_, interval_);
+	return 0;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+void StatsSegment::Close() {
+#ifdef __linux__
+	if (!layout_) {
+		return;
+	}
+	if (timer_) {
+		uv_timer_stop(timer_);
+	}
+	munmap(layout_, sizeof(Layout));
+	shm_unlink(name_.c_str());
+	layout_ = nullptr;
+	name_.clear();
+	last_bytes_.clear();
+#endif
+}
+
+bool StatsSegment::AddAcceptor(SocketAcceptor * acceptor, const std::string & label) {
+	if (static_cast<i32>(acceptors_.size()) >= kMaxAcceptors) {
+		return false;
+	}
+	for (auto & it : acceptors_) {
+		if (it.first == acceptor) {
+			return false;
+		}
+	}
+	acceptor->Duplicate();
+	acceptors_.push_back(std::make_pair(acceptor, label));
+	return true;
+}
+
+void StatsSegment::RemoveAcceptor(SocketAcceptor * acceptor) {
+	for (auto it = acceptors_.begin(); it != acceptors_.end(); ++it) {
+		if (it->first == acceptor) {
+			acceptors_.erase(it);
+			acceptor->Release();
+			return;
+		}
+	}
+}
+
+bool StatsSegment::AddPool(ConnectionPool * pool, const std::string & label) {
+	if (static_cast<i32>(pools_.size()) >= kMaxPools) {
+		return false;
+	}
+	for (auto & it : pools_) {
+		if (it.first == pool) {
+			return false;
+		}
+	}
+	pool->Duplicate();
+	pools_.push_back(std::make_pair(pool, label));
+	return true;
+}
+
+void StatsSegment::RemovePool(ConnectionPool * pool) {
+	for (auto it = pools_.begin(); it != pools_.end(); ++it) {
+		if (it->first == pool) {
+			pools_.erase(it);
+			pool->Release();
+			return;
+		}
+	}
+}
+
+void StatsSegment::Publish() {
+	if (!layout_) {
+		return;
+	}
+	// 先在本地填好, 持有写锁的时间只有一次内存复制
+	Data data;
+	Fill(data);
+	u64 seq = layout_->seq.load(std::memory_order_relaxed);
+	layout_->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(&layout_->data, &data, sizeof(data));
+	layout_->seq.store(seq + 2, std::memory_order_release);
+}
+
+void StatsSegment::Fill(Data & data) {
+	std::memset(&data, 0, sizeof(data));
+	data.magic = kMagic;
+	data.version = kVersion;
+	data.pid = uv_os_getpid();
+	data.interval = interval_;
+	data.time = uv_hrtime();
+	data.publishes = layout_->data.publishes + 1;
+
+	LoopStats::Snapshot loop = reactor_->GetStats();
+	ReactorRecord & reactor = data.reactor;
+	reactor.iterations = loop.iterations;
+	reactor.iteration_p50 = loop.iteration.Percentile(50);
+	reactor.iteration_p99 = loop.iteration.Percentile(99);
+	reactor.iteration_max = loop.iteration.Max();
+	reactor.blocked_p50 = loop.blocked.Percentile(50);
+	reactor.busy_p99 = loop.busy.Percentile(99);
+	reactor.write_latency_p99 = loop.write_latency.Percentile(99);
+	BufferPool::ClassStats pool;
+	for (i32 i = 0; i < BufferPool::GetClassCount(); ++i) {
+		if (BufferPool::GetClassStats(i, pool)) {
+			reactor.pool_bytes += pool.in_use * pool.block_size;
+		}
+	}
+
+	for (auto & it : acceptors_) {
+		AcceptorRecord & record = data.acceptors[data.acceptor_count++];
+		SocketAcceptor::AcceptStats stats = it.first->GetAcceptStats();
+		CopyString(record.label, sizeof(record.label), it.second);
+		CopyString(record.address, sizeof(record.address), *it.first->GetListenAddress().ToString());
+		record.accepted = stats.accepted;
+		record.rejected = stats.rejected;
+		record.rate_limited = stats.rate_limited;
+		record.over_limit = stats.over_limit;
+		record.errors = stats.errors;
+		record.exhausted = stats.exhausted;
+		record.shed = stats.shed;
+		record.pauses = stats.pauses;
+		record.paused = stats.paused ? 1 : 0;
+	}
+
+	for (auto & it : pools_) {
+		PoolRecord & record = data.pools[data.pool_count++];
+		CopyString(record.label, sizeof(record.label), it.second);
+		CopyString(record.address, sizeof(record.address), *it.first->GetAddress().ToString());
+		record.idle = it.first->GetIdleCount();
+		record.leased = it.first->GetLeasedCount();
+		record.connecting = it.first->GetConnectingCount();
+		record.failures = it.first->GetFailures();
+	}
+
+	// 按距上次刷新的收发字节数选出前kMaxConnections个连接
+	const std::vector<SocketConnection *> & connections = reactor_->GetConnections();
+	std::vector<std::pair<i64, SocketConnection *>> ranked;
+	ranked.reserve(connections.size());
+	std::unordered_map<SocketConnection *, i64> last_bytes;
+	last_bytes.reserve(connections.size());
+	for (auto & it : connections) {
+		const SocketConnection::TrafficStats & traffic = it->GetTrafficStats();
+		i64 bytes = traffic.bytes_in + traffic.bytes_out;
+		// 连接对象重新建立后统计清零, 比上次小说明是新的连接, 全部算作本次的增量
+		auto last = last_bytes_.find(it);
+		ranked.push_back(std::make_pair(last != last_bytes_.end() && bytes >= last->second ? bytes - last->second : bytes, it));
+		last_bytes[it] = bytes;
+
+		i32 out_buffered = it->GetOutBufferSize();
+		++reactor.connections;
+		reactor.bytes_in += traffic.bytes_in;
+		reactor.bytes_out += traffic.bytes_out;
+		reactor.out_buffered += out_buffered;
+		reactor.in_buffered += it->GetInBufferSize();
+		reactor.write_queue += it->GetSocket()->GetWriteQueueSize();
+		if (static_cast<i64>(out_buffered) * 4 > static_cast<i64>(it->GetMaxOutBufferSize()) * 3) {
+			++reactor.saturated;
+		}
+	}
+	last_bytes_.swap(last_bytes);
+
+	size_t top = std::min(ranked.size(), static_cast<size_t>(kMaxConnections));
+	std::partial_sort(ranked.begin(), ranked.begin() + top, ranked.end(),
+		[](const std::pair<i64, SocketConnection *> & a, const std::pair<i64, SocketConnection *> & b) { return a.first > b.first; });
+	for (size_t i = 0; i < top; ++i) {
+		SocketConnection * connection = ranked[i].second;
+		const SocketConnection::TrafficStats & traffic = connection->GetTrafficStats();
+		ConnectionRecord & record = data.connections[data.connection_count++];
+		record.id = static_cast<u64>(reinterpret_cast<uintptr_t>(connection));
+		CopyString(record.peer, sizeof(record.peer), *connection->GetRemoteAddress().ToString());
+		record.bytes_in = traffic.bytes_in;
+		record.bytes_out = traffic.bytes_out;
+		record.bytes_delta = ranked[i].first;
+		record.out_buffered = connection->GetOutBufferSize();
+		record.out_capacity = connection->GetMaxOutBufferSize();
+		record.in_buffered = connection->GetInBufferSize();
+		record.write_queue = connection->GetSocket()->GetWriteQueueSize();
+		record.rtt = connection->GetTcpInfo().rtt;
+		record.read_idle = connection->GetReadIdleTime();
+		record.write_idle = connection->GetWriteIdleTime();
+	}
+}
+
+const StatsSegment::Layout * StatsSegment::Attach(const std::string & name) {
+#ifdef __linux__
+	i32 fd = shm_open(ShmName(name).c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	void * addr = MAP_FAILED;
+	if (0 == fstat(fd, &st) && st.st_size >= static_cast<off_t>(sizeof(Layout))) {
+		addr = mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (MAP_FAILED == addr) {
+		return nullptr;
+	}
+	const Layout * layout = static_cast<const Layout *>(addr);
+	Data data;
+	if (!Read(layout, data) || kMagic != data.magic || kVersion != data.version) {
+		munmap(addr, sizeof(Layout));
+		return nullptr;
+	}
+	return layout;
+#else
+	return nullptr;
+#endif
+}
+
+void StatsSegment::Detach(const Layout * layout) {
+#ifdef __linux__
+	if (layout) {
+		munmap(const_cast<Layout *>(layout), sizeof(Layout));
+	}
+#endif
+}
+
+bool StatsSegment::Read(const Layout * layout, Data & data) {
+	for (i32 i = 0; i < kReadRetries; ++i) {
+		u64 seq = layout->seq.load(std::memory_order_acquire);
+		if (seq & 1) {
+			continue;
+		}
+		std::memcpy(&data, &layout->data, sizeof(data));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (layout->seq.load(std::memory_order_relaxed) == seq) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//*********************************************************************
+//Callback
+//*********************************************************************
+
+void StatsSegment::timer_cb(uv_timer_t * handle) {
+	StatsSegment * segment = static_cast<StatsSegment *>(handle->data);
+	segment->Publish();
+}
+
+void StatsSegment::timer_close_cb(uv_handle_t * handle) {
+	BufferPool::DeAllocate(handle);
+}
+
+}
\ No newline at end of file
@@ -23,13 +23,78 @@
  */
 
 #include "Sockets/ServerSocketImpl.h"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace Net {
 
-ServerSocketImpl::ServerSocketImpl() {
+ServerSocketImpl::ServerSocketImpl() : spare_(-1) {
 }
 
 ServerSocketImpl::~ServerSocketImpl() {
+	Close();
+}
+
+void ServerSocketImpl::Close() {
+#ifndef _WIN32
+	if (spare_ >= 0) {
+		close(spare_);
+		spare_ = -1;
+	}
+#endif
+	SocketImpl::Close();
+}
+
+i32 ServerSocketImpl::ReserveDescriptor() {
+#ifndef _WIN32
+	if (spare_ < 0) {
+		// 与libuv一致, chroot等环境下没有/dev/null时退而打开根目录
+		spare_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		if (spare_ < 0) {
+			spare_ = open("/", O_RDONLY | O_CLOEXEC);
+		}
+		if (spare_ < 0) {
+			return uv_translate_sys_error(errno);
+		}
+	}
+	return 0;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 ServerSocketImpl::ShedPending() {
+#ifndef _WIN32
+	uv_os_fd_t fd;
+	if (!handle_ || UV_TCP != handle_->type || uv_fileno(handle_, &fd) < 0) {
+		return UV_EBADF;
+	}
+	if (spare_ >= 0) {
+		close(spare_);
+		spare_ = -1;
+	}
+	// 监听套接字是非阻塞的, 取完等待队列后返回EAGAIN
+	i32 count = 0;
+	for (;;) {
+		i32 client = accept(fd, nullptr, nullptr);
+		if (client >= 0) {
+			close(client);
+			++count;
+		} else if (EINTR != errno && ECONNABORTED != errno) {
+			break;
+		}
+	}
+	i32 status = ReserveDescriptor();
+	if (0 == count && status < 0) {
+		return status;
+	}
+	return count;
+#else
+	return UV_ENOTSUP;
+#endif
 }
 
 }
\ No newline at end of file
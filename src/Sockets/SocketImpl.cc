@@ -25,26 +25,72 @@
 #include "Sockets/SocketImpl.h"
 #include "Sockets/StreamSocketImpl.h"
 #include "Allocator.h"
+#include "Common/BufferPool.h"
+#include "Common/LoopStats.h"
+#include "Common/Probes.h"
 #include "NetworkException.h"
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+#ifdef __linux__
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#endif
 
 namespace Net {
 
-SocketImpl::SocketImpl() : handle_(nullptr), logger_(Logger::Category::GetCategory("SocketImpl")) {
+const i64 SocketImpl::kFileChunk;
+
+struct SocketImpl::FileRequest {
+	uv_poll_t poll;
+	SocketImpl * impl;
+	Common::WeakReference * reference;
+	void * arg;
+	uv_os_fd_t sock;
+	uv_file file;
+	i8 * memory;
+	i64 offset;
+	i64 length;
+	i64 transferred;
+	i32 status;
+	bool receive;
+	bool done;
+	// 接收文件时socket -> pipe -> file, 文件不支持splice时记住并改为从pipe读出后写入
+	i32 pipefd[2];
+	bool splice_file;
+};
+
+SocketImpl::SocketImpl() : handle_(nullptr), logger_(Logger::Category::GetCategory("SocketImpl")), sendfile_(nullptr), recvfile_(nullptr) {
 }
 
 SocketImpl::~SocketImpl() {
 	Close();
 }
 
-void SocketImpl::Open(uv_loop_t * loop) {
+void SocketImpl::Open(uv_loop_t * loop, i32 family) {
 	if (!handle_) {
-		handle_ = static_cast<uv_handle_t *>(jc_malloc(sizeof(uv_tcp_t)));
-		uv_tcp_init(loop, reinterpret_cast<uv_tcp_t *>(handle_));
+		handle_ = static_cast<uv_handle_t *>(BufferPool::Allocate(sizeof(uv_tcp_t)));
+		i32 status = uv_tcp_init_ex(loop, reinterpret_cast<uv_tcp_t *>(handle_), static_cast<u32>(family));
+		if (status < 0) {
+			logger_->Error("uv_tcp_init_ex() - %s(%d)", uv_strerror(status), status);
+			uv_tcp_init(loop, reinterpret_cast<uv_tcp_t *>(handle_));
+		}
 		handle_->data = nullptr;
 	}
 }
 
 void SocketImpl::Close() {
+	if (sendfile_ && !sendfile_->done) {
+		FinishFileRequest(sendfile_, UV_ECANCELED);
+	}
+	if (recvfile_ && !recvfile_->done) {
+		FinishFileRequest(recvfile_, UV_ECANCELED);
+	}
 	if (handle_) {
 		if (!uv_is_closing(handle_)) {
 			uv_close(handle_, close_cb);
@@ -84,10 +130,10 @@ i32 SocketImpl::Listen(i32 backlog) {
 i32 SocketImpl::Connect(const SocketAddress & address, void * arg) {
 	i32 status = UV_UNKNOWN;
 	if (handle_ && UV_TCP == handle_->type) {
-		uv_connect_t * req = static_cast<uv_connect_t *>(jc_malloc(sizeof(uv_connect_t)));
+		uv_connect_t * req = static_cast<uv_connect_t *>(BufferPool::Allocate(sizeof(uv_connect_t)));
 		status = uv_tcp_connect(req, reinterpret_cast<uv_tcp_t *>(handle_), address.Addr(), connect_cb);
 		if (status < 0) {
-			jc_free(req);
+			BufferPool::DeAllocate(req);
 			logger_->Error("uv_tcp_connect() - %s:%s(%d)", *address.ToString(), uv_strerror(status), status);
 			Close();
 		} else {
@@ -124,10 +170,10 @@ i32 SocketImpl::Shutdown(void * arg) {
 i32 SocketImpl::ShutdownWrite(void * arg) {
 	i32 status = UV_UNKNOWN;
 	if (handle_ && UV_TCP == handle_->type) {
-		uv_shutdown_t * req = static_cast<uv_shutdown_t *>(jc_malloc(sizeof(uv_shutdown_t)));
+		uv_shutdown_t * req = static_cast<uv_shutdown_t *>(BufferPool::Allocate(sizeof(uv_shutdown_t)));
 		status = uv_shutdown(req, reinterpret_cast<uv_stream_t *>(handle_), shutdown_cb);
 		if (status < 0) {
-			jc_free(req);
+			BufferPool::DeAllocate(req);
 			logger_->Error("uv_shutdown() - %s:%s(%d)", *LocalAddress().ToString(), uv_strerror(status), status);
 		} else {
 			req->data = arg;
@@ -163,10 +209,10 @@ i32 SocketImpl::Write(const i8 * data, i32 len, void * arg) {
 		return UV_ENOBUFS;
 	}
 	uv_buf_t buf = uv_buf_init(const_cast<i8 *>(data), len);
-	uv_write_t * req = static_cast<uv_write_t *>(jc_malloc(sizeof(uv_write_t)));
+	uv_write_t * req = static_cast<uv_write_t *>(BufferPool::Allocate(sizeof(uv_write_t)));
 	i32 status = uv_write(req, reinterpret_cast<uv_stream_t *>(handle_), &buf, 1, write_cb);
 	if (status < 0) {
-		jc_free(req);
+		BufferPool::DeAllocate(req);
 		logger_->Error("uv_write() - %s:%s(%d)", *LocalAddress().ToString(), uv_strerror(status), status);
 		return status;
 	} else {
@@ -175,6 +221,206 @@ i32 SocketImpl::Write(const i8 * data, i32 len, void * arg) {
 	return len;
 }
 
+i32 SocketImpl::WriteZeroCopy(const i8 * data, i32 len) {
+#if defined(__linux__) && defined(MSG_ZEROCOPY)
+	if (!handle_ || UV_TCP != handle_->type) {
+		return UV_EPROTONOSUPPORT;
+	}
+	if (!data || len <= 0) {
+		return UV_ENOBUFS;
+	}
+	// 保证字节序, 之前的数据必须已全部交给内核
+	if (GetWriteQueueSize() > 0) {
+		return UV_EAGAIN;
+	}
+	uv_os_fd_t fd;
+	i32 status = uv_fileno(handle_, &fd);
+	if (status < 0) {
+		return status;
+	}
+	ssize_t n;
+	do {
+		n = send(fd, data, len, MSG_ZEROCOPY | MSG_DONTWAIT | MSG_NOSIGNAL);
+	} while (n < 0 && EINTR == errno);
+	if (n < 0) {
+		return (EAGAIN == errno || EWOULDBLOCK == errno) ? UV_EAGAIN : uv_translate_sys_error(errno);
+	}
+	return static_cast<i32>(n);
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::ReapZeroCopy(i32 * copied) {
+	i32 done = 0;
+#if defined(__linux__) && defined(SO_EE_ORIGIN_ZEROCOPY)
+	uv_os_fd_t fd;
+	if (!handle_ || UV_TCP != handle_->type || uv_fileno(handle_, &fd) < 0) {
+		return done;
+	}
+	for (;;) {
+		i8 control[128];
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			break;
+		}
+		for (struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if ((IPPROTO_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) || (IPPROTO_IPV6 == cmsg->cmsg_level && IPV6_RECVERR == cmsg->cmsg_type)) {
+				struct sock_extended_err * err = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cmsg));
+				if (SO_EE_ORIGIN_ZEROCOPY == err->ee_origin && 0 == err->ee_errno) {
+					// [ee_info, ee_data]区间内的发送已完成
+					i32 count = static_cast<i32>(err->ee_data - err->ee_info + 1);
+					done += count;
+					if (copied && (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)) {
+						*copied += count;
+					}
+				}
+			}
+		}
+	}
+#endif
+	return done;
+}
+
+i32 SocketImpl::SendFile(uv_file file, i64 offset, i64 length, void * arg) {
+	if (!handle_ || UV_TCP != handle_->type) {
+		return UV_EPROTONOSUPPORT;
+	}
+	if (file < 0 || offset < 0 || length <= 0) {
+		return UV_EINVAL;
+	}
+	if (sendfile_) {
+		return UV_EBUSY;
+	}
+	if (GetWriteQueueSize() > 0) {
+		return UV_EAGAIN;
+	}
+	return WatchFileRequest(false, file, nullptr, offset, length, arg);
+}
+
+i32 SocketImpl::ReceiveFile(uv_file file, i64 offset, i64 length, void * arg) {
+	if (!handle_ || UV_TCP != handle_->type) {
+		return UV_EPROTONOSUPPORT;
+	}
+	if (file < 0 || length <= 0) {
+		return UV_EINVAL;
+	}
+	if (recvfile_) {
+		return UV_EBUSY;
+	}
+	return WatchFileRequest(true, file, nullptr, offset, length, arg);
+}
+
+i32 SocketImpl::ReceiveMemory(i8 * data, i64 length, void * arg) {
+	if (!handle_ || UV_TCP != handle_->type) {
+		return UV_EPROTONOSUPPORT;
+	}
+	if (!data || length <= 0) {
+		return UV_EINVAL;
+	}
+	if (recvfile_) {
+		return UV_EBUSY;
+	}
+	return WatchFileRequest(true, -1, data, -1, length, arg);
+}
+
+i32 SocketImpl::WatchFileRequest(bool receive, uv_file file, i8 * memory, i64 offset, i64 length, void * arg) {
+#ifdef __linux__
+	uv_os_fd_t fd;
+	i32 status = uv_fileno(handle_, &fd);
+	if (status < 0) {
+		return status;
+	}
+	// 同一描述符只能有一个libuv观察者, 复制一个由uv_poll_t监听, 不影响tcp句柄的读写
+	uv_os_fd_t sock = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (sock < 0) {
+		status = uv_translate_sys_error(errno);
+		logger_->Error("fcntl() F_DUPFD_CLOEXEC - %s(%d)", uv_strerror(status), status);
+		return status;
+	}
+
+	FileRequest * request = new FileRequest();
+	request->poll.data = request;
+	request->impl = this;
+	request->reference = nullptr;
+	request->arg = arg;
+	request->sock = sock;
+	request->file = file;
+	request->memory = memory;
+	request->offset = offset;
+	request->length = length;
+	request->transferred = 0;
+	request->status = 0;
+	request->receive = receive;
+	request->done = false;
+	request->pipefd[0] = request->pipefd[1] = -1;
+	request->splice_file = true;
+	if (receive && !memory && pipe2(request->pipefd, O_CLOEXEC | O_NONBLOCK) < 0) {
+		// 没有pipe时用recv接收
+		request->pipefd[0] = request->pipefd[1] = -1;
+	}
+	status = uv_poll_init(handle_->loop, &request->poll, sock);
+	if (status < 0) {
+		logger_->Error("uv_poll_init() - %s:%s(%d)", *LocalAddress().ToString(), uv_strerror(status), status);
+		ClosePipe(request);
+		close(sock);
+		delete request;
+		return status;
+	}
+	status = uv_poll_start(&request->poll, receive ? UV_READABLE : UV_WRITABLE, file_poll_cb);
+	if (status < 0) {
+		logger_->Error("uv_poll_start() - %s:%s(%d)", *LocalAddress().ToString(), uv_strerror(status), status);
+		// 关闭回调中释放, 没有关联的套接字和UvData, 不会回调
+		request->impl = nullptr;
+		FinishFileRequest(request, status);
+		return status;
+	}
+
+	Common::WeakReference * reference = static_cast<Common::WeakReference *>(handle_->data);
+	if (reference) {
+		UvData * data = dynamic_cast<UvData *>(reference->Lock());
+		if (data) {
+			request->reference = data->IncWeakRef();
+			data->Release();
+		}
+	}
+	Duplicate();
+	if (receive) {
+		// 接收期间由uv_poll_t读取套接字
+		uv_read_stop(reinterpret_cast<uv_stream_t *>(handle_));
+		recvfile_ = request;
+	} else {
+		sendfile_ = request;
+	}
+	return 0;
+#else
+	return UV_ENOSYS;
+#endif
+}
+
+void SocketImpl::ClosePipe(FileRequest * request) {
+#ifdef __linux__
+	if (request->pipefd[0] >= 0) {
+		close(request->pipefd[0]);
+		close(request->pipefd[1]);
+		request->pipefd[0] = request->pipefd[1] = -1;
+	}
+#endif
+}
+
+void SocketImpl::FinishFileRequest(FileRequest * request, i32 status) {
+	// 关闭回调中通知结果, 与Close()取消时一样异步
+	request->done = true;
+	request->status = status;
+	uv_close(reinterpret_cast<uv_handle_t *>(&request->poll), file_close_cb);
+}
+
 void SocketImpl::SetSendBufferSize(i32 size) {
 	if (handle_) {
 		i32 status = uv_send_buffer_size(handle_, &size);
@@ -273,6 +519,195 @@ void SocketImpl::SetKeepAlive(i32 interval) {
 	}
 }
 
+i32 SocketImpl::SetBusyPoll(i32 usec) {
+#ifdef SO_BUSY_POLL
+	i32 status = SetOption(SOL_SOCKET, SO_BUSY_POLL, usec);
+	if (status < 0) {
+		logger_->Error("setsockopt() SO_BUSY_POLL - %s(%d)", uv_strerror(status), status);
+		return status;
+	}
+#ifdef SO_PREFER_BUSY_POLL
+	i32 prefer_status = SetOption(SOL_SOCKET, SO_PREFER_BUSY_POLL, usec > 0 ? 1 : 0);
+	if (prefer_status < 0) {
+		logger_->Error("setsockopt() SO_PREFER_BUSY_POLL - %s(%d)", uv_strerror(prefer_status), prefer_status);
+	}
+#endif
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetZeroCopy(bool enable) {
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+	i32 status = SetOption(SOL_SOCKET, SO_ZEROCOPY, enable ? 1 : 0);
+	if (status < 0) {
+		logger_->Error("setsockopt() SO_ZEROCOPY - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetNotSentLowat(i32 bytes) {
+#ifdef TCP_NOTSENT_LOWAT
+	i32 status = SetOption(IPPROTO_TCP, TCP_NOTSENT_LOWAT, bytes);
+	if (status < 0) {
+		logger_->Error("setsockopt() TCP_NOTSENT_LOWAT - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetQuickAck(bool enable) {
+#ifdef TCP_QUICKACK
+	i32 status = SetOption(IPPROTO_TCP, TCP_QUICKACK, enable ? 1 : 0);
+	if (status < 0) {
+		logger_->Error("setsockopt() TCP_QUICKACK - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetCork(bool enable) {
+#if defined(TCP_CORK)
+	i32 status = SetOption(IPPROTO_TCP, TCP_CORK, enable ? 1 : 0);
+#elif defined(TCP_NOPUSH)
+	i32 status = SetOption(IPPROTO_TCP, TCP_NOPUSH, enable ? 1 : 0);
+#else
+	i32 status = UV_ENOTSUP;
+#endif
+	if (status < 0 && UV_ENOTSUP != status) {
+		logger_->Error("setsockopt() TCP_CORK - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+}
+
+i32 SocketImpl::SetFastOpen(i32 queue_length) {
+#ifdef TCP_FASTOPEN
+	i32 status = SetOption(IPPROTO_TCP, TCP_FASTOPEN, queue_length);
+	if (status < 0) {
+		logger_->Error("setsockopt() TCP_FASTOPEN - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetFastOpenConnect(bool enable) {
+#ifdef TCP_FASTOPEN_CONNECT
+	i32 status = SetOption(IPPROTO_TCP, TCP_FASTOPEN_CONNECT, enable ? 1 : 0);
+	if (status < 0) {
+		logger_->Error("setsockopt() TCP_FASTOPEN_CONNECT - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetMaxPacingRate(u32 bytes_per_second) {
+#ifdef SO_MAX_PACING_RATE
+	i32 status = SetOption(SOL_SOCKET, SO_MAX_PACING_RATE, static_cast<i32>(bytes_per_second));
+	if (status < 0) {
+		logger_->Error("setsockopt() SO_MAX_PACING_RATE - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetUserTimeout(i32 msec) {
+#ifdef TCP_USER_TIMEOUT
+	i32 status = SetOption(IPPROTO_TCP, TCP_USER_TIMEOUT, msec);
+	if (status < 0) {
+		logger_->Error("setsockopt() TCP_USER_TIMEOUT - %s(%d)", uv_strerror(status), status);
+	}
+	return status;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetOptions(const SocketOptions & options) {
+	i32 result = 0;
+	i32 status = 0;
+	if (options.send_buffer_size > 0) {
+		SetSendBufferSize(options.send_buffer_size);
+	}
+	if (options.recv_buffer_size > 0) {
+		SetRecvBufferSize(options.recv_buffer_size);
+	}
+	if (options.not_sent_lowat >= 0 && (status = SetNotSentLowat(options.not_sent_lowat)) < 0 && 0 == result) {
+		result = status;
+	}
+	if (options.user_timeout >= 0 && (status = SetUserTimeout(options.user_timeout)) < 0 && 0 == result) {
+		result = status;
+	}
+	if (options.max_pacing_rate > 0 && (status = SetMaxPacingRate(options.max_pacing_rate)) < 0 && 0 == result) {
+		result = status;
+	}
+	if (options.quick_ack && (status = SetQuickAck(true)) < 0 && 0 == result) {
+		result = status;
+	}
+	return result;
+}
+
+i32 SocketImpl::GetTcpInfo(TcpInfo & info) const {
+#if defined(__linux__) && defined(TCP_INFO)
+	uv_os_fd_t fd;
+	if (!handle_ || UV_TCP != handle_->type || uv_fileno(handle_, &fd) < 0) {
+		return UV_EBADF;
+	}
+	struct tcp_info ti;
+	socklen_t len = sizeof(ti);
+	std::memset(&ti, 0, sizeof(ti));
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0) {
+		return uv_translate_sys_error(errno);
+	}
+	info.rtt = ti.tcpi_rtt;
+	info.rttvar = ti.tcpi_rttvar;
+	info.retransmits = ti.tcpi_total_retrans;
+	info.snd_cwnd = ti.tcpi_snd_cwnd;
+	i32 outq = 0, notsent = 0;
+	if (ioctl(fd, SIOCOUTQ, &outq) < 0 || ioctl(fd, SIOCOUTQNSD, &notsent) < 0) {
+		outq = notsent = 0;
+	}
+	info.notsent = static_cast<u32>(notsent);
+	info.unacked = outq > notsent ? static_cast<u32>(outq - notsent) : 0;
+	return 0;
+#else
+	return UV_ENOTSUP;
+#endif
+}
+
+i32 SocketImpl::SetOption(i32 level, i32 option, i32 value) {
+	uv_os_fd_t fd;
+	i32 status = UV_EBADF;
+	if (handle_ && UV_TCP == handle_->type) {
+		status = uv_fileno(handle_, &fd);
+		if (0 == status) {
+#ifdef _WIN32
+			if (SOCKET_ERROR == setsockopt(reinterpret_cast<SOCKET>(fd), level, option, reinterpret_cast<const char *>(&value), sizeof(value))) {
+				status = uv_translate_sys_error(WSAGetLastError());
+			}
+#else
+			if (setsockopt(fd, level, option, &value, sizeof(value)) < 0) {
+				status = uv_translate_sys_error(errno);
+			}
+#endif
+		}
+	}
+	return status;
+}
+
 void SocketImpl::SetUvData(UvData * data) {
 	if (handle_) {
 		if (handle_->data) {
@@ -282,15 +717,161 @@ void SocketImpl::SetUvData(UvData * data) {
 	}
 }
 
+void SocketImpl::SendFileStep(FileRequest * request) {
+#ifdef __linux__
+	// 每次可写最多发送kFileChunk字节, 剩余的等下一轮事件循环, 不长时间占用事件循环
+	off_t offset = static_cast<off_t>(request->offset + request->transferred);
+	i64 budget = kFileChunk;
+	while (request->transferred < request->length && budget > 0) {
+		i64 remaining = request->length - request->transferred;
+		ssize_t n = sendfile(request->sock, request->file, &offset, static_cast<size_t>(remaining < budget ? remaining : budget));
+		if (n > 0) {
+			request->transferred += n;
+			budget -= n;
+		} else if (0 == n) {
+			// 文件已读完
+			FinishFileRequest(request, 0);
+			return;
+		} else if (EAGAIN == errno || EWOULDBLOCK == errno) {
+			return;
+		} else if (EINTR != errno) {
+			FinishFileRequest(request, uv_translate_sys_error(errno));
+			return;
+		}
+	}
+	if (request->transferred >= request->length) {
+		FinishFileRequest(request, 0);
+	}
+#endif
+}
+
+i32 SocketImpl::WriteFile(FileRequest * request, const i8 * data, i64 size) {
+#ifdef __linux__
+	// 文件是阻塞的, 写入页缓存通常很快
+	i64 written = 0;
+	while (written < size) {
+		ssize_t m;
+		if (request->offset >= 0) {
+			m = pwrite(request->file, data + written, static_cast<size_t>(size - written), static_cast<off_t>(request->offset + request->transferred + written));
+		} else {
+			m = write(request->file, data + written, static_cast<size_t>(size - written));
+		}
+		if (m < 0 && EINTR == errno) {
+			continue;
+		}
+		if (m <= 0) {
+			return m < 0 ? uv_translate_sys_error(errno) : UV_EIO;
+		}
+		written += m;
+	}
+	return 0;
+#else
+	return UV_ENOSYS;
+#endif
+}
+
+i32 SocketImpl::DrainPipe(FileRequest * request, i64 size, i8 * buf, i64 buf_size) {
+#ifdef __linux__
+	i64 drained = 0;
+	while (drained < size) {
+		i64 left = size - drained;
+		if (request->splice_file) {
+			off_t offset = static_cast<off_t>(request->offset + request->transferred + drained);
+			ssize_t m = splice(request->pipefd[0], nullptr, request->file, request->offset >= 0 ? &offset : nullptr, static_cast<size_t>(left), SPLICE_F_MOVE);
+			if (m > 0) {
+				drained += m;
+				continue;
+			} else if (m < 0 && EINTR == errno) {
+				continue;
+			} else if (m < 0 && EINVAL == errno) {
+				// 文件不支持splice, 本次接收的后续数据都从pipe读出后写入
+				request->splice_file = false;
+			} else {
+				return m < 0 ? uv_translate_sys_error(errno) : UV_EIO;
+			}
+		}
+		ssize_t n = read(request->pipefd[0], buf, static_cast<size_t>(left < buf_size ? left : buf_size));
+		if (n < 0 && EINTR == errno) {
+			continue;
+		}
+		if (n <= 0) {
+			return n < 0 ? uv_translate_sys_error(errno) : UV_EIO;
+		}
+		i32 status = WriteFile(request, buf, n);
+		if (status < 0) {
+			return status;
+		}
+		drained += n;
+	}
+	return 0;
+#else
+	return UV_ENOSYS;
+#endif
+}
+
+void SocketImpl::ReceiveStep(FileRequest * request) {
+#ifdef __linux__
+	// 每次可读最多接收kFileChunk字节, 剩余的等下一轮事件循环
+	i8 buf[16 * 1024];
+	i64 budget = kFileChunk;
+	while (request->transferred < request->length && budget > 0) {
+		i64 remaining = request->length - request->transferred;
+		if (remaining > budget) {
+			remaining = budget;
+		}
+		ssize_t n;
+		if (request->memory) {
+			n = recv(request->sock, request->memory + request->transferred, static_cast<size_t>(remaining), MSG_DONTWAIT);
+		} else if (request->pipefd[0] >= 0) {
+			// socket -> pipe, 数据不经过用户态
+			n = splice(request->sock, nullptr, request->pipefd[1], nullptr, static_cast<size_t>(remaining), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (n < 0 && EINVAL == errno) {
+				ClosePipe(request);
+				continue;
+			}
+		} else {
+			n = recv(request->sock, buf, static_cast<size_t>(remaining < static_cast<i64>(sizeof(buf)) ? remaining : sizeof(buf)), MSG_DONTWAIT);
+		}
+		if (0 == n) {
+			FinishFileRequest(request, UV_EOF);
+			return;
+		} else if (n < 0) {
+			if (EAGAIN == errno || EWOULDBLOCK == errno) {
+				return;
+			} else if (EINTR != errno) {
+				FinishFileRequest(request, uv_translate_sys_error(errno));
+				return;
+			}
+			continue;
+		}
+
+		if (!request->memory) {
+			i32 status = request->pipefd[0] >= 0 ? DrainPipe(request, n, buf, sizeof(buf)) : WriteFile(request, buf, n);
+			if (status < 0) {
+				FinishFileRequest(request, status);
+				return;
+			}
+		}
+		request->transferred += n;
+		budget -= n;
+	}
+	if (request->transferred >= request->length) {
+		FinishFileRequest(request, 0);
+	}
+#endif
+}
+
 //*********************************************************************
 //Callback
 //*********************************************************************
 
 void SocketImpl::close_cb(uv_handle_t * handle) {
+	LoopStats::CallbackTimer timer(LoopStats::kClose);
 	Common::WeakReference * reference = static_cast<Common::WeakReference *>(handle->data);
 	if (reference) {
 		UvData * data = dynamic_cast<UvData *>(reference->Lock());
 		if (data) {
+			NET_PROBE1(close, data);
 			data->CloseCallback();
 			data->Release();
 		} else {
@@ -299,13 +880,14 @@ void SocketImpl::close_cb(uv_handle_t * handle) {
 		reference->Release();
 	}
 	if (UV_TCP == handle->type) {
-		jc_free(handle);
+		BufferPool::DeAllocate(handle);
 	} else {
 		throw NetworkException(*Common::SDString::Format("close_cb() free specified handle [%s] error", uv_handle_type_name(handle->type)));
 	}
 }
 
 void SocketImpl::connection_cb(uv_stream_t * server, int status) {
+	LoopStats::CallbackTimer timer(LoopStats::kAccept);
 	Common::WeakReference * reference = static_cast<Common::WeakReference *>(server->data);
 	if (reference) {
 		UvData * data = dynamic_cast<UvData *>(reference->Lock());
@@ -319,17 +901,19 @@ void SocketImpl::connection_cb(uv_stream_t * server, int status) {
 }
 
 void SocketImpl::connect_cb(uv_connect_t * req, int status) {
+	LoopStats::CallbackTimer timer(LoopStats::kConnect);
 	Common::WeakReference * reference = static_cast<Common::WeakReference *>(req->handle->data);
 	if (reference) {
 		UvData * data = dynamic_cast<UvData *>(reference->Lock());
 		if (data) {
+			NET_PROBE2(connect, data, status);
 			data->ConnectCallback(status, req->data);
 			data->Release();
 		} else {
 			Logger::Category::GetCategory("SocketImpl")->Warn("connect_cb() UvData has been released");
 		}
 	}
-	jc_free(req);
+	BufferPool::DeAllocate(req);
 }
 
 void SocketImpl::shutdown_cb(uv_shutdown_t * req, int status) {
@@ -343,7 +927,7 @@ void SocketImpl::shutdown_cb(uv_shutdown_t * req, int status) {
 			Logger::Category::GetCategory("SocketImpl")->Warn("shutdown_cb() UvData has been released");
 		}
 	}
-	jc_free(req);
+	BufferPool::DeAllocate(req);
 }
 
 void SocketImpl::alloc_cb(uv_handle_t * handle, size_t suggested_size, uv_buf_t * buf) {
@@ -360,10 +944,12 @@ void SocketImpl::alloc_cb(uv_handle_t * handle, size_t suggested_size, uv_buf_t
 }
 
 void SocketImpl::read_cb(uv_stream_t * stream, ssize_t nread, const uv_buf_t * buf) {
+	LoopStats::CallbackTimer timer(LoopStats::kRead);
 	Common::WeakReference * reference = static_cast<Common::WeakReference *>(stream->data);
 	if (reference) {
 		UvData * data = dynamic_cast<UvData *>(reference->Lock());
 		if (data) {
+			NET_PROBE2(read, data, nread);
 			data->ReadCallback(static_cast<i32>(nread));
 			data->Release();
 		} else {
@@ -372,18 +958,90 @@ void SocketImpl::read_cb(uv_stream_t * stream, ssize_t nread, const uv_buf_t * b
 	}
 }
 
+void SocketImpl::file_poll_cb(uv_poll_t * handle, int status, int events) {
+	FileRequest * request = static_cast<FileRequest *>(handle->data);
+	LoopStats::CallbackTimer timer(request->receive ? LoopStats::kRead : LoopStats::kWrite);
+#ifdef __linux__
+	if (status < 0) {
+		// 错误队列非空(POLLERR)时libuv停止轮询, 套接字出错则结束
+		i32 error = 0;
+		socklen_t len = sizeof(error);
+		if (getsockopt(request->sock, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+			error = errno;
+		}
+		if (0 != error) {
+			FinishFileRequest(request, uv_translate_sys_error(error));
+			return;
+		}
+		// 否则是零拷贝完成通知, 同读事件一样以0回调, 由持有者回收后继续
+		if (request->reference) {
+			UvData * data = dynamic_cast<UvData *>(request->reference->Lock());
+			if (data) {
+				data->ReadCallback(0);
+				data->Release();
+			}
+		}
+		if (request->done) {
+			return;
+		}
+		uv_poll_start(handle, request->receive ? UV_READABLE : UV_WRITABLE, file_poll_cb);
+	}
+	if (request->receive) {
+		ReceiveStep(request);
+	} else {
+		SendFileStep(request);
+	}
+#endif
+}
+
+void SocketImpl::file_close_cb(uv_handle_t * handle) {
+	FileRequest * request = static_cast<FileRequest *>(handle->data);
+#ifdef __linux__
+	ClosePipe(request);
+	close(request->sock);
+#endif
+	SocketImpl * impl = request->impl;
+	if (impl) {
+		if (impl->sendfile_ == request) {
+			impl->sendfile_ = nullptr;
+		} else if (impl->recvfile_ == request) {
+			impl->recvfile_ = nullptr;
+		}
+	}
+	if (request->reference) {
+		UvData * data = dynamic_cast<UvData *>(request->reference->Lock());
+		if (data) {
+			if (request->receive) {
+				data->ReceiveFileCallback(request->status, request->transferred, request->arg);
+			} else {
+				data->SendFileCallback(request->status, request->transferred, request->arg);
+			}
+			data->Release();
+		} else {
+			Logger::Category::GetCategory("SocketImpl")->Warn("file_close_cb() UvData has been released");
+		}
+		request->reference->Release();
+	}
+	if (impl) {
+		impl->Release();
+	}
+	delete request;
+}
+
 void SocketImpl::write_cb(uv_write_t * req, int status) {
+	LoopStats::CallbackTimer timer(LoopStats::kWrite);
 	Common::WeakReference * reference = static_cast<Common::WeakReference *>(req->handle->data);
 	if (reference) {
 		UvData * data = dynamic_cast<UvData *>(reference->Lock());
 		if (data) {
+			NET_PROBE3(write__done, data, status, req->data);
 			data->WrittenCallback(status, req->data);
 			data->Release();
 		} else {
 			Logger::Category::GetCategory("SocketImpl")->Warn("write_cb() UvData has been released");
 		}
 	}
-	jc_free(req);
+	BufferPool::DeAllocate(req);
 }
 
 }
\ No newline at end of file
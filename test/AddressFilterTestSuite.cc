@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "Address/AddressFilter.h"
+#include <fstream>
+#include <cstdio>
+
+TEST(AddressFilterTestSuite, parse) {
+	Net::AddressFilter filter;
+	EXPECT_TRUE(filter.GetDefault());
+	EXPECT_TRUE(filter.Deny("10.0.0.0/8"));
+	EXPECT_TRUE(filter.Deny("192.168.1.1"));
+	EXPECT_TRUE(filter.Allow("2001:db8::/32"));
+	EXPECT_FALSE(filter.Deny(nullptr));
+	EXPECT_FALSE(filter.Deny(""));
+	EXPECT_FALSE(filter.Deny("/8"));
+	EXPECT_FALSE(filter.Deny("10.0.0.0/"));
+	EXPECT_FALSE(filter.Deny("10.0.0.0/33"));
+	EXPECT_FALSE(filter.Deny("10.0.0.0/8x"));
+	EXPECT_FALSE(filter.Deny("2001:db8::/129"));
+	EXPECT_FALSE(filter.Deny("bad/8"));
+	EXPECT_EQ(filter.GetRuleCount(), 3);
+	// 重复规则覆盖
+	EXPECT_TRUE(filter.Allow("10.0.0.0/8"));
+	EXPECT_EQ(filter.GetRuleCount(), 3);
+	filter.Clear();
+	EXPECT_EQ(filter.GetRuleCount(), 0);
+}
+
+TEST(AddressFilterTestSuite, longest_prefix) {
+	Net::AddressFilter filter;
+	EXPECT_TRUE(filter.Deny("10.0.0.0/8"));
+	EXPECT_TRUE(filter.Allow("10.1.0.0/16"));
+	EXPECT_TRUE(filter.Deny("10.1.2.0/24"));
+	EXPECT_TRUE(filter.Deny("10.1.2.128/25"));
+	EXPECT_TRUE(filter.Allow("10.1.2.200"));
+	EXPECT_TRUE(filter.Deny("11.0.0.0/8"));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("9.255.255.255")));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("10.0.0.1")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("10.1.3.1")));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("10.1.2.1")));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("10.1.2.129")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("10.1.2.200")));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("11.2.3.4")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("12.0.0.0")));
+	// IPv4映射地址按IPv4规则
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("::ffff:10.0.0.1")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("::ffff:10.1.2.200")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("::10.0.0.1")));
+
+	EXPECT_TRUE(filter.Deny("2001:db8::/32"));
+	EXPECT_TRUE(filter.Allow("2001:db8:1::/48"));
+	EXPECT_TRUE(filter.Deny("::ffff:12.0.0.0/104"));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("2001:db8::1")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("2001:db8:1::1")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("2001:db9::1")));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("12.1.1.1")));
+
+	// 默认拒绝
+	Net::AddressFilter whitelist(false);
+	EXPECT_TRUE(whitelist.Allow("127.0.0.1/32"));
+	EXPECT_TRUE(whitelist.Allow("::1"));
+	EXPECT_TRUE(whitelist.IsAllowed(Net::IPAddress("127.0.0.1")));
+	EXPECT_TRUE(whitelist.IsAllowed(Net::IPAddress("::ffff:127.0.0.1")));
+	EXPECT_TRUE(whitelist.IsAllowed(Net::IPAddress("::1")));
+	EXPECT_FALSE(whitelist.IsAllowed(Net::IPAddress("127.0.0.2")));
+	EXPECT_FALSE(whitelist.IsAllowed(Net::IPAddress("::2")));
+	EXPECT_TRUE(whitelist.Allow("0.0.0.0/0"));
+	EXPECT_TRUE(whitelist.IsAllowed(Net::IPAddress("8.8.8.8")));
+	EXPECT_FALSE(whitelist.IsAllowed(Net::IPAddress("2001:db8::1")));
+}
+
+TEST(AddressFilterTestSuite, brute_force) {
+	// 与逐条规则线性匹配的结果比较
+	Net::AddressFilter filter;
+	std::vector<std::pair<u32, i32>> rules;
+	std::vector<bool> actions;
+	u32 seed = 1;
+	auto next = [&seed]() { seed = seed * 1103515245 + 12345; return seed; };
+	auto mask = [](i32 prefix) { return 0 == prefix ? 0u : 0xFFFFFFFFu << (32 - prefix); };
+	for (i32 i = 0; i < 300; ++i) {
+		i32 prefix = static_cast<i32>(next() % 33);
+		u32 key = (next() & 0xFF0F0000) | (next() >> 20);
+		key &= mask(prefix);
+		bool allow = 0 != next() % 2;
+		u32 be = htonl(key);
+		EXPECT_TRUE(filter.Add(Net::IPAddress(&be, 4), prefix, allow));
+		bool replaced = false;
+		for (size_t j = 0; j < rules.size(); ++j) {
+			if (rules[j].first == key && rules[j].second == prefix) {
+				actions[j] = allow;
+				replaced = true;
+			}
+		}
+		if (!replaced) {
+			rules.push_back(std::make_pair(key, prefix));
+			actions.push_back(allow);
+		}
+	}
+	EXPECT_EQ(filter.GetRuleCount(), static_cast<i32>(rules.size()));
+	for (i32 i = 0; i < 20000; ++i) {
+		u32 ip = (next() & 0xFF0F0000) | (next() >> 20);
+		i32 best = -1;
+		for (size_t j = 0; j < rules.size(); ++j) {
+			if ((ip & mask(rules[j].second)) == rules[j].first && (best < 0 || rules[j].second > rules[best].second)) {
+				best = static_cast<i32>(j);
+			}
+		}
+		u32 be = htonl(ip);
+		ASSERT_EQ(filter.IsAllowed(Net::IPAddress(&be, 4)), best < 0 ? true : static_cast<bool>(actions[best]));
+	}
+}
+
+TEST(AddressFilterTestSuite, load) {
+	{
+		std::ofstream file("address_filter.txt");
+		file << "# blocked ranges\ndeny 10.0.0.0/8\nallow 10.1.0.0/16 # office\n\ndeny 2001:db8::/32\n";
+	}
+	Net::AddressFilter filter;
+	EXPECT_EQ(filter.Load("address_filter.txt"), 3);
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("10.2.0.1")));
+	EXPECT_TRUE(filter.IsAllowed(Net::IPAddress("10.1.0.1")));
+	EXPECT_FALSE(filter.IsAllowed(Net::IPAddress("2001:db8::1")));
+	{
+		std::ofstream file("address_filter.txt");
+		file << "deny 10.0.0.0/8\nblock 11.0.0.0/8\n";
+	}
+	Net::AddressFilter bad;
+	EXPECT_LT(bad.Load("address_filter.txt"), 0);
+	std::remove("address_filter.txt");
+	EXPECT_LT(bad.Load("address_filter.txt"), 0);
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "Common/BufferPool.h"
+#include <thread>
+
+static Net::BufferPool::ClassStats GetStats(i32 size) {
+	Net::BufferPool::ClassStats stats;
+	i32 index = 0;
+	while (index < Net::BufferPool::GetClassCount()) {
+		Net::BufferPool::GetClassStats(index, stats);
+		if (stats.block_size >= size) {
+			break;
+		}
+		++index;
+	}
+	return stats;
+}
+
+TEST(BufferPoolTestSuite, alloc) {
+	EXPECT_TRUE(Net::BufferPool::Allocate(0) == nullptr);
+	EXPECT_TRUE(Net::BufferPool::Allocate(-1) == nullptr);
+	Net::BufferPool::DeAllocate(nullptr);
+
+	void * small = Net::BufferPool::Allocate(1);
+	void * large = Net::BufferPool::Allocate(Net::BufferPool::kMaxBlockSize + 1);
+	EXPECT_TRUE(small != nullptr);
+	EXPECT_TRUE(large != nullptr);
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(small) % 16, 0u);
+	std::memset(small, 0xAB, 1);
+	std::memset(large, 0xCD, Net::BufferPool::kMaxBlockSize + 1);
+	Net::BufferPool::DeAllocate(small);
+	Net::BufferPool::DeAllocate(large);
+}
+
+TEST(BufferPoolTestSuite, recycle) {
+	Net::BufferPool::ClassStats before = GetStats(200);
+	void * p1 = Net::BufferPool::Allocate(200);
+	Net::BufferPool::DeAllocate(p1);
+	void * p2 = Net::BufferPool::Allocate(200);
+	EXPECT_EQ(p1, p2);
+	Net::BufferPool::DeAllocate(p2);
+	Net::BufferPool::ClassStats after = GetStats(200);
+	EXPECT_EQ(after.block_size, 256);
+	EXPECT_EQ(after.allocs - before.allocs, 2);
+	EXPECT_EQ(after.frees - before.frees, 2);
+	EXPECT_GE(after.local_hits - before.local_hits, 1);
+	EXPECT_EQ(after.in_use, before.in_use);
+}
+
+TEST(BufferPoolTestSuite, overflow) {
+	const i32 count = Net::BufferPool::kLocalCacheMax * 2;
+	void * blocks[count];
+	for (i32 i = 0; i < count; ++i) {
+		blocks[i] = Net::BufferPool::Allocate(1000);
+	}
+	for (i32 i = 0; i < count; ++i) {
+		Net::BufferPool::DeAllocate(blocks[i]);
+	}
+	Net::BufferPool::ClassStats stats = GetStats(1000);
+	EXPECT_GE(stats.central_cached, Net::BufferPool::kTransferBatch);
+	Net::BufferPool::Trim();
+	stats = GetStats(1000);
+	EXPECT_EQ(stats.central_cached, 0);
+}
+
+TEST(BufferPoolTestSuite, thread_exit) {
+	void * block = nullptr;
+	std::thread t([&block]() {
+		block = Net::BufferPool::Allocate(3000);
+		Net::BufferPool::DeAllocate(block);
+	});
+	t.join();
+	Net::BufferPool::ClassStats stats = GetStats(3000);
+	EXPECT_GE(stats.central_cached, 1);
+	void * reuse = Net::BufferPool::Allocate(3000);
+	EXPECT_EQ(reuse, block);
+	Net::BufferPool::DeAllocate(reuse);
+	Net::BufferPool::Trim();
+}
+
+struct LateFree {
+	LateFree() : block(nullptr) {}
+	~LateFree() {
+		Net::BufferPool::DeAllocate(block);
+		Net::BufferPool::DeAllocate(Net::BufferPool::Allocate(6000));
+	}
+
+	void * block;
+};
+
+TEST(BufferPoolTestSuite, cache_destroyed) {
+	Net::BufferPool::Trim();
+	void * block = nullptr;
+	std::thread t([&block]() {
+		// 先于线程缓存构造, 所以在线程缓存析构之后才析构
+		thread_local LateFree late;
+		late.block = block = Net::BufferPool::Allocate(6000);
+	});
+	t.join();
+	Net::BufferPool::ClassStats stats = GetStats(6000);
+	EXPECT_GE(stats.central_cached, 1);
+	void * reuse = Net::BufferPool::Allocate(6000);
+	EXPECT_EQ(reuse, block);
+	Net::BufferPool::DeAllocate(reuse);
+	Net::BufferPool::Trim();
+}
+
+TEST(BufferPoolTestSuite, huge_pages) {
+	Net::BufferPool::SetHugePages(true);
+	EXPECT_TRUE(Net::BufferPool::IsHugePages());
+	void * block = Net::BufferPool::Allocate(8192);
+	EXPECT_TRUE(block != nullptr);
+	std::memset(block, 0, 8192);
+	Net::BufferPool::DeAllocate(block);
+	Net::BufferPool::SetHugePages(false);
+	EXPECT_FALSE(Net::BufferPool::IsHugePages());
+	Net::BufferPool::Trim();
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+#include "Common/Histogram.h"
+#include <thread>
+
+TEST(HistogramTestSuite, buckets) {
+	for (i32 i = 0; i < Net::Histogram::kBucketCount; ++i) {
+		EXPECT_EQ(Net::Histogram::BucketOf(Net::Histogram::LowerBoundOf(i)), i);
+		if (i < Net::Histogram::kBucketCount - 1) {
+			EXPECT_EQ(Net::Histogram::BucketOf(Net::Histogram::UpperBoundOf(i)), i);
+			EXPECT_EQ(Net::Histogram::UpperBoundOf(i) + 1, Net::Histogram::LowerBoundOf(i + 1));
+		}
+	}
+	EXPECT_EQ(Net::Histogram::BucketOf(~static_cast<u64>(0)), Net::Histogram::kBucketCount - 1);
+	// 相对误差不超过1/16
+	for (u64 value = 1; value < (static_cast<u64>(1) << 40); value = value * 3 + 1) {
+		i32 index = Net::Histogram::BucketOf(value);
+		EXPECT_LE(Net::Histogram::LowerBoundOf(index), value);
+		EXPECT_GE(Net::Histogram::UpperBoundOf(index), value);
+		EXPECT_LE(Net::Histogram::UpperBoundOf(index) - Net::Histogram::LowerBoundOf(index), value / 16);
+	}
+}
+
+TEST(HistogramTestSuite, percentile) {
+	Net::Histogram histogram;
+	EXPECT_EQ(histogram.Count(), 0);
+	EXPECT_EQ(histogram.Min(), 0u);
+	EXPECT_EQ(histogram.Percentile(50), 0u);
+	for (u64 i = 1; i <= 1000; ++i) {
+		histogram.Record(i * 1000);
+	}
+	EXPECT_EQ(histogram.Count(), 1000);
+	EXPECT_EQ(histogram.Min(), 1000u);
+	EXPECT_EQ(histogram.Max(), 1000000u);
+	EXPECT_EQ(histogram.Sum(), 500500000u);
+	EXPECT_DOUBLE_EQ(histogram.Mean(), 500500);
+	u64 p50 = histogram.Percentile(50), p99 = histogram.Percentile(99);
+	EXPECT_GE(p50, 500000u);
+	EXPECT_LE(p50, 500000u + 500000u / 16);
+	EXPECT_GE(p99, 990000u);
+	EXPECT_LE(p99, 1000000u);
+	EXPECT_EQ(histogram.Percentile(100), 1000000u);
+	EXPECT_LE(histogram.Percentile(0), 1000u + 1000u / 16);
+
+	Net::Histogram copy(histogram);
+	copy.Merge(histogram);
+	EXPECT_EQ(copy.Count(), 2000);
+	EXPECT_EQ(copy.Percentile(50), p50);
+	copy.Reset();
+	EXPECT_EQ(copy.Count(), 0);
+	EXPECT_EQ(histogram.Count(), 1000);
+}
+
+TEST(HistogramTestSuite, concurrent_read) {
+	Net::Histogram histogram;
+	std::atomic<bool> done(false);
+	std::thread reader([&histogram, &done]() {
+		while (!done) {
+			Net::Histogram snapshot(histogram);
+			EXPECT_LE(snapshot.Max(), 100000u);
+		}
+	});
+	for (u64 i = 0; i < 100000; ++i) {
+		histogram.Record(i + 1);
+	}
+	done = true;
+	reader.join();
+	EXPECT_EQ(histogram.Count(), 100000);
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "gtest/gtest.h"
 #include "Address/IPAddress.h"
+#include <unordered_set>
+#include <chrono>
+#include <random>
 
 class IPAddressImplTestSuite : public testing::Test {
 public:
@@ -292,4 +295,120 @@ TEST_F(IPAddressTestSuite, tryparse) {
 
 	EXPECT_EQ(Net::IPAddress::TryParse("error ip", *ip6_), false);
 	EXPECT_STREQ(*ip6_->ToString(), "fe80::6101:927f:1dde:cb33");
+}
+
+TEST_F(IPAddressTestSuite, hash) {
+	EXPECT_TRUE(std::is_trivially_copyable<Net::IPAddress>::value);
+	Net::IPAddress ip(ipv4_impl_->Addr(), ipv4_impl_->Length());
+	EXPECT_EQ(ip.Hash(), ip_->Hash());
+	EXPECT_NE(ip_->Hash(), ip6_->Hash());
+	EXPECT_NE(Net::IPAddress("0.0.0.0").Hash(), Net::IPAddress("::").Hash());
+	Net::IPAddress ip6(ip6_->Addr(), ip6_->Length());
+	EXPECT_NE(ip6.Hash(), ip6_->Hash());
+
+	std::unordered_set<Net::IPAddress> ips;
+	ips.insert(*ip_);
+	ips.insert(ip);
+	ips.insert(*ip6_);
+	ips.insert(ip6);
+	EXPECT_EQ(ips.size(), 3u);
+	EXPECT_EQ(ips.count(Net::IPAddress("192.168.1.100")), 1u);
+	EXPECT_EQ(ips.count(Net::IPAddress("192.168.1.101")), 0u);
+}
+
+TEST_F(IPAddressTestSuite, parse_conformance) {
+	const i8 * cases[] = {
+		"1.2.3.4", "255.255.255.255", "256.1.1.1", "1.2.3", "1.2.3.4.5", "01.2.3.4", "1..2.3", "1.2.3.4 x", "a.b.c.d",
+		"::", "::1", "1::", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9", "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8",
+		"1::2::3", ":1::2", "1::2:", "12345::", "fe80::1", "FE80::ABCD", "::ffff:1.2.3.4", "::1.2.3.4",
+		"1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4", "::ffff:1.2.3", "1.2.3.4::", "g::1", ":::", "1:::2",
+		"ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255",
+	};
+	for (auto & it : cases) {
+		u8 expect[16];
+		bool valid = 0 == uv_inet_pton(AF_INET, it, expect) || 0 == uv_inet_pton(AF_INET6, it, expect);
+		Net::IPAddress ip;
+		EXPECT_EQ(Net::IPAddress::TryParse(it, ip), valid) << it;
+		if (valid) {
+			EXPECT_EQ(std::memcmp(ip.Addr(), expect, ip.Length()), 0) << it;
+		}
+	}
+
+	// 随机地址与uv_inet_ntop/uv_inet_pton往返比较
+	std::minstd_rand random(12345);
+	i8 expect[INET6_ADDRSTRLEN], buf[Net::IPAddress::kMaxStringLength];
+	for (i32 i = 0; i < 20000; ++i) {
+		u8 addr[16];
+		for (auto & byte : addr) {
+			byte = static_cast<u8>(random());
+		}
+		// 随机置0若干段以覆盖"::"压缩
+		i32 base = random() % 8, len = random() % 9;
+		for (i32 j = base; j < base + len && j < 8; ++j) {
+			addr[j * 2] = addr[j * 2 + 1] = 0;
+		}
+		bool ipv6 = 0 != i % 4;
+		Net::IPAddress ip(addr, ipv6 ? 16 : 4);
+		ASSERT_EQ(0, uv_inet_ntop(ip.AF(), addr, expect, sizeof(expect)));
+		EXPECT_EQ(ip.Format(buf, sizeof(buf)), static_cast<i32>(std::strlen(expect)));
+		ASSERT_STREQ(buf, expect);
+		Net::IPAddress parsed;
+		ASSERT_TRUE(Net::IPAddress::TryParse(expect, parsed)) << expect;
+		EXPECT_TRUE(parsed == ip) << expect;
+	}
+
+	EXPECT_EQ(ip6_->Format(buf, 10), UV_ENOSPC);
+	EXPECT_TRUE(Net::IPAddress::TryParse(" 10.0.0.1 trailing", 9, *ip_));
+	EXPECT_STREQ(*ip_->ToString(), "10.0.0.1");
+}
+
+TEST_F(IPAddressTestSuite, parse_format_consistent) {
+	const i8 * ips[] = { "192.168.1.100", "10.0.0.1", "fe80::6101:927f:1dde:cb33", "2001:db8:85a3::8a2e:370:7334" };
+	i8 buf[Net::IPAddress::kMaxStringLength];
+	for (auto & it : ips) {
+		Net::IPv4AddressImpl ipv4(Net::IPv4AddressImpl::Parse(it));
+		std::string expect = ipv4 != Net::IPv4AddressImpl() ? *ipv4.ToString() : *Net::IPv6AddressImpl::Parse(it).ToString();
+		Net::IPAddress ip;
+		EXPECT_TRUE(Net::IPAddress::TryParse(it, ip));
+		EXPECT_EQ(ip.Format(buf, sizeof(buf)), static_cast<i32>(expect.size()));
+		EXPECT_STREQ(buf, expect.c_str());
+	}
+}
+
+// 与IPv4AddressImpl/IPv6AddressImpl对比的解析+格式化耗时, 默认不运行,
+// 用--gtest_also_run_disabled_tests --gtest_filter=*parse_format_bench运行, 结果记录在测试属性中
+TEST_F(IPAddressTestSuite, DISABLED_parse_format_bench) {
+	const i8 * ips[] = { "192.168.1.100", "10.0.0.1", "fe80::6101:927f:1dde:cb33", "2001:db8:85a3::8a2e:370:7334" };
+	const i32 count = 50000;
+	size_t old_chars = 0, new_chars = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (i32 i = 0; i < count; ++i) {
+		for (auto & it : ips) {
+			Net::IPv4AddressImpl ipv4(Net::IPv4AddressImpl::Parse(it));
+			if (ipv4 != Net::IPv4AddressImpl()) {
+				old_chars += std::strlen(*ipv4.ToString());
+			} else {
+				old_chars += std::strlen(*Net::IPv6AddressImpl::Parse(it).ToString());
+			}
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+	i8 buf[Net::IPAddress::kMaxStringLength];
+	for (i32 i = 0; i < count; ++i) {
+		for (auto & it : ips) {
+			Net::IPAddress ip;
+			Net::IPAddress::TryParse(it, ip);
+			new_chars += ip.Format(buf, sizeof(buf));
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	EXPECT_EQ(old_chars, new_chars);
+	i64 ops = static_cast<i64>(count) * 4;
+	i64 old_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count();
+	i64 new_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count();
+	RecordProperty("operations", std::to_string(ops));
+	RecordProperty("impl_ns_per_op", std::to_string(static_cast<double>(old_ns) / ops));
+	RecordProperty("ipaddress_ns_per_op", std::to_string(static_cast<double>(new_ns) / ops));
 }
\ No newline at end of file
@@ -4,6 +4,22 @@
 #include "Reactor/SocketAcceptor.h"
 #include "Reactor/SocketConnector.h"
 #include "Reactor/SocketConnection.h"
+#include "Reactor/ConnectionPool.h"
+#include "Reactor/Resolver.h"
+#include "Reactor/ConnectionLimiter.h"
+#include "Reactor/StatsSegment.h"
+#include "Reactor/MetricsServer.h"
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
 
 class MockSuccEventHandler : public Net::EventHandler {
 public:
@@ -87,6 +103,92 @@ TEST(ReactorTest, reactor_remove) {
 	h3->Release();
 }
 
+class MockResolveHandler : public MockSuccEventHandler {
+public:
+	MockResolveHandler(Net::EventReactor * reactor) : MockSuccEventHandler(reactor), resolved_(0), status_(0) {}
+	virtual void ResolveCallback(i32 status, const std::vector<Net::SocketAddress> & addresses, void * arg) override {
+		++resolved_;
+		status_ = status;
+		addresses_ = addresses;
+	}
+	i32 resolved_;
+	i32 status_;
+	std::vector<Net::SocketAddress> addresses_;
+};
+
+TEST(ReactorTest, resolver) {
+	Net::EventReactor reactor;
+	Net::Resolver * resolver = reactor.GetResolver();
+	EXPECT_EQ(reactor.GetResolver(), resolver);
+	MockResolveHandler * handler = new MockResolveHandler(&reactor);
+
+	resolver->Resolve("", 80, handler, nullptr);
+	EXPECT_EQ(handler->resolved_, 1);
+	EXPECT_EQ(handler->status_, UV_EINVAL);
+	resolver->Resolve("127.0.0.1", 80, handler, nullptr);
+	EXPECT_EQ(handler->resolved_, 2);
+	EXPECT_EQ(handler->status_, 0);
+	ASSERT_EQ(handler->addresses_.size(), 1u);
+	EXPECT_EQ(handler->addresses_[0], Net::SocketAddress("127.0.0.1", 80));
+
+	// hosts文件
+	{
+		std::ofstream hosts("resolver_hosts.txt");
+		hosts << "# test hosts\n127.0.0.2 Upstream.Test alias.test # comment\n::1 upstream.test\nbad-ip other.test\n";
+	}
+	EXPECT_EQ(resolver->LoadHosts("resolver_hosts.txt"), 3);
+	std::remove("resolver_hosts.txt");
+	EXPECT_LT(resolver->LoadHosts("resolver_hosts.txt"), 0);
+	resolver->Resolve("UPSTREAM.test.", 8080, handler, nullptr);
+	EXPECT_EQ(handler->resolved_, 3);
+	ASSERT_EQ(handler->addresses_.size(), 2u);
+	EXPECT_EQ(handler->addresses_[0], Net::SocketAddress("127.0.0.2", 8080));
+	EXPECT_EQ(handler->addresses_[1], Net::SocketAddress("::1", 8080));
+	EXPECT_EQ(resolver->GetLookupCount(), 0);
+
+	// 同一主机名只发起一次系统解析
+	for (i32 i = 0; i < 3; ++i) {
+		resolver->Resolve("localhost", 80, handler, nullptr);
+	}
+	EXPECT_EQ(resolver->GetLookupCount(), 1);
+	EXPECT_EQ(resolver->GetPendingCount(), 1);
+	for (i32 i = 0; i < 1000 && handler->resolved_ < 6; ++i) {
+		reactor.Poll(UV_RUN_ONCE);
+	}
+	EXPECT_EQ(handler->resolved_, 6);
+	EXPECT_EQ(handler->status_, 0);
+	EXPECT_FALSE(handler->addresses_.empty());
+	EXPECT_EQ(resolver->GetPendingCount(), 0);
+	resolver->Resolve("LocalHost", 80, handler, nullptr);
+	EXPECT_EQ(handler->resolved_, 7);
+	EXPECT_EQ(resolver->GetLookupCount(), 1);
+
+	// 失败结果也缓存
+	resolver->Resolve("bad..name", 80, handler, nullptr);
+	for (i32 i = 0; i < 1000 && handler->resolved_ < 8; ++i) {
+		reactor.Poll(UV_RUN_ONCE);
+	}
+	EXPECT_EQ(handler->resolved_, 8);
+	EXPECT_LT(handler->status_, 0);
+	EXPECT_TRUE(handler->addresses_.empty());
+	resolver->Resolve("bad..name", 80, handler, nullptr);
+	EXPECT_EQ(handler->resolved_, 9);
+	EXPECT_LT(handler->status_, 0);
+	EXPECT_EQ(resolver->GetLookupCount(), 2);
+	EXPECT_EQ(resolver->GetCacheSize(), 2);
+
+	resolver->SetTTL(0, 0);
+	EXPECT_EQ(resolver->GetCacheSize(), 0);
+	resolver->Resolve("localhost", 80, handler, nullptr);
+	handler->Release();
+	// 回调前释放handler, 结果被丢弃
+	for (i32 i = 0; i < 1000 && resolver->GetPendingCount() > 0; ++i) {
+		reactor.Poll(UV_RUN_ONCE);
+	}
+	EXPECT_EQ(resolver->GetLookupCount(), 3);
+	EXPECT_EQ(resolver->GetCacheSize(), 0);
+}
+
 class ReactorTestSuite : public testing::Test {
 public:
 	// Sets up the test fixture.
@@ -139,9 +241,54 @@ TEST(ReactorTest, reactor_dtor) {
 	uv_timer_start(timer, ReactorTestSuite::timer_cb, 10, 0);
 }
 
+TEST(ReactorTest, reactor_run_stop) {
+	Net::EventReactor reactor;
+	reactor.Stop();
+	reactor.Run();
+	std::thread t([&reactor]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		reactor.Stop();
+	});
+	reactor.Run();
+	t.join();
+	EXPECT_EQ(reactor.Poll(), false);
+}
+
+TEST(ReactorTest, reactor_defer_release) {
+	Net::EventReactor reactor;
+	MockSuccEventHandler * h1 = new MockSuccEventHandler(&reactor);
+	h1->Duplicate();
+	reactor.DeferRelease(h1);
+	EXPECT_EQ(h1->ReferenceCount(), 2);
+	EXPECT_EQ(reactor.Poll(), false);
+	EXPECT_EQ(h1->ReferenceCount(), 1);
+	reactor.DeferRelease(h1);
+}
+
+TEST(ReactorTest, reactor_busy_poll) {
+	Net::EventReactor reactor;
+	EXPECT_FALSE(reactor.IsBusyPoll());
+	reactor.SetBusyPoll(true, 100);
+	EXPECT_TRUE(reactor.IsBusyPoll());
+	EXPECT_EQ(reactor.GetSpinBudget(), 100);
+	EXPECT_FALSE(reactor.SetCpuAffinity(-1));
+	std::thread t([&reactor]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		reactor.Stop();
+	});
+	reactor.Run();
+	t.join();
+	const Net::EventReactor::BusyPollStats & stats = reactor.GetBusyPollStats();
+	EXPECT_GT(stats.spin_time, 0);
+	EXPECT_GT(stats.blocked_time, 0);
+	EXPECT_GE(stats.blocked_wakeups, 1);
+	reactor.SetBusyPoll(false);
+	EXPECT_FALSE(reactor.IsBusyPoll());
+}
+
 class MockConnection : public Net::SocketConnection {
 public:
-	MockConnection() : Net::SocketConnection(60, 50), call_connected_(0), call_disconnected_(0), call_recv_(0), call_sent_(0), call_error_(0) {}
+	MockConnection() : Net::SocketConnection(60, 50), call_connected_(0), call_disconnected_(0), call_recv_(0), call_sent_(0), call_file_sent_(0), call_file_recv_(0), call_error_(0) {}
 	virtual void OnConnected() {
 		Net::SocketConnection::OnConnected();
 		call_connected_++;
@@ -158,6 +305,18 @@ public:
 		Net::SocketConnection::OnSomeDataSent();
 		call_sent_++;
 	}
+	virtual void OnFileSent(i32 status, i64 sent) {
+		Net::SocketConnection::OnFileSent(status, sent);
+		if (status >= 0) {
+			call_file_sent_ += static_cast<i32>(sent);
+		}
+	}
+	virtual void OnFileReceived(i32 status, i64 received) {
+		Net::SocketConnection::OnFileReceived(status, received);
+		if (status >= 0) {
+			call_file_recv_ += static_cast<i32>(received);
+		}
+	}
 	virtual void OnError(i32 reason) {
 		Net::SocketConnection::OnError(reason);
 		call_error_++;
@@ -167,6 +326,8 @@ public:
 	i32 call_disconnected_;
 	i32 call_recv_;
 	i32 call_sent_;
+	i32 call_file_sent_;
+	i32 call_file_recv_;
 	i32 call_error_;
 };
 
@@ -413,6 +574,798 @@ TEST_F(ConnectorTestSuite, connect_cb_repeat) {
 	connector->Release();
 }
 
+class MockMultiConnector : public MockNullConnector {
+public:
+	MockMultiConnector(Net::EventReactor * reactor) : MockNullConnector(reactor) {}
+	virtual ~MockMultiConnector() {
+		for (auto & it : connection_list_) {
+			it->Release();
+		}
+	}
+	virtual Net::SocketConnection * CreateConnection() {
+		Net::SocketConnection * connection = new MockConnection();
+		connection_list_.push_back(connection);
+		return connection;
+	}
+	virtual void DestroyConnection(Net::SocketConnection * connection) {
+		connection_list_.remove(connection);
+		connection->Release();
+	}
+	std::list<Net::SocketConnection *> connection_list_;
+};
+
+TEST_F(ConnectorTestSuite, multi_connect) {
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	connector->SetConcurrency(4, 4);
+	for (i32 i = 0; i < 8; ++i) {
+		EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	}
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), false);
+	EXPECT_EQ(connector->GetConnectingCount(), 4);
+	EXPECT_EQ(connector->GetQueuedCount(), 4);
+	EXPECT_EQ(connector->ReferenceCount(), 2);
+	for (i32 i = 0; i < 100 && connector->connection_list_.size() < 8; ++i) {
+		Poll();
+	}
+	EXPECT_EQ(connector->connection_list_.size(), 8u);
+	EXPECT_EQ(acceptor_->connection_list_.size(), 8u);
+	EXPECT_EQ(connector->connect_failed_, 0);
+	EXPECT_EQ(connector->GetConnectingCount(), 0);
+	EXPECT_EQ(connector->ReferenceCount(), 1);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, multi_close) {
+	MockNullConnector * connector = new MockNullConnector(GetReactor());
+	connector->SetConcurrency(2, 2);
+	for (i32 i = 0; i < 4; ++i) {
+		EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	}
+	connector->Close();
+	EXPECT_EQ(connector->GetQueuedCount(), 0);
+	Poll();
+	EXPECT_EQ(connector->connect_failed_, 2);
+	EXPECT_EQ(connector->GetConnectingCount(), 0);
+	EXPECT_EQ(connector->ReferenceCount(), 1);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, connect_timeout) {
+	MockNullConnector * connector = new MockNullConnector(GetReactor());
+	connector->SetConnectTimeout(20);
+	EXPECT_EQ(connector->GetConnectTimeout(), 20);
+	// 不可路由的地址, 超时或网络不可达都会失败
+	if (connector->Connect(Net::SocketAddress("10.255.255.1", port_))) {
+		for (i32 i = 0; i < 200 && 0 == connector->connect_failed_; ++i) {
+			Poll();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		EXPECT_EQ(connector->connect_failed_, 1);
+		EXPECT_EQ(connector->GetConnectingCount(), 0);
+		EXPECT_EQ(connector->ReferenceCount(), 1);
+	}
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, connect_host) {
+	Net::Resolver * resolver = GetReactor()->GetResolver();
+	EXPECT_TRUE(resolver->AddHost("upstream.test", "127.0.0.1"));
+	EXPECT_FALSE(resolver->AddHost("upstream.test", "bad-ip"));
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect("upstream.test", port_), true);
+	EXPECT_EQ(connector->GetConnectingCount(), 1);
+	for (i32 i = 0; i < 100 && connector->connection_list_.empty(); ++i) {
+		Poll();
+	}
+	EXPECT_EQ(connector->connection_list_.size(), 1u);
+	EXPECT_EQ(connector->connect_failed_, 0);
+
+	// 解析失败
+	EXPECT_EQ(connector->Connect("bad..name", port_), true);
+	for (i32 i = 0; i < 100 && 0 == connector->connect_failed_; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(connector->connect_failed_, 1);
+	EXPECT_EQ(connector->GetConnectingCount(), 0);
+	EXPECT_EQ(connector->ReferenceCount(), 1);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, connect_mixed) {
+	// 解析中的域名连接和按地址连接共用并发数
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	connector->SetConcurrency(1, 1);
+	EXPECT_EQ(connector->Connect("localhost", port_), true);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	EXPECT_EQ(connector->GetConnectingCount(), 1);
+	EXPECT_EQ(connector->GetQueuedCount(), 1);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), false);
+	EXPECT_EQ(connector->Connect("localhost", port_), false);
+
+	// 关闭后进行中的解析以失败结束, 排队的连接被丢弃
+	connector->Close();
+	EXPECT_EQ(connector->GetQueuedCount(), 0);
+	for (i32 i = 0; i < 1000 && connector->GetConnectingCount() > 0; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(connector->GetConnectingCount(), 0);
+	EXPECT_EQ(connector->connect_failed_, 1);
+	EXPECT_TRUE(connector->connection_list_.empty());
+	EXPECT_EQ(connector->ReferenceCount(), 1);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, connect_race) {
+	// 第一个地址不可路由, fallback delay后并行连接第二个地址, 胜出后取消第一个
+	Net::Resolver * resolver = GetReactor()->GetResolver();
+	resolver->AddHost("race.test", "10.255.255.1");
+	resolver->AddHost("race.test", "127.0.0.1");
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	connector->SetFallbackDelay(10);
+	EXPECT_EQ(connector->GetFallbackDelay(), 10);
+	EXPECT_EQ(connector->Connect("race.test", port_), true);
+	for (i32 i = 0; i < 200 && connector->connection_list_.empty(); ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(connector->connection_list_.size(), 1u);
+	EXPECT_EQ(connector->connect_failed_, 0);
+	Poll();
+	EXPECT_EQ(connector->GetConnectingCount(), 0);
+	EXPECT_EQ(connector->ReferenceCount(), 1);
+
+	// 同时连接两个可达地址, 只建立一个连接
+	resolver->AddHost("both.test", "127.0.0.1");
+	resolver->AddHost("both.test", "::1");
+	connector->SetFallbackDelay(0);
+	EXPECT_EQ(connector->Connect("both.test", port_), true);
+	for (i32 i = 0; i < 100 && connector->connection_list_.size() < 2; ++i) {
+		Poll();
+	}
+	Poll();
+	EXPECT_EQ(connector->connection_list_.size(), 2u);
+	EXPECT_EQ(connector->connect_failed_, 0);
+	EXPECT_EQ(connector->GetConnectingCount(), 0);
+	EXPECT_EQ(connector->ReferenceCount(), 1);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, accept_filter) {
+	std::shared_ptr<Net::AddressFilter> filter(new Net::AddressFilter());
+	EXPECT_TRUE(filter->Deny("127.0.0.0/8"));
+	EXPECT_TRUE(filter->Deny("::1"));
+	acceptor_->SetAddressFilter(filter);
+	EXPECT_EQ(acceptor_->GetAddressFilter(), filter);
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && 0 == acceptor_->GetRejectedCount(); ++i) {
+		Poll();
+	}
+	EXPECT_EQ(acceptor_->GetRejectedCount(), 1);
+	EXPECT_EQ(acceptor_->connection_list_.size(), 0u);
+
+	// 热更新, 之后的连接按新规则
+	std::shared_ptr<Net::AddressFilter> reload(new Net::AddressFilter(false));
+	EXPECT_TRUE(reload->Allow("127.0.0.1"));
+	EXPECT_TRUE(reload->Allow("::1"));
+	std::thread([this, reload]() { acceptor_->SetAddressFilter(reload); }).join();
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.empty(); ++i) {
+		Poll();
+	}
+	EXPECT_EQ(acceptor_->connection_list_.size(), 1u);
+	EXPECT_EQ(acceptor_->GetRejectedCount(), 1);
+	acceptor_->SetAddressFilter(nullptr);
+	EXPECT_TRUE(acceptor_->GetAddressFilter() == nullptr);
+	connector->Release();
+}
+
+TEST(ReactorTest, limiter_bucket) {
+	Net::ConnectionLimiter limiter(16);
+	Net::IPAddress a("10.0.0.1"), b("10.0.0.2");
+	EXPECT_EQ(limiter.Acquire(a, 0), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.GetSize(), 0);
+
+	// 每秒10个, 突发2个
+	limiter.SetRate(10, 2);
+	EXPECT_EQ(limiter.Acquire(a, 1000), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.Acquire(a, 1000), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.Acquire(a, 1000), Net::ConnectionLimiter::kRateLimited);
+	EXPECT_EQ(limiter.Acquire(b, 1000), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.Acquire(a, 1050), Net::ConnectionLimiter::kRateLimited);
+	EXPECT_EQ(limiter.Acquire(a, 1100), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.Acquire(a, 5000), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.Acquire(a, 5000), Net::ConnectionLimiter::kAccepted);
+	EXPECT_EQ(limiter.Acquire(a, 5000), Net::ConnectionLimiter::kRateLimited);
+	EXPECT_EQ(limiter.GetActive(a), 5);
+
+	// 同时在线上限, 不消耗令牌
+	limiter.SetRate(0, 0);
+	limiter.SetMaxPerAddress(5);
+	EXPECT_EQ(limiter.Acquire(a, 5000), Net::ConnectionLimiter::kTooManyConnections);
+	limiter.Release(a);
+	EXPECT_EQ(limiter.GetActive(a), 4);
+	EXPECT_EQ(limiter.Acquire(a, 5000), Net::ConnectionLimiter::kAccepted);
+	limiter.Release(Net::IPAddress("10.0.0.3"));
+	EXPECT_EQ(limiter.GetSize(), 2);
+}
+
+TEST(ReactorTest, limiter_evict) {
+	Net::ConnectionLimiter limiter(4);
+	limiter.SetMaxPerAddress(1);
+	Net::IPAddress busy("::1");
+	EXPECT_EQ(limiter.Acquire(busy, 0), Net::ConnectionLimiter::kAccepted);
+	// 伪造地址洪水, 表大小不变, 有在线连接的条目不被淘汰
+	i8 host[32];
+	for (i32 i = 0; i < 1000; ++i) {
+		std::snprintf(host, sizeof(host), "192.168.%d.%d", i / 256, i % 256);
+		Net::IPAddress address(host);
+		EXPECT_EQ(limiter.Acquire(address, i), Net::ConnectionLimiter::kAccepted);
+		limiter.Release(address);
+	}
+	EXPECT_EQ(limiter.GetSize(), 4);
+	EXPECT_EQ(limiter.GetCapacity(), 4);
+	EXPECT_EQ(limiter.GetEvictions(), 1000 - 3);
+	EXPECT_EQ(limiter.GetActive(busy), 1);
+	EXPECT_EQ(limiter.Acquire(busy, 1000), Net::ConnectionLimiter::kTooManyConnections);
+	limiter.Release(busy);
+	EXPECT_EQ(limiter.Acquire(busy, 1000), Net::ConnectionLimiter::kAccepted);
+}
+
+TEST_F(ConnectorTestSuite, accept_limit) {
+	std::shared_ptr<Net::ConnectionLimiter> limiter(new Net::ConnectionLimiter());
+	limiter->SetMaxPerAddress(1);
+	acceptor_->SetConnectionLimiter(limiter);
+	EXPECT_EQ(acceptor_->GetConnectionLimiter(), limiter);
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	connector->SetConcurrency(2, 2);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && 0 == acceptor_->GetOverLimitCount(); ++i) {
+		Poll();
+	}
+	EXPECT_EQ(acceptor_->GetOverLimitCount(), 1);
+	EXPECT_EQ(acceptor_->connection_list_.size(), 1u);
+
+	// 断开后归还名额
+	acceptor_->ShutdownAll(true);
+	Poll();
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.size() < 2; ++i) {
+		Poll();
+	}
+	EXPECT_EQ(acceptor_->connection_list_.size(), 2u);
+	EXPECT_EQ(acceptor_->GetOverLimitCount(), 1);
+	EXPECT_EQ(acceptor_->GetRateLimitedCount(), 0);
+	acceptor_->SetConnectionLimiter(nullptr);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, accept_exhausted) {
+	acceptor_->SetExhaustedPause(20);
+	EXPECT_EQ(acceptor_->GetExhaustedPause(), 20);
+	Net::StreamSocket shed, held;
+	shed.Open(GetReactor()->GetUvLoop());
+	EXPECT_EQ(shed.Connect(Net::SocketAddress("127.0.0.1", port_)), 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	// 模拟描述符耗尽, 等待中的连接被直接关闭并暂停接入
+	acceptor_->AcceptCallback(UV_EMFILE);
+	Net::SocketAcceptor::AcceptStats stats = acceptor_->GetAcceptStats();
+	EXPECT_EQ(stats.exhausted, 1);
+	EXPECT_EQ(stats.shed, 1);
+	EXPECT_EQ(stats.pauses, 1);
+	EXPECT_TRUE(stats.paused);
+	EXPECT_TRUE(acceptor_->IsPaused());
+
+	// 暂停期间的连接留到恢复后接入
+	held.Open(GetReactor()->GetUvLoop());
+	EXPECT_EQ(held.Connect(Net::SocketAddress("127.0.0.1", port_)), 0);
+	Poll();
+	EXPECT_EQ(acceptor_->connection_list_.size(), 0u);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.empty(); ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(acceptor_->connection_list_.size(), 1u);
+	stats = acceptor_->GetAcceptStats();
+	EXPECT_FALSE(stats.paused);
+	EXPECT_EQ(stats.accepted, 1);
+	EXPECT_EQ(stats.errors, 0);
+	EXPECT_EQ(stats.pauses, 1);
+}
+
+TEST_F(ConnectorTestSuite, loop_stats) {
+	EXPECT_TRUE(GetReactor()->IsLoopStats());
+	Net::LoopStats::Snapshot before = GetReactor()->GetStats();
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.empty(); ++i) {
+		Poll();
+	}
+	EXPECT_EQ(acceptor_->connection_list_.size(), 1u);
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	Poll();
+	connector->Release();
+	Poll();
+
+	Net::LoopStats::Snapshot after = GetReactor()->GetStats();
+	EXPECT_GT(after.iterations, before.iterations);
+	EXPECT_EQ(after.iteration.Count(), after.iterations);
+	EXPECT_EQ(after.blocked.Count(), after.iterations);
+	EXPECT_EQ(after.busy.Count(), after.iterations);
+	EXPECT_GT(after.events.Max(), 0u);
+	EXPECT_EQ(after.callbacks[Net::LoopStats::kAccept].Count() - before.callbacks[Net::LoopStats::kAccept].Count(), 1);
+	EXPECT_EQ(after.callbacks[Net::LoopStats::kConnect].Count() - before.callbacks[Net::LoopStats::kConnect].Count(), 1);
+	EXPECT_GT(after.callbacks[Net::LoopStats::kRead].Count(), before.callbacks[Net::LoopStats::kRead].Count());
+	EXPECT_GT(after.callbacks[Net::LoopStats::kWrite].Count(), before.callbacks[Net::LoopStats::kWrite].Count());
+	EXPECT_STREQ(Net::LoopStats::CallbackName(Net::LoopStats::kClose), "close");
+
+	// epoll返回时间取等待期间第一个回调开始的时间
+	Net::LoopStats local;
+	{
+		Net::LoopStats::Scope scope(&local);
+		local.BeginPoll(uv_hrtime());
+		EXPECT_EQ(local.GetPollReady(), 0u);
+		{
+			Net::LoopStats::CallbackTimer timer(Net::LoopStats::kAccept);
+		}
+		u64 ready = local.GetPollReady();
+		EXPECT_GT(ready, 0u);
+		{
+			Net::LoopStats::CallbackTimer timer(Net::LoopStats::kRead);
+		}
+		EXPECT_EQ(local.GetPollReady(), ready);
+		local.BeginPoll(uv_hrtime());
+		EXPECT_EQ(local.GetPollReady(), 0u);
+	}
+
+	// 关闭后不再计时
+	GetReactor()->SetLoopStats(false);
+	Poll();
+	EXPECT_EQ(GetReactor()->GetStats().iterations, after.iterations);
+	GetReactor()->SetLoopStats(true);
+}
+
+TEST_F(ConnectorTestSuite, traffic_stats) {
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && (acceptor_->connection_list_.empty() || connector->connection_list_.empty()); ++i) {
+		Poll();
+	}
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	ASSERT_EQ(connector->connection_list_.size(), 1u);
+	Net::SocketConnection * server = acceptor_->connection_list_.front();
+	Net::SocketConnection * client = connector->connection_list_.front();
+	EXPECT_EQ(server->GetTrafficStats().bytes_out, 0);
+	i64 reactor_in = GetReactor()->GetBytesIn(), reactor_out = GetReactor()->GetBytesOut();
+
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	for (i32 i = 0; i < 100 && client->GetTrafficStats().bytes_in < w_content_len_ * 2; ++i) {
+		Poll();
+	}
+	const Net::SocketConnection::TrafficStats & out = server->GetTrafficStats();
+	EXPECT_EQ(out.bytes_out, w_content_len_ * 2);
+	EXPECT_EQ(out.messages_out, 2);
+	EXPECT_GE(out.writes, 1);
+	EXPECT_LE(out.writes, 2);
+	EXPECT_GE(out.peak_out_buffer, w_content_len_);
+	EXPECT_EQ(out.bytes_in, 0);
+	EXPECT_EQ(out.reads, 0);
+	const Net::SocketConnection::TrafficStats & in = client->GetTrafficStats();
+	EXPECT_EQ(in.bytes_in, w_content_len_ * 2);
+	EXPECT_GE(in.reads, 1);
+	EXPECT_GE(in.messages_in, 1);
+	EXPECT_EQ(in.peak_in_buffer, w_content_len_ * 2);
+	EXPECT_EQ(in.bytes_out, 0);
+	EXPECT_LT(client->GetReadIdleTime(), 1000u);
+	EXPECT_LT(server->GetWriteIdleTime(), 1000u);
+
+	Net::SocketConnection::TrafficStats total = in;
+	total.Add(out);
+	EXPECT_EQ(total.bytes_in, w_content_len_ * 2);
+	EXPECT_EQ(total.bytes_out, w_content_len_ * 2);
+	EXPECT_EQ(total.peak_in_buffer, in.peak_in_buffer);
+	EXPECT_EQ(GetReactor()->GetBytesIn() - reactor_in, w_content_len_ * 2);
+	EXPECT_EQ(GetReactor()->GetBytesOut() - reactor_out, w_content_len_ * 2);
+	connector->Release();
+
+	// 连接断开后累计值不变
+	for (i32 i = 0; i < 100 && !acceptor_->connection_list_.empty(); ++i) {
+		Poll();
+	}
+	EXPECT_EQ(GetReactor()->GetBytesIn() - reactor_in, w_content_len_ * 2);
+	EXPECT_EQ(GetReactor()->GetBytesOut() - reactor_out, w_content_len_ * 2);
+}
+
+TEST_F(ConnectorTestSuite, write_latency) {
+	EXPECT_EQ(GetReactor()->GetWriteSampling(), 0);
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.empty(); ++i) {
+		Poll();
+	}
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	i64 before = GetReactor()->GetStats().write_latency.Count();
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	Poll();
+	EXPECT_EQ(GetReactor()->GetStats().write_latency.Count(), before);
+
+	// 每2次写入抽样1次
+	GetReactor()->SetWriteSampling(2);
+	EXPECT_EQ(GetReactor()->GetWriteSampling(), 2);
+	for (i32 i = 0; i < 4; ++i) {
+		acceptor_->WriteAll(w_content_, w_content_len_);
+		Poll();
+	}
+	Net::LoopStats::Snapshot stats = GetReactor()->GetStats();
+	EXPECT_EQ(stats.write_latency.Count() - before, 2);
+	EXPECT_GT(stats.write_latency.Percentile(50), 0u);
+	EXPECT_LE(stats.write_latency.Percentile(50), stats.write_latency.Percentile(99));
+	EXPECT_LE(stats.write_latency.Percentile(99), stats.write_latency.Percentile(99.9));
+	EXPECT_LT(stats.write_latency.Max(), 1000000000u);
+	GetReactor()->SetWriteSampling(0);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, lifecycle_stats) {
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->GetLifecycleStats().handshake.Count(), 0);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && (acceptor_->connection_list_.empty() || connector->connection_list_.empty()); ++i) {
+		Poll();
+	}
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	ASSERT_EQ(connector->connection_list_.size(), 1u);
+	Net::LifecycleStats accepted = acceptor_->GetLifecycleStats();
+	EXPECT_EQ(accepted.setup.Count(), 1);
+	EXPECT_EQ(accepted.handshake.Count(), 1);
+	EXPECT_LE(accepted.setup.Max(), accepted.handshake.Max());
+	EXPECT_EQ(accepted.first_read.Count(), 0);
+	Net::LifecycleStats connected = connector->GetLifecycleStats();
+	EXPECT_EQ(connected.setup.Count(), 1);
+	EXPECT_EQ(connected.handshake.Count(), 1);
+
+	// 首字节只记录一次
+	for (i32 i = 0; i < 2; ++i) {
+		acceptor_->WriteAll(w_content_, w_content_len_);
+		EXPECT_EQ(connector->connection_list_.front()->Write(w_content_, w_content_len_), w_content_len_);
+		Poll();
+	}
+	accepted = acceptor_->GetLifecycleStats();
+	connected = connector->GetLifecycleStats();
+	EXPECT_EQ(accepted.first_write.Count(), 1);
+	EXPECT_EQ(accepted.first_read.Count(), 1);
+	EXPECT_EQ(connected.first_write.Count(), 1);
+	EXPECT_EQ(connected.first_read.Count(), 1);
+	connector->Release();
+}
+
+TEST_F(ConnectorTestSuite, tcp_info) {
+	// 每次只抽样一个连接, 两端连接轮流刷新
+	GetReactor()->SetTcpInfoSampling(1, 1);
+	EXPECT_EQ(GetReactor()->GetTcpInfoInterval(), 1);
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && (acceptor_->connection_list_.empty() || connector->connection_list_.empty()); ++i) {
+		Poll();
+	}
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	ASSERT_EQ(connector->connection_list_.size(), 1u);
+	Net::SocketConnection * client = connector->connection_list_.front();
+	Net::SocketConnection * server = acceptor_->connection_list_.front();
+	EXPECT_EQ(client->GetTcpInfoTime(), 0u);
+	EXPECT_EQ(client->Write(w_content_, w_content_len_), w_content_len_);
+	for (i32 i = 0; i < 100 && (0 == client->GetTcpInfoTime() || 0 == server->GetTcpInfoTime()); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Poll();
+	}
+#ifdef __linux__
+	EXPECT_GT(client->GetTcpInfoTime(), 0u);
+	EXPECT_GT(server->GetTcpInfoTime(), 0u);
+	EXPECT_GT(client->GetTcpInfo().rtt, 0u);
+	EXPECT_GT(client->GetTcpInfo().snd_cwnd, 0u);
+	Net::EventReactor::TcpInfoStats stats = GetReactor()->GetTcpInfoStats();
+	EXPECT_GE(stats.rtt.Count(), 2);
+	EXPECT_EQ(stats.snd_cwnd.Count(), stats.rtt.Count());
+	EXPECT_EQ(stats.retransmits.Count(), stats.rtt.Count());
+	EXPECT_GT(stats.snd_cwnd.Min(), 0u);
+#else
+	EXPECT_NE(client->SampleTcpInfo(), 0);
+#endif
+	GetReactor()->SetTcpInfoSampling(0);
+	EXPECT_EQ(GetReactor()->GetTcpInfoInterval(), 0);
+	connector->Release();
+
+	MockConnection * idle = new MockConnection();
+	EXPECT_EQ(idle->SampleTcpInfo(), UV_ENOTCONN);
+	idle->Release();
+}
+
+#ifdef __linux__
+TEST_F(ConnectorTestSuite, trace_dump) {
+	GetReactor()->SetTrace(1024);
+	GetReactor()->SetTraceSignal(SIGUSR2, ".");
+	ASSERT_TRUE(GetReactor()->GetTrace() != nullptr);
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.empty(); ++i) {
+		Poll();
+	}
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	Poll();
+	std::vector<Net::TraceRecorder::Event> events;
+	GetReactor()->GetTrace()->GetEvents(events);
+	i32 accepts = 0, iterations = 0;
+	for (auto & it : events) {
+		if ('B' == it.phase && 0 == std::strcmp(it.name, "accept")) {
+			++accepts;
+		} else if ('E' == it.phase && 0 == std::strcmp(it.name, "iteration")) {
+			++iterations;
+		}
+	}
+	EXPECT_EQ(accepts, 1);
+	EXPECT_GT(iterations, 0);
+
+	// 收到信号后在事件循环线程写出
+	char name[64];
+	std::snprintf(name, sizeof(name), "./trace-%d-", static_cast<i32>(getpid()));
+	raise(SIGUSR2);
+	for (i32 i = 0; i < 10; ++i) {
+		Poll();
+	}
+	bool dumped = false;
+	for (i32 id = 1; id < 64 && !dumped; ++id) {
+		std::string path = std::string(name) + std::to_string(id) + "-1.json";
+		std::ifstream file(path.c_str());
+		if (file) {
+			dumped = true;
+			std::remove(path.c_str());
+		}
+	}
+	EXPECT_TRUE(dumped);
+	GetReactor()->SetTraceSignal(0, "");
+	GetReactor()->SetTrace(0);
+	EXPECT_TRUE(GetReactor()->GetTrace() == nullptr);
+	EXPECT_EQ(GetReactor()->DumpTrace("trace.json"), UV_EINVAL);
+	connector->Release();
+}
+#endif
+
+#ifdef __linux__
+TEST_F(ConnectorTestSuite, stats_segment) {
+	const std::string name = "libnet-test-" + std::to_string(getpid());
+	Net::StatsSegment * segment = new Net::StatsSegment(GetReactor());
+	EXPECT_TRUE(segment->AddAcceptor(acceptor_, "echo"));
+	EXPECT_FALSE(segment->AddAcceptor(acceptor_, "echo"));
+	EXPECT_EQ(segment->Open(name, 10), 0);
+	EXPECT_EQ(segment->Open(name, 10), UV_EBUSY);
+	EXPECT_TRUE(segment->IsOpened());
+
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && (acceptor_->connection_list_.empty() || connector->connection_list_.empty()); ++i) {
+		Poll();
+	}
+	ASSERT_EQ(connector->connection_list_.size(), 1u);
+	EXPECT_EQ(connector->connection_list_.front()->Write(w_content_, w_content_len_), w_content_len_);
+	Poll();
+	segment->Publish();
+
+	const Net::StatsSegment::Layout * layout = Net::StatsSegment::Attach(name);
+	ASSERT_TRUE(layout != nullptr);
+	Net::StatsSegment::Data data;
+	ASSERT_TRUE(Net::StatsSegment::Read(layout, data));
+	EXPECT_EQ(data.magic, Net::StatsSegment::kMagic);
+	EXPECT_EQ(data.pid, static_cast<i32>(getpid()));
+	EXPECT_GE(data.publishes, 2);
+	EXPECT_EQ(data.reactor.connections, 2);
+	EXPECT_GE(data.reactor.bytes_out, w_content_len_);
+	EXPECT_EQ(data.acceptor_count, 1);
+	EXPECT_STREQ(data.acceptors[0].label, "echo");
+	EXPECT_EQ(data.acceptors[0].accepted, 1);
+	EXPECT_EQ(data.connection_count, 2);
+	// 按本次刷新收发字节数排序
+	EXPECT_GE(data.connections[0].bytes_delta, data.connections[1].bytes_delta);
+	EXPECT_GT(data.connections[0].bytes_delta, 0);
+	EXPECT_GT(data.connections[0].out_capacity, 0);
+
+	// 定时刷新
+	i64 publishes = data.publishes;
+	for (i32 i = 0; i < 100 && data.publishes == publishes; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Poll();
+		Net::StatsSegment::Read(layout, data);
+	}
+	EXPECT_GT(data.publishes, publishes);
+	EXPECT_EQ(data.connections[0].bytes_delta, 0);
+	Net::StatsSegment::Detach(layout);
+
+	connector->Release();
+	segment->Close();
+	EXPECT_FALSE(segment->IsOpened());
+	EXPECT_TRUE(Net::StatsSegment::Attach(name) == nullptr);
+	delete segment;
+}
+#endif
+
+#ifdef __linux__
+static std::string Scrape(Net::EventReactor * reactor, i32 port, const std::string & request) {
+	i32 fd = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(static_cast<u16>(port));
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	std::string response;
+	if (0 == connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) && send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size())) {
+		i8 buffer[4096];
+		for (i32 i = 0; i < 1000; ++i) {
+			reactor->Poll();
+			ssize_t len = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+			if (0 == len) {
+				break;
+			} else if (len > 0) {
+				response.append(buffer, len);
+			} else {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+	close(fd);
+	return response;
+}
+
+TEST_F(ConnectorTestSuite, metrics_server) {
+	Net::MetricsServer * metrics = new Net::MetricsServer(GetReactor());
+	EXPECT_TRUE(metrics->AddAcceptor(acceptor_, "echo"));
+	EXPECT_FALSE(metrics->AddAcceptor(acceptor_, "echo"));
+	// 每步只汇总一个连接
+	metrics->SetSlice(1);
+	ASSERT_TRUE(metrics->Open(Net::SocketAddress("127.0.0.1", port_ + 1)));
+
+	MockMultiConnector * connector = new MockMultiConnector(GetReactor());
+	connector->SetConcurrency(2, 2);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
+	for (i32 i = 0; i < 100 && acceptor_->connection_list_.size() < 2; ++i) {
+		Poll();
+	}
+	ASSERT_EQ(acceptor_->connection_list_.size(), 2u);
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	Poll();
+
+	std::string response = Scrape(GetReactor(), port_ + 1, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+	EXPECT_EQ(response.find("HTTP/1.1 200 OK\r\n"), 0u);
+	EXPECT_NE(response.find("# TYPE net_loop_iteration_seconds summary\n"), std::string::npos);
+	EXPECT_NE(response.find("net_loop_iteration_seconds{quantile=\"0.99\"} "), std::string::npos);
+	// 4个连接加上本次抓取的连接
+	EXPECT_NE(response.find("\nnet_connections 5\n"), std::string::npos);
+	EXPECT_NE(response.find("net_accepted_total{listener=\"echo\"} 2\n"), std::string::npos);
+	EXPECT_NE(response.find("net_accept_dropped_total{listener=\"echo\",reason=\"rate\"} 0\n"), std::string::npos);
+	EXPECT_NE(response.find("net_buffer_in_use{size=\"64\"} "), std::string::npos);
+	EXPECT_NE(response.find("net_sent_bytes_total "), std::string::npos);
+	EXPECT_EQ(metrics->GetScrapeCount(), 1);
+
+	response = Scrape(GetReactor(), port_ + 1, "GET /other HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(response.find("HTTP/1.1 404 Not Found\r\n"), 0u);
+	response = Scrape(GetReactor(), port_ + 1, "POST /metrics HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(response.find("HTTP/1.1 405 Method Not Allowed\r\n"), 0u);
+	EXPECT_EQ(metrics->GetScrapeCount(), 1);
+
+	// 没有发完请求的连接超时后关闭
+	EXPECT_EQ(metrics->GetRequestTimeout(), Net::MetricsServer::kDefaultRequestTimeout);
+	metrics->SetRequestTimeout(20);
+	EXPECT_EQ(metrics->GetRequestTimeout(), 20);
+	response = Scrape(GetReactor(), port_ + 1, "GET /metrics HTTP/1.1\r\n");
+	EXPECT_TRUE(response.empty());
+	EXPECT_EQ(metrics->GetTimeoutCount(), 1);
+	EXPECT_EQ(metrics->GetScrapeCount(), 1);
+
+	// 长标签不截断
+	std::string label(300, 'x');
+	metrics->RemoveAcceptor(acceptor_);
+	EXPECT_TRUE(metrics->AddAcceptor(acceptor_, label));
+	metrics->SetRequestTimeout(0);
+	response = Scrape(GetReactor(), port_ + 1, "GET /metrics HTTP/1.1\r\n\r\n");
+	EXPECT_NE(response.find("\nnet_accepted_total{listener=\"" + label + "\"} 2\n"), std::string::npos);
+	EXPECT_NE(response.find("\nnet_accept_paused{listener=\"" + label + "\"} 0\n"), std::string::npos);
+
+	connector->Release();
+	metrics->Close();
+	metrics->Release();
+}
+#endif
+
+class MockConnectionPool : public Net::ConnectionPool {
+public:
+	MockConnectionPool(Net::EventReactor * reactor, const Net::SocketAddress & address) : Net::ConnectionPool(reactor, address), created_(0) {}
+	virtual Net::SocketConnection * NewConnection() override {
+		++created_;
+		return new MockConnection();
+	}
+	i32 created_;
+};
+
+TEST_F(ConnectorTestSuite, pool_lease) {
+	MockConnectionPool * pool = new MockConnectionPool(GetReactor(), Net::SocketAddress("127.0.0.1", port_));
+	pool->SetLimits(2, 3);
+	pool->SetHealthInterval(10);
+	EXPECT_TRUE(pool->Start());
+	EXPECT_FALSE(pool->Start());
+	Poll();
+	EXPECT_EQ(pool->GetIdleCount(), 2);
+	Net::SocketConnection * c1 = pool->Lease();
+	ASSERT_TRUE(c1 != nullptr);
+	EXPECT_EQ(pool->GetLeasedCount(), 1);
+	// 借出后在后台补足空闲连接
+	Poll();
+	EXPECT_EQ(pool->GetIdleCount(), 2);
+	Net::SocketConnection * c2 = pool->Lease();
+	Net::SocketConnection * c3 = pool->Lease();
+	EXPECT_TRUE(c2 != nullptr && c3 != nullptr);
+	EXPECT_TRUE(pool->Lease() == nullptr);
+	pool->Return(c1);
+	pool->Return(c2);
+	pool->Return(c3);
+	EXPECT_EQ(pool->GetIdleCount(), 3);
+	EXPECT_EQ(pool->GetLeasedCount(), 0);
+	EXPECT_EQ(pool->Lease(), c3);
+	pool->Return(c3);
+	EXPECT_EQ(pool->created_, 3);
+
+	// 对端关闭后由健康检查丢弃并重连
+	acceptor_->ShutdownAll(true);
+	for (i32 i = 0; i < 200 && (pool->created_ < 5 || pool->GetIdleCount() < 2); ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(pool->created_, 5);
+	EXPECT_EQ(pool->GetIdleCount(), 2);
+	EXPECT_EQ(pool->GetFailures(), 0);
+	pool->Stop();
+	EXPECT_EQ(pool->GetIdleCount(), 0);
+	pool->Release();
+}
+
+TEST_F(ConnectorTestSuite, pool_backoff) {
+	MockConnectionPool * pool = new MockConnectionPool(GetReactor(), Net::SocketAddress("127.0.0.1", port_ + 200));
+	pool->SetLimits(1, 1);
+	pool->SetHealthInterval(5);
+	pool->SetBackoff(40, 200);
+	EXPECT_TRUE(pool->Start());
+	for (i32 i = 0; i < 100; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	// 100ms内最多重试约4次
+	EXPECT_GE(pool->GetFailures(), 1);
+	EXPECT_LE(pool->GetFailures(), 5);
+	EXPECT_TRUE(pool->Lease() == nullptr);
+	EXPECT_EQ(pool->created_, 0);
+	pool->Stop();
+	pool->Release();
+}
+
+TEST_F(ConnectorTestSuite, pool_retry_timer) {
+	MockConnectionPool * pool = new MockConnectionPool(GetReactor(), Net::SocketAddress("127.0.0.1", port_ + 200));
+	pool->SetLimits(1, 1);
+	pool->SetHealthInterval(1000);
+	pool->SetBackoff(20, 20);
+	EXPECT_TRUE(pool->Start());
+	for (i32 i = 0; i < 100; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	// 退避到期即重试, 不等健康检查
+	EXPECT_GE(pool->GetFailures(), 3);
+	pool->Stop();
+	pool->Release();
+}
+
 class MockWriteConnection : public MockConnection {
 public:
 	virtual void OnNewDataReceived() override {
@@ -441,6 +1394,36 @@ public:
 	MockWriteConnection * connection_;
 };
 
+TEST_F(ConnectorTestSuite, socket_options) {
+	Net::SocketOptions options;
+	options.fast_open = 16;
+	options.not_sent_lowat = 16384;
+	options.user_timeout = 5000;
+	options.quick_ack = true;
+	options.cork = true;
+	MockAcceptor * acceptor = new MockAcceptor(GetReactor());
+	acceptor->SetSocketOptions(options);
+	EXPECT_EQ(acceptor->GetSocketOptions().fast_open, 16);
+	EXPECT_EQ(acceptor->Open(Net::SocketAddress("127.0.0.1", port_ + 100)), true);
+	MockConnector * connector = new MockConnector(GetReactor());
+	connector->SetSocketOptions(options);
+	EXPECT_EQ(connector->Connect(Net::SocketAddress("127.0.0.1", port_ + 100)), true);
+	Poll();
+	ASSERT_TRUE(connector->connection_ != nullptr);
+	EXPECT_EQ(connector->connection_->call_connected_, 1);
+	EXPECT_TRUE(connector->connection_->GetSocketOptions().cork);
+	// 塞住的数据在检查阶段发出
+	EXPECT_EQ(connector->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	EXPECT_EQ(connector->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	Poll();
+	ASSERT_EQ(acceptor->connection_list_.size(), 1u);
+	EXPECT_EQ(acceptor->connection_list_.front()->GetRecvDataSize(), w_content_len_ * 2);
+	EXPECT_EQ(acceptor->connection_list_.front()->GetSocketOptions().user_timeout, 5000);
+	EXPECT_EQ(connector->connection_->call_error_, 0);
+	connector->Release();
+	acceptor->Release();
+}
+
 class ConnectionTestSuite : public ConnectorTestSuite {
 public:
 	ConnectionTestSuite() { port_ += 10; }
@@ -448,6 +1431,7 @@ public:
 	// Sets up the test fixture.
 	virtual void SetUp() {
 		ConnectorTestSuite::SetUp();
+		GetReactor()->SetWriteBatching(false);
 		connector_ = new MockConnector(GetReactor());
 		EXPECT_EQ(connector_->Connect(Net::SocketAddress("127.0.0.1", port_)), true);
 		Poll();
@@ -501,6 +1485,195 @@ TEST_F(ConnectionTestSuite, write_succ) {
 	EXPECT_EQ(connector_->connection_->call_sent_, 5);
 }
 
+TEST_F(ConnectionTestSuite, write_batching) {
+	GetReactor()->SetWriteBatching(true);
+	EXPECT_TRUE(GetReactor()->IsWriteBatching());
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	EXPECT_EQ(connector_->connection_->GetSocket()->GetWriteQueueSize(), 0);
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+	EXPECT_EQ(connector_->connection_->call_sent_, 1);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	GetReactor()->SetWriteBatching(false);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	connector_->connection_->Shutdown(false);
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+	EXPECT_EQ(connector_->connection_->call_sent_, 3);
+}
+
+TEST_F(ConnectionTestSuite, write_zerocopy) {
+	connector_->connection_->SetZeroCopyThreshold(8);
+	EXPECT_EQ(connector_->connection_->GetZeroCopyThreshold(), 8);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, 4), 4);
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+#ifdef __linux__
+	EXPECT_EQ(connector_->connection_->GetZeroCopySends(), 1);
+	EXPECT_LE(connector_->connection_->GetZeroCopyCopied(), 1);
+	EXPECT_GE(connector_->connection_->call_sent_, 1);
+	// 完成通知唤醒的读回调不算读次数
+	EXPECT_LE(connector_->connection_->GetTrafficStats().reads, connector_->connection_->GetTrafficStats().bytes_in);
+#else
+	EXPECT_EQ(connector_->connection_->GetZeroCopySends(), 0);
+	EXPECT_EQ(connector_->connection_->call_sent_, 2);
+#endif
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	connector_->connection_->Shutdown(false);
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+	EXPECT_EQ(connector_->connection_->call_disconnected_, 1);
+	connector_->connection_->SetZeroCopyThreshold(0);
+	EXPECT_EQ(connector_->connection_->GetZeroCopyThreshold(), 0);
+}
+
+TEST_F(ConnectionTestSuite, zerocopy_close) {
+	connector_->connection_->SetZeroCopyThreshold(8);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	// 完成通知到达前关闭, 发送缓冲区由EventReactor接管, 数据照常发出
+	connector_->connection_->Shutdown(true);
+	EXPECT_LE(GetReactor()->GetParkedZeroCopy(), 1);
+	for (i32 i = 0; i < 100 && GetReactor()->GetParkedZeroCopy() > 0; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Poll();
+	EXPECT_EQ(GetReactor()->GetParkedZeroCopy(), 0);
+	EXPECT_EQ(connector_->connection_->call_disconnected_, 1);
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	Net::SocketConnection * peer = acceptor_->connection_list_.front();
+	EXPECT_EQ(peer->GetTrafficStats().bytes_in, w_content_len_);
+}
+
+TEST_F(ConnectionTestSuite, send_file) {
+	EXPECT_EQ(connector_->connection_->SendFile(-1, 0, 10), UV_EINVAL);
+	std::FILE * file = std::tmpfile();
+	ASSERT_TRUE(file != nullptr);
+	const char * content = "0123456789abcdefghij";
+	std::fwrite(content, 1, 20, file);
+	std::fflush(file);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+#ifdef __linux__
+	EXPECT_EQ(connector_->connection_->SendFile(fileno(file), 5, 10), 0);
+	EXPECT_EQ(connector_->connection_->SendFile(fileno(file), 0, 10), UV_EBUSY);
+	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
+	for (i32 i = 0; i < 100 && connector_->connection_->call_file_sent_ < 10; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_file_sent_, 10);
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	Net::SocketConnection * peer = acceptor_->connection_list_.front();
+	EXPECT_EQ(peer->GetRecvDataSize(), w_content_len_ * 2 + 10);
+	std::string received(peer->GetRecvData(), peer->GetRecvDataSize());
+	EXPECT_EQ(received, std::string("hello world56789abcdehello world"));
+#else
+	EXPECT_EQ(connector_->connection_->SendFile(fileno(file), 5, 10), UV_ENOSYS);
+#endif
+	std::fclose(file);
+}
+
+TEST_F(ConnectionTestSuite, send_file_large) {
+	const i32 size = 3 * 1024 * 1024 + 17;
+	std::vector<i8> content(size);
+	for (i32 i = 0; i < size; ++i) {
+		content[i] = static_cast<i8>(i * 131 + (i >> 12));
+	}
+	std::FILE * in = std::tmpfile();
+	std::FILE * out = std::tmpfile();
+	ASSERT_TRUE(in != nullptr && out != nullptr);
+	EXPECT_EQ(std::fwrite(content.data(), 1, size, in), static_cast<size_t>(size));
+	std::fflush(in);
+	ASSERT_EQ(acceptor_->connection_list_.size(), 1u);
+	MockConnection * peer = static_cast<MockConnection *>(acceptor_->connection_list_.front());
+#ifdef __linux__
+	EXPECT_EQ(peer->ReceiveToFile(fileno(out), 0, size), 0);
+	EXPECT_EQ(connector_->connection_->SendFile(fileno(in), 0, size), 0);
+	// 超过一次可写事件的发送量, 分多轮事件循环发完
+	for (i32 i = 0; i < 2000 && (connector_->connection_->call_file_sent_ < size || peer->call_file_recv_ < size); ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(connector_->connection_->call_file_sent_, size);
+	EXPECT_EQ(peer->call_file_recv_, size);
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+	EXPECT_EQ(peer->call_error_, 0);
+	std::vector<i8> received(size);
+	EXPECT_EQ(pread(fileno(out), received.data(), size, 0), size);
+	EXPECT_TRUE(received == content);
+
+	// O_APPEND的文件不支持splice写入, 改为从pipe读出后写入
+	std::FILE * append = std::tmpfile();
+	ASSERT_TRUE(append != nullptr);
+	fcntl(fileno(append), F_SETFL, fcntl(fileno(append), F_GETFL) | O_APPEND);
+	EXPECT_EQ(peer->ReceiveToFile(fileno(append), -1, size), 0);
+	EXPECT_EQ(connector_->connection_->SendFile(fileno(in), 0, size), 0);
+	for (i32 i = 0; i < 2000 && (connector_->connection_->call_file_sent_ < size * 2 || peer->call_file_recv_ < size * 2); ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(peer->call_file_recv_, size * 2);
+	EXPECT_EQ(peer->call_error_, 0);
+	std::fill(received.begin(), received.end(), 0);
+	EXPECT_EQ(pread(fileno(append), received.data(), size, 0), size);
+	EXPECT_TRUE(received == content);
+	std::fclose(append);
+#endif
+	std::fclose(in);
+	std::fclose(out);
+}
+
+TEST_F(ConnectionTestSuite, receive_file) {
+	EXPECT_EQ(connector_->connection_->ReceiveToFile(-1, 0, 10), UV_EINVAL);
+	std::FILE * file = std::tmpfile();
+	ASSERT_TRUE(file != nullptr);
+	// MockWriteConnection每次收到数据读走4字节, 缓冲区中剩下"o world"
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_recv_, 1);
+	EXPECT_EQ(connector_->connection_->GetRecvDataSize(), 7);
+#ifdef __linux__
+	EXPECT_EQ(connector_->connection_->ReceiveToFile(fileno(file), 0, 16), 0);
+	EXPECT_EQ(connector_->connection_->GetRecvDataSize(), 0);
+	EXPECT_EQ(connector_->connection_->ReceiveToFile(fileno(file), 0, 16), UV_EBUSY);
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	for (i32 i = 0; i < 100 && connector_->connection_->call_file_recv_ < 16; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_file_recv_, 16);
+	EXPECT_EQ(connector_->connection_->call_error_, 0);
+	i8 buf[32] = {0};
+	EXPECT_EQ(pread(fileno(file), buf, sizeof(buf), 0), 16);
+	EXPECT_EQ(std::string(buf), std::string("o worldhello wor"));
+	// 剩余的"ld"恢复为正常读取
+	EXPECT_EQ(connector_->connection_->call_recv_, 2);
+	EXPECT_EQ(connector_->connection_->GetRecvDataSize(), 0);
+
+	i8 memory[8] = {0};
+	EXPECT_EQ(connector_->connection_->ReceiveToMemory(memory, 5), 0);
+	acceptor_->WriteAll(w_content_, w_content_len_);
+	for (i32 i = 0; i < 100 && connector_->connection_->call_file_recv_ < 21; ++i) {
+		Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Poll();
+	EXPECT_EQ(connector_->connection_->call_file_recv_, 21);
+	EXPECT_EQ(std::string(memory), std::string("hello"));
+	EXPECT_EQ(connector_->connection_->call_recv_, 3);
+	EXPECT_EQ(std::string(connector_->connection_->GetRecvData(), connector_->connection_->GetRecvDataSize()), std::string("ld"));
+#else
+	EXPECT_EQ(connector_->connection_->ReceiveToFile(fileno(file), 0, 16), UV_ENOSYS);
+#endif
+	std::fclose(file);
+}
+
 TEST_F(ConnectionTestSuite, write_close) {
 	EXPECT_EQ(connector_->connection_->Write(w_content_, w_content_len_), w_content_len_);
 	connector_->connection_->Shutdown(true);
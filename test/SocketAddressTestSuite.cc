@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "Address/SocketAddress.h"
+#include <unordered_map>
 
 class SocketAddressImplTestSuite : public testing::Test {
 public:
@@ -210,4 +211,21 @@ TEST_F(SocketAddressTestSuite, cmp) {
 TEST_F(SocketAddressTestSuite, cmp2) {
 	Net::SocketAddress ip(ip_->Host(), 9999);
 	EXPECT_TRUE(ip != *ip_);
+}
+
+TEST_F(SocketAddressTestSuite, hash) {
+	EXPECT_TRUE(std::is_trivially_copyable<Net::SocketAddress>::value);
+	Net::SocketAddress ip(reinterpret_cast<sockaddr *>(&ipv4_addr_), sizeof(ipv4_addr_));
+	EXPECT_EQ(ip.Hash(), ip_->Hash());
+	EXPECT_NE(ip.Hash(), Net::SocketAddress(ip.Host(), 6790).Hash());
+	EXPECT_NE(ip_->Hash(), ip6_->Hash());
+
+	std::unordered_map<Net::SocketAddress, i32> peers;
+	peers[*ip_] = 1;
+	peers[*ip6_] = 2;
+	peers[ip] = 3;
+	EXPECT_EQ(peers.size(), 2u);
+	EXPECT_EQ(peers[Net::SocketAddress("192.168.1.100", 6789)], 3);
+	EXPECT_EQ(peers.count(Net::SocketAddress("192.168.1.100", 6790)), 0u);
+	EXPECT_EQ(peers[Net::SocketAddress("fe80::6101:927f:1dde:cb33", 6789)], 2);
 }
\ No newline at end of file
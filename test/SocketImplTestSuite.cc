@@ -144,6 +144,7 @@ TEST_F(SocketImplTestSuite, address) {
 TEST_F(SocketImplTestSuite, opt) {
 	socket_impl_->SetNoDelay();
 	socket_impl_->SetKeepAlive(60);
+	EXPECT_LT(socket_impl_->SetBusyPoll(50), 0);
 	socket_impl_->SetUvData(uv_data_);
 	socket_impl_->SetUvData(nullptr);
 }
@@ -464,6 +465,21 @@ TEST_F(SocketImplCbTestSuite, address) {
 TEST_F(SocketImplCbTestSuite, opt) {
 	client_socket_impl_->SetNoDelay();
 	client_socket_impl_->SetKeepAlive(60);
+	client_socket_impl_->SetBusyPoll(50);
+#ifdef __linux__
+	EXPECT_EQ(client_socket_impl_->SetBusyPoll(0), 0);
+	EXPECT_EQ(client_socket_impl_->SetNotSentLowat(16384), 0);
+	EXPECT_EQ(client_socket_impl_->SetQuickAck(true), 0);
+	EXPECT_EQ(client_socket_impl_->SetCork(true), 0);
+	EXPECT_EQ(client_socket_impl_->SetCork(false), 0);
+	EXPECT_EQ(client_socket_impl_->SetUserTimeout(5000), 0);
+	EXPECT_EQ(client_socket_impl_->SetMaxPacingRate(1 << 20), 0);
+	Net::SocketOptions options;
+	options.not_sent_lowat = 4096;
+	options.user_timeout = 0;
+	options.quick_ack = true;
+	EXPECT_EQ(client_socket_impl_->SetOptions(options), 0);
+#endif
 }
 
 class SocketImplEstablishedTestSuite : public SocketImplCbTestSuite {
@@ -129,6 +129,10 @@ TEST_F(SocketOpenTestSuite, operation) {
 	EXPECT_EQ(socket_->RemoteAddress(), Net::SocketAddress());
 	socket_->SetNoDelay();
 	socket_->SetKeepAlive(60);
+	EXPECT_LT(socket_->SetBusyPoll(50), 0);
+	EXPECT_LT(socket_->SetNotSentLowat(16384), 0);
+	EXPECT_LT(socket_->SetUserTimeout(1000), 0);
+	EXPECT_EQ(socket_->SetOptions(Net::SocketOptions()), 0);
 	Net::UvData * data = new MockUvData();
 	socket_->SetUvData(data);
 	socket_->SetUvData(nullptr);
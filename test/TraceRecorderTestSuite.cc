@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include "Common/TraceRecorder.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+TEST(TraceRecorderTestSuite, record) {
+	Net::TraceRecorder trace(10);
+	EXPECT_EQ(trace.GetCapacity(), 16);
+	std::vector<Net::TraceRecorder::Event> events;
+	EXPECT_EQ(trace.GetEvents(events), 0);
+
+	trace.Record(Net::TraceRecorder::kBegin, "read", 1, 1000);
+	trace.Record(Net::TraceRecorder::kEnd, "read", 2, 2000);
+	trace.Instant("accept", 3);
+	EXPECT_EQ(trace.GetRecorded(), 3u);
+	ASSERT_EQ(trace.GetEvents(events), 3);
+	EXPECT_STREQ(events[0].name, "read");
+	EXPECT_EQ(events[0].phase, 'B');
+	EXPECT_EQ(events[0].time, 1000u);
+	EXPECT_EQ(events[1].arg, 2);
+	EXPECT_EQ(events[2].phase, 'i');
+}
+
+TEST(TraceRecorderTestSuite, wrap) {
+	Net::TraceRecorder trace(16);
+	for (i32 i = 0; i < 40; ++i) {
+		trace.Record(Net::TraceRecorder::kInstant, "tick", i, static_cast<u64>(i));
+	}
+	std::vector<Net::TraceRecorder::Event> events;
+	ASSERT_EQ(trace.GetEvents(events), 16);
+	// 只保留最新的事件, 按写入顺序
+	for (i32 i = 0; i < 16; ++i) {
+		EXPECT_EQ(events[i].arg, 24 + i);
+	}
+}
+
+TEST(TraceRecorderTestSuite, chrome_trace) {
+	Net::TraceRecorder trace(16);
+	// 被覆盖了开始事件的结束事件不输出
+	trace.Record(Net::TraceRecorder::kEnd, "poll", 0, 500);
+	trace.Record(Net::TraceRecorder::kBegin, "iteration", 0, 1000);
+	trace.Record(Net::TraceRecorder::kBegin, "read", 0, 1500);
+	trace.Record(Net::TraceRecorder::kEnd, "read", 0, 2250);
+	trace.Record(Net::TraceRecorder::kEnd, "iteration", 1, 3000);
+
+	const std::string path = "trace_recorder_test.json";
+	EXPECT_EQ(trace.WriteChromeTrace(path, 7, 2), 4);
+	std::ifstream file(path.c_str());
+	std::stringstream json;
+	json << file.rdbuf();
+	std::string content = json.str();
+	EXPECT_EQ(content.find("\"poll\""), std::string::npos);
+	EXPECT_NE(content.find("{\"name\":\"read\",\"ph\":\"E\",\"ts\":2.250,\"pid\":7,\"tid\":2,\"args\":{\"arg\":0}}"), std::string::npos);
+	EXPECT_NE(content.find("\"traceEvents\":["), std::string::npos);
+	EXPECT_EQ(content.substr(content.size() - 3), "]}\n");
+	std::remove(path.c_str());
+
+	EXPECT_LT(trace.WriteChromeTrace("no_such_dir/trace.json", 7, 2), 0);
+}